@@ -0,0 +1,100 @@
+#ifndef BATTERY_MODEL_H
+#define BATTERY_MODEL_H
+
+#include <Arduino.h>
+
+#include "hw_config.h"
+
+// Nominal capacity and the deep sleep current (define in board.h to override), the charge used while awake is estimated by
+// PowerManager
+#ifndef BATTERY_CAPACITY_MAH
+#define BATTERY_CAPACITY_MAH 2000
+#endif
+#ifndef BATTERY_CURRENT_SLEEP_UA
+#define BATTERY_CURRENT_SLEEP_UA 30  // deep sleep of the whole board
+#endif
+
+// Charge left at VOLTAGE_LINEAR_MIN, the voltage falls steeply from there to VOLTAGE_MIN
+#ifndef BATTERY_KNEE_PERCENT
+#define BATTERY_KNEE_PERCENT 10
+#endif
+
+// Policy thresholds (charge left in percent) and how much longer the device sleeps below them
+#ifndef BATTERY_SAVING_PERCENT
+#define BATTERY_SAVING_PERCENT 30
+#endif
+#ifndef BATTERY_CRITICAL_PERCENT
+#define BATTERY_CRITICAL_PERCENT 10
+#endif
+#ifndef BATTERY_SAVING_SLEEP_FACTOR
+#define BATTERY_SAVING_SLEEP_FACTOR 2
+#endif
+#ifndef BATTERY_CRITICAL_SLEEP_FACTOR
+#define BATTERY_CRITICAL_SLEEP_FACTOR 4
+#endif
+#ifndef BATTERY_MAX_STRETCHED_SLEEP
+#define BATTERY_MAX_STRETCHED_SLEEP (SECONDS_PER_HOUR * 24)
+#endif
+
+// Number of voltage samples kept for the discharge slope
+#define BATTERY_HISTORY_SIZE 8
+
+enum BatteryPolicy : uint8_t {
+  BATTERY_POLICY_NORMAL = 0,
+  BATTERY_POLICY_SAVING = 1,    // longer sleeps, no firmware downloads
+  BATTERY_POLICY_CRITICAL = 2,  // even longer sleeps, no frame schedule downloads either
+};
+
+struct BatteryVoltageSample {
+  uint32_t time;  // server time (see SleepTimer::now())
+  uint16_t mv;
+};
+
+// Kept in RTC memory (survives deep sleep, but not a reset or power loss)
+struct BatteryModelState {
+  uint16_t filteredMv;                                 // smoothed battery voltage, 0 = no sample yet
+  BatteryVoltageSample history[BATTERY_HISTORY_SIZE];  // ring of filtered voltages, at most one per BATTERY_HISTORY_INTERVAL
+  uint8_t historyCount;
+  uint8_t historyNext;
+  float windowMah;         // charge used since the last consumption estimate
+  uint32_t windowSeconds;  // time covered by windowMah
+  float mahPerDay;         // smoothed consumption, 0 = unknown
+  BatteryPolicy policy;
+};
+
+// Forward declarations
+class Logger;
+class SleepTimer;
+
+// Discharge model of the battery. The voltage measured on every WiFi wakeup is smoothed and sampled into a short history,
+// the charge used by every wake/sleep cycle is estimated from the durations of its phases and the board currents above.
+// Both give an estimate of the days left, the smaller one is reported to the server.
+//
+// The charge left (derived from the smoothed voltage) selects the policy: the lower it gets, the longer the device sleeps
+// and the more optional work it skips, so that it keeps showing something for as long as possible.
+class BatteryModel {
+ private:
+  Logger& logger;
+  BatteryModelState& state;
+  SleepTimer& sleepTimer;
+
+  void addHistorySample(uint32_t now);
+  float slopeDaysRemaining();
+  float energyDaysRemaining();
+
+ public:
+  BatteryModel(Logger& logger, BatteryModelState& state, SleepTimer& sleepTimer);
+
+  void update(float voltage);
+  void endWake(float awakeMah, uint32_t awakeMs, uint32_t sleepSeconds);
+
+  int chargePercent();
+  float daysRemaining();
+  BatteryPolicy policy() { return state.policy; }
+  int sleepFactor();
+  int stretchSleep(int seconds);
+  bool allowsFirmwareUpdate();
+  bool allowsFrameSchedule();
+};
+
+#endif  // BATTERY_MODEL_H
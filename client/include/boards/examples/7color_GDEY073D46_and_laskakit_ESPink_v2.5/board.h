@@ -0,0 +1,12 @@
+#include "driver/laskakit_espink_v2_5.h"
+#include "epaper/GDEY073D46_7C.h"
+
+#define DEBUG
+
+#define USE_WIFI_MANAGER
+#define HOSTNAME "epaper" /* host name for mDNS (in the .local domain) */
+
+#define USE_MDNS_FOR_SERVER
+// #define CALENDAR_URL_HOST "192.168.0.100"
+// #define CALENDAR_URL_PORT 5000
+
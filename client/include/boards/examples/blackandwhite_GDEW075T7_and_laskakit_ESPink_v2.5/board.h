@@ -9,3 +9,5 @@
 #define USE_MDNS_FOR_SERVER
 // #define CALENDAR_URL_HOST "192.168.0.100"
 // #define CALENDAR_URL_PORT 5000
+// #define CALENDAR_URL_HTTPS /* connect with TLS, see tools/tls_standin for a local test */
+// #define CALENDAR_SERVER_CERT_SHA256 "04:9E:...:3B" /* pin the server certificate, trusted on first use otherwise */
@@ -0,0 +1,14 @@
+#include "driver/laskakit_espink_v2_5.h"
+#include "epaper/GDEW075T7_4G.h"
+
+#define DEBUG
+
+#define USE_WIFI_MANAGER
+#define HOSTNAME "epaper" /* host name for mDNS (in the .local domain) */
+
+#define USE_MDNS_FOR_SERVER
+// #define CALENDAR_URL_HOST "192.168.0.100"
+// #define CALENDAR_URL_PORT 5000
+
+// No PSRAM on this board, text screens are black and white anyway
+#define USE_GRAYSCALE_BW_DISPLAY
@@ -0,0 +1,49 @@
+#ifndef COMPRESSED_FRAME_H
+#define COMPRESSED_FRAME_H
+
+#include <Arduino.h>
+
+#include "hw_config.h"
+
+// The frame buffer is only grown while this much internal heap stays free for WiFi and the HTTP client
+#ifndef COMPRESSED_FRAME_HEAP_RESERVE
+#define COMPRESSED_FRAME_HEAP_RESERVE (24 * 1024)
+#endif
+
+// Forward declarations
+class Logger;
+
+// Whole frame kept in the internal heap with every row PackBits-compressed, so that a paged display can draw its second and
+// following pages without downloading (or reading from flash) the frame again. Rows are appended in order as they arrive,
+// an index of row offsets gives random access to any of them. A typical calendar frame packs to a few kB instead of tens of kB.
+// If the heap runs out the frame is simply dropped and the caller falls back to fetching the rows again.
+class CompressedFrame {
+ private:
+  Logger& logger;
+  uint16_t rowBytes;
+  uint16_t height;
+  uint16_t rowsStored;
+  uint32_t* rowOffsets;  // height + 1 entries, the last one is the end of the data
+  uint8_t* data;
+  size_t capacity;
+  bool failed;
+
+  bool reserve(size_t size);
+
+ public:
+  CompressedFrame(Logger& logger);
+  ~CompressedFrame();
+
+  bool begin(uint16_t height, uint16_t rowBytes);
+  void release();
+
+  // Rows have to come in order, appending an already stored row discards it and everything after it (download restarted)
+  bool appendRow(uint16_t row, const uint8_t* rowData);
+  bool readRow(uint16_t row, uint8_t* rowData);
+
+  // All rows are stored
+  bool complete();
+  size_t size();
+};
+
+#endif  // COMPRESSED_FRAME_H
@@ -0,0 +1,75 @@
+#ifndef DEVICE_PROTOCOL_H
+#define DEVICE_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Request building and stream header parsing of the device API. Kept free of the Arduino core (plain C strings only), so
+// that host tools like the fleet load generator (tools/fleet_loadgen) speak exactly the same protocol as the firmware.
+
+#define DEVICE_API_CONFIG_PATH "/api/device/config"
+#define DEVICE_API_BITMAP_PATH "/api/device/bitmap/epaper"
+#define DEVICE_API_SCHEDULE_PATH "/api/device/bitmap/schedule"
+#define DEVICE_API_FIRMWARE_PATH "/api/device/firmware"
+
+// Version of the binary telemetry sent with the config request
+#define TELEMETRY_VERSION 1
+
+// First lines of a v2 ("fmt=2") bitmap and of a frame schedule bundle (whose frames are v2 bitmaps)
+#define BITMAP_V2_MAGIC "MM"
+#define FRAME_SCHEDULE_MAGIC "MS"
+
+// A v3 ("fmt=3") bitmap starts with a fixed binary header, all numbers little-endian:
+//   0  "MM", version (3), header size      16  payload length (bytes after the header)
+//   4  width, height (uint16)              20  frame hash (uint64, see frame_hash.h, of all rows before encoding)
+//   8  bits per pixel, encoding, 2 x 0     28  SHA-1 of all rows before encoding (the checksum, 20 bytes)
+//   12 first row, row count (uint16)
+// Newer versions may make the header longer, the extra bytes are skipped. Row data is encoded as announced:
+#define BITMAP_ENCODING_RAW 0            // rows as they are
+#define BITMAP_ENCODING_PACKBITS_ROWS 1  // every row as uint16 length + PackBits data (see packbits.h)
+#define BITMAP_V3_VERSION 3
+#define BITMAP_V3_HEADER_SIZE 48
+#define BITMAP_V3_CHECKSUM_SIZE 20
+
+// Decoders of the device, sent with the bitmap request. The server picks the smallest encoding the device can decode.
+#define DEVICE_CAPS_PACKBITS_ROWS 0x01
+#define DEVICE_CAPABILITIES DEVICE_CAPS_PACKBITS_ROWS
+
+struct BitmapV3Header {
+  uint8_t headerSize;
+  uint16_t width;
+  uint16_t height;
+  uint8_t bitsPerPixel;
+  uint8_t encoding;
+  uint16_t firstRow;
+  uint16_t rowCount;
+  uint32_t payloadLength;
+  uint64_t frameHash;
+  char checksum[BITMAP_V3_CHECKSUM_SIZE * 2 + 1];  // hex, the same string as the v2 checksum line
+};
+
+// Longest path + query built below (MAC, row number and counts included)
+#define DEVICE_API_MAX_PATH 96
+
+// Each builder writes a path with the query string into `buffer` and returns false if it doesn't fit
+bool buildBitmapPath(char* buffer, size_t size, const char* mac, uint16_t firstRow, unsigned int capabilities);
+bool buildFrameSchedulePath(char* buffer, size_t size, const char* mac, int count);
+bool buildFirmwarePath(char* buffer, size_t size, const char* mac);
+
+// Bytes of one row of a v2 bitmap for the display color type ("BW", "3C", "4C", "7C"), 0 if the type is unknown
+int bitmapBytesPerRow(const char* colorType, int width);
+
+// Parses the first BITMAP_V3_HEADER_SIZE bytes of a v3 bitmap, returns false if it isn't one
+bool parseBitmapV3Header(const uint8_t* data, BitmapV3Header& header);
+// Writes the BITMAP_V3_HEADER_SIZE bytes of `header` (whose headerSize is ignored), returns false if the checksum isn't hex
+bool writeBitmapV3Header(uint8_t* data, const BitmapV3Header& header);
+// Checks the header against the display and the request before any row is read. Returns nullptr if the frame fits,
+// otherwise what's wrong with it.
+const char* validateBitmapV3Header(const BitmapV3Header& header, int width, int height, int bitsPerPixel, uint16_t firstRow,
+                                   unsigned int capabilities);
+
+// Second line of a frame schedule bundle: "<frame count> <valid until>". Returns false if it's malformed or offers more
+// frames than requested.
+bool parseFrameScheduleHeader(const char* line, int requested, unsigned int& count, uint32_t& validUntil);
+
+#endif  // DEVICE_PROTOCOL_H
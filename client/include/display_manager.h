@@ -3,32 +3,58 @@
 #include <Adafruit_GFX.h>
 #include <Arduino.h>
 
+#include "compressed_frame.h"
+#include "error_screens.h"
+
 // Forward declarations
+class GxEPD2_GFX;
 class Logger;
-class WDTManager;
-class OTAManager;
+class ServiceTicker;
+class PowerManager;
+class RefreshScheduler;
 
 class DisplayManager {
  private:
   Logger& logger;
-  WDTManager& wdt;
-  OTAManager& ota;
+  ServiceTicker& serviceTicker;
+  PowerManager& powerManager;
+  RefreshScheduler& refreshScheduler;
   static const uint16_t serverByteToGxEPDColor[8];
   uint32_t startTime;
+  GxEPD2_GFX* display;
+  CompressedFrame bufferedFrame;
+  bool bufferingRows;
+  bool partialWindow;
+  bool initialized;
+
+  GxEPD2_GFX* createDisplay();
+  static void busyCallback(const void* param);
+  int wrapText(const String& message, String* wrappedLines, int maxLines);
 
  public:
-  DisplayManager(Logger& logger, WDTManager& wdtManager, OTAManager& otaManager);
+  DisplayManager(Logger& logger, ServiceTicker& serviceTicker, PowerManager& powerManager, RefreshScheduler& refreshScheduler);
 
+  // Called by every method which needs the panel, only once
   void init();
   void stop();
   void displayText(String message, const GFXfont* font = nullptr);
+  void displayPrerendered(const PrerenderedErrorScreen& screen, String bandText, const GFXfont* font);
   int displayWidth();
   int displayHeight();
+  int pageCount();
 
   // Bitmap drawing methods
   int bytesPerRow();
+  int bitsPerPixel();
   void beginBitmapDraw();
+  // Partial window covering rows top..bottom-1 and row bytes left..right-1, drawn with the same methods as a full frame
+  bool supportsPartialRefresh();
+  void beginPartialBitmapDraw(uint16_t top, uint16_t bottom, uint16_t left, uint16_t right);
+  // Puts a row of the frame currently on the panel into the controller's memory of the previous image
+  void writePreviousBitmapRow(const uint8_t* data, int16_t y, uint16_t left, uint16_t right);
   void drawBitmapRow(unsigned char* data, int16_t y);
   bool nextPageBitmapDraw();
+  // Draws the rows buffered during the first page into the current one, returns false if they aren't all available
+  bool drawBufferedBitmap();
   void endBitmapDraw();
 };
@@ -5,5 +5,6 @@
 #define DISPLAY_HEIGHT 480
 #define DISPLAY_TYPE_4C
 
-#define DISPLAY_CLASS_TYPE GxEPD2_4C<GxEPD2_750c_GDEM075F52, GxEPD2_750c_GDEM075F52::HEIGHT / SPLIT_DISPLAY_INTO_N_PAGES>
+#define DISPLAY_CLASS_TEMPLATE GxEPD2_4C
+#define DISPLAY_DRIVER_CLASS GxEPD2_750c_GDEM075F52
 #define DISPLAY_CLASS_ARGUMENTS (GxEPD2_750c_GDEM075F52(CS_PIN, DC_PIN, RST_PIN, BUSY_PIN))
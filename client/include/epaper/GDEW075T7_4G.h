@@ -0,0 +1,10 @@
+// Display is 800x480 B/W, driven with 4 grey levels
+// GoodDisplay GDEW075T7 800x480 (EK79655 / GD7965), see GDEW075T7_BW.h
+// Needs the GxEPD2_4G library instead of GxEPD2, the class template is chosen in hw_config.h
+
+#define DISPLAY_WIDTH 800
+#define DISPLAY_HEIGHT 480
+#define DISPLAY_TYPE_4G
+
+#define DISPLAY_DRIVER_CLASS GxEPD2_750_T7
+#define DISPLAY_CLASS_ARGUMENTS (GxEPD2_750_T7(CS_PIN, DC_PIN, RST_PIN, BUSY_PIN))
@@ -7,5 +7,6 @@
 #define DISPLAY_HEIGHT 480
 #define DISPLAY_TYPE_BW
 
-#define DISPLAY_CLASS_TYPE GxEPD2_BW<GxEPD2_750_T7, GxEPD2_750_T7::HEIGHT / SPLIT_DISPLAY_INTO_N_PAGES>
+#define DISPLAY_CLASS_TEMPLATE GxEPD2_BW
+#define DISPLAY_DRIVER_CLASS GxEPD2_750_T7
 #define DISPLAY_CLASS_ARGUMENTS (GxEPD2_750_T7(CS_PIN, DC_PIN, RST_PIN, BUSY_PIN))
@@ -1,7 +1,8 @@
 // 7.5" 3C 800x480 B/W/R
 // https://www.aliexpress.com/item/1005005121813674.html
 
-#define DISPLAY_CLASS_TYPE GxEPD2_3C<GxEPD2_750c_Z08, GxEPD2_750c_Z08::HEIGHT / SPLIT_DISPLAY_INTO_N_PAGES>
+#define DISPLAY_CLASS_TEMPLATE GxEPD2_3C
+#define DISPLAY_DRIVER_CLASS GxEPD2_750c_Z08
 #define DISPLAY_CLASS_ARGUMENTS (GxEPD2_750c_Z08(CS_PIN, DC_PIN, RST_PIN, BUSY_PIN))
 
 #define DISPLAY_WIDTH 800
@@ -0,0 +1,10 @@
+// ePaper board: GoodDisplay GDEY073D46 7.3" 7-color (ACeP) 800x480
+// https://www.good-display.com/product/442.html
+
+#define DISPLAY_WIDTH 800
+#define DISPLAY_HEIGHT 480
+#define DISPLAY_TYPE_7C
+
+#define DISPLAY_CLASS_TEMPLATE GxEPD2_7C
+#define DISPLAY_DRIVER_CLASS GxEPD2_730c_GDEY073D46
+#define DISPLAY_CLASS_ARGUMENTS (GxEPD2_730c_GDEY073D46(CS_PIN, DC_PIN, RST_PIN, BUSY_PIN))
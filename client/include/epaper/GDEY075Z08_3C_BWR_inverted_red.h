@@ -2,7 +2,8 @@
 // "SUNMAXIC 7.5 inch Electronic Paper Ink Screen 800x480 Resolution Black And White EPD E-Paper UC8179 Driver SPI Interface 24Pin"
 // https://www.aliexpress.com/item/1005007175851007.html
 
-#define DISPLAY_CLASS_TYPE GxEPD2_3C<GxEPD2_750c_GDEY075Z08_inverted, GxEPD2_750c_GDEY075Z08_inverted::HEIGHT / SPLIT_DISPLAY_INTO_N_PAGES>
+#define DISPLAY_CLASS_TEMPLATE GxEPD2_3C
+#define DISPLAY_DRIVER_CLASS GxEPD2_750c_GDEY075Z08_inverted
 #define DISPLAY_CLASS_ARGUMENTS (GxEPD2_750c_GDEY075Z08_inverted(CS_PIN, DC_PIN, RST_PIN, BUSY_PIN))
 
 #define DISPLAY_WIDTH 800
@@ -0,0 +1,42 @@
+#ifndef ERROR_SCREENS_H
+#define ERROR_SCREENS_H
+
+#include <stdint.h>
+
+#include "hw_config.h"
+
+// Fixed texts of the common error screens. They are pre-rendered at build time for every display size and rotation by
+// tools/error_screens/generate_error_screens.py, which reads this list, so keep one X(id, "text") entry per line.
+// Variable details (voltage, HTTP code, the retry time) are printed into a band of ERROR_SCREEN_BAND_LINES lines below the text.
+#define ERROR_SCREEN_LIST(X)                                                                                     \
+  X(ERROR_SCREEN_WIFI, "WiFi connect/login unsuccessful.")                                                       \
+  X(ERROR_SCREEN_WATCHDOG, "Watchdog issue. Please report this to the developer.")                               \
+  X(ERROR_SCREEN_LOW_BATTERY, "Battery voltage too low.\nPlease charge the battery and try again.")              \
+  X(ERROR_SCREEN_NO_SERVER, "mDNS is enabled but no server found on LAN.\n\nEnsure that the server is running\non the same network as this device.") \
+  X(ERROR_SCREEN_CONFIG_FAILED, "Failed to load config from the server.")                                        \
+  X(ERROR_SCREEN_DOWNLOAD_FAILED, "Failed to download image after all attempts.")
+
+#define ERROR_SCREEN_BAND_LINES 4
+
+enum ErrorScreen {
+#define ERROR_SCREEN_ENUM(id, text) id,
+  ERROR_SCREEN_LIST(ERROR_SCREEN_ENUM)
+#undef ERROR_SCREEN_ENUM
+  ERROR_SCREEN_COUNT,
+  ERROR_SCREEN_NONE = ERROR_SCREEN_COUNT  // free text, laid out at runtime
+};
+
+// Screen in the native orientation of the panel, one bit per pixel (1 = black) like a BW frame from the server. Every row is
+// a little-endian uint16 length followed by the PackBits-compressed row (as in the frame schedule file), 0 for a white row.
+struct PrerenderedErrorScreen {
+  const uint8_t* rows;
+  uint32_t size;
+  int16_t bandBaseline;  // of the first band line, in the rotated coordinates
+};
+
+const char* errorScreenText(ErrorScreen screen);
+
+// nullptr if the screen hasn't been pre-rendered for this display size and rotation
+const PrerenderedErrorScreen* prerenderedErrorScreen(ErrorScreen screen);
+
+#endif  // ERROR_SCREENS_H
@@ -0,0 +1,20 @@
+#ifndef FRAME_HASH_H
+#define FRAME_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 64-bit FNV-1a of the pixel rows of a frame, in the format sent by the server. The server's checksum changes whenever it
+// regenerates the frame, this one only when the pixels do, so it tells whether a panel refresh would change anything.
+// The server computes it the same way and sends it in the header of a v3 bitmap.
+
+// Hash of no rows, the start value
+#define FRAME_HASH_INIT 0xcbf29ce484222325ULL
+
+// Hash of the panel content when it's not known (after a reset or an error screen), never matches a frame
+#define FRAME_HASH_UNKNOWN 0ULL
+
+// Adds one row to the hash, rows have to be added in order
+uint64_t frameHashAddRow(uint64_t hash, const uint8_t* data, size_t len);
+
+#endif  // FRAME_HASH_H
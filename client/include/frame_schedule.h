@@ -0,0 +1,73 @@
+#ifndef FRAME_SCHEDULE_H
+#define FRAME_SCHEDULE_H
+
+#include <Arduino.h>
+
+#include "hw_config.h"
+
+#ifdef USE_FRAME_SCHEDULE
+#include <LittleFS.h>
+#endif
+
+// Never ask the server for more frames than this, the index is kept in RAM
+#define FRAME_SCHEDULE_MAX_FRAMES 24
+
+// Forward declarations
+class Logger;
+class ServiceTicker;
+class DisplayManager;
+class FrameStore;
+class PartialRefresh;
+class SleepTimer;
+
+struct FrameScheduleEntry {
+  uint32_t displayAt;  // unix time
+  uint32_t offset;     // position of the first row in the file
+  char checksum[64 + 1];
+};
+
+// Frames for the upcoming scheduled wakeups, rendered by the server in advance and kept PackBits-compressed in flash
+// (LittleFS, mounted through the FrameStore). A wakeup which finds its frame here shows it and goes back to sleep without
+// touching WiFi. The device connects to the server again only when the schedule runs out, when it's no longer valid or when
+// the clock can't be trusted (after a reset).
+class FrameSchedule {
+ private:
+  Logger& logger;
+  ServiceTicker& serviceTicker;
+  DisplayManager& displayManager;
+  FrameStore& frameStore;
+  PartialRefresh& partialRefresh;
+  SleepTimer& sleepTimer;
+  int& sleepTime;
+  char* lastChecksum;
+  uint64_t& displayedFrameHash;
+
+  uint16_t count;
+  uint16_t framesWritten;
+  uint32_t validUntil;
+  uint16_t rowBytes;
+  FrameScheduleEntry entries[FRAME_SCHEDULE_MAX_FRAMES];
+#ifdef USE_FRAME_SCHEDULE
+  File writeFile;
+#endif
+
+  bool loadIndex();
+  bool drawFrame(int index);
+
+ public:
+  FrameSchedule(Logger& logger, ServiceTicker& serviceTicker, DisplayManager& displayManager, FrameStore& frameStore, PartialRefresh& partialRefresh,
+                SleepTimer& sleepTimer, int& sleepTime, char* lastChecksum, uint64_t& displayedFrameHash);
+
+  // Shows the frame which is due now (unless it's already on the panel) and sets the sleep time until the next one.
+  // Returns false if the server has to be contacted instead.
+  bool showDueFrame();
+  void clear();
+
+  bool beginWrite(uint16_t count, uint32_t validUntil, uint16_t rowBytes);
+  bool beginFrame(uint32_t displayAt, const char* checksum);
+  bool writeRow(const uint8_t* data);
+  bool commit();
+  void abort();
+};
+
+#endif  // FRAME_SCHEDULE_H
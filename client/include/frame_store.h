@@ -0,0 +1,56 @@
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include <Arduino.h>
+
+#include "hw_config.h"
+
+#ifdef USE_FRAME_STORE
+#include <LittleFS.h>
+#endif
+
+// Forward declarations
+class Logger;
+
+// Copy of the frame which is currently shown on the panel, kept in flash (LittleFS on the "spiffs" data partition) so that
+// it survives power loss, brownouts and OTA reboots. The frame is stored exactly as received from the server (packed rows)
+// together with its checksum. A new frame is written into a temporary file and atomically renamed over the old one only
+// after the panel has been refreshed successfully.
+class FrameStore {
+ private:
+  Logger& logger;
+  bool mounted;
+#ifdef USE_FRAME_STORE
+  File writeFile;
+  File readFile;
+#endif
+  uint16_t rowBytes;
+
+ public:
+  FrameStore(Logger& logger);
+
+  bool begin();
+  void end();
+
+  // Checksum of the stored frame, empty string if there is none
+  bool loadChecksum(char* checksum, size_t size);
+  void invalidate();
+  // Gives the stored frame a new checksum if it's still the one with oldChecksum (regenerated on the server with the same
+  // pixels), so that it keeps matching lastChecksum
+  bool retag(const char* oldChecksum, const char* newChecksum);
+
+  bool beginWrite(uint16_t rowBytes);
+  bool writeRow(uint16_t row, const uint8_t* data);
+  bool commit(const char* checksum);
+  void abort();
+  // All rows of the frame being written are there, none of the writes failed
+  bool pendingComplete();
+  // Reads back a row of the frame being written (before commit)
+  bool readPendingRow(uint16_t row, uint8_t* data);
+
+  bool beginRead();
+  bool readRow(uint16_t row, uint8_t* data);
+  void endRead();
+};
+
+#endif  // FRAME_STORE_H
@@ -5,47 +5,103 @@
 #include <HTTPClient.h>
 #include <WiFi.h>
 
+#include "error_screens.h"
 #include "hw_config.h"
 
 #define SLEEP_TIME_DEFAULT (SECONDS_PER_MINUTE * 5)
 #define SLEEP_TIME_TEMPORARY_ERROR (SECONDS_PER_MINUTE * 5)
 #define SLEEP_TIME_PERMANENT_ERROR (SECONDS_PER_HOUR * 1)
 
+// Upper limit for the sleep requested by the server (define in board.h to override)
+#ifndef SLEEP_TIME_MAX
+#define SLEEP_TIME_MAX (SECONDS_PER_HOUR * 24)
+#endif
+
 // Forward declarations
 class Logger;
-class WDTManager;
+class ServiceTicker;
 class OTAManager;
+class PowerManager;
 class VoltageReader;
+class BatteryModel;
 class SystemInfo;
+class MemoryProfiler;
+class TlsClient;
 class DisplayManager;
+class FrameStore;
+class PartialRefresh;
+class RefreshScheduler;
+class FrameSchedule;
+
+// Where _displayPartialPageFromWeb() puts the downloaded rows
+enum BitmapRowTarget {
+  BITMAP_ROWS_TO_DISPLAY,
+  BITMAP_ROWS_TO_PARTIAL_REFRESH,  // drawn later, once it's known which rows changed
+  BITMAP_ROWS_TO_FRAME_STORE,      // drawn later by showPendingFrame(), see USE_DEFERRED_REFRESH
+};
+
+// Frame downloaded into the frame store and waiting for showPendingFrame()
+enum PendingFrame {
+  PENDING_FRAME_NONE,
+  PENDING_FRAME_FULL,
+  PENDING_FRAME_PARTIAL,
+};
 
 class HTTPClientManager {
  private:
   Logger& logger;
-  WDTManager& wdtManager;
+  ServiceTicker& serviceTicker;
   OTAManager& otaManager;
+  PowerManager& powerManager;
   VoltageReader& voltageReader;
+  BatteryModel& batteryModel;
   SystemInfo& systemInfo;
+  MemoryProfiler& memoryProfiler;
+  TlsClient& tlsClient;
   DisplayManager& displayManager;
+  FrameStore& frameStore;
+  PartialRefresh& partialRefresh;
+  RefreshScheduler& refreshScheduler;
+  FrameSchedule& frameSchedule;
 
   int& sleepTime;
   char* lastChecksum;
+  uint64_t& displayedFrameHash;
+  uint64_t downloadedFrameHash = 0;
+  bool& staticTelemetrySent;
   const char* defined_color_type;
   String serverUrl = "";
+  int scheduleFrameCount = 0;
+  String firmwareVersion = "";
+  size_t firmwareSize = 0;
+  String firmwareSha256 = "";
+  PendingFrame pendingFrame = PENDING_FRAME_NONE;
+  String pendingChecksum = "";
 
   String statusCodeAsString(int statusCode);
   int readLineFromStream(WiFiClient* stream, String& result);
-  int _displayPartialPageFromWeb(String& newChecksum);
+  int _readBitmapRow(WiFiClient* stream, uint8_t encoding, unsigned char* row, int rowBytes);
+  int _displayPartialPageFromWeb(String& newChecksum, bool storeRows, BitmapRowTarget rowTarget = BITMAP_ROWS_TO_DISPLAY);
+  int _showBitmapWithPartialRefresh(String& newChecksum);
+  int _downloadDeferredBitmap(String& newChecksum);
+  bool _drawPendingFrame();
   bool _verifyConfig();
+  void _beginRequest(HTTPClient& http, const String& url);
 
  public:
-  HTTPClientManager(Logger& logger, WDTManager& wdtManager, OTAManager& otaManager, VoltageReader& voltageReader, SystemInfo& systemInfo,
-                    DisplayManager& displayManager, int& sleepTime, char* lastChecksum, const char* defined_color_type);
+  HTTPClientManager(Logger& logger, ServiceTicker& serviceTicker, OTAManager& otaManager, PowerManager& powerManager, VoltageReader& voltageReader,
+                    BatteryModel& batteryModel, SystemInfo& systemInfo, MemoryProfiler& memoryProfiler, TlsClient& tlsClient, DisplayManager& displayManager, FrameStore& frameStore,
+                    PartialRefresh& partialRefresh, RefreshScheduler& refreshScheduler, FrameSchedule& frameSchedule, int& sleepTime, char* lastChecksum, uint64_t& displayedFrameHash, bool& staticTelemetrySent, const char* defined_color_type);
 
   String lastErrorMessage = "";
+  ErrorScreen lastErrorScreen = ERROR_SCREEN_NONE;  // lastErrorMessage is then only the details of the screen
   void init();
-  bool loadConfigFromWeb(uint32_t& configLoadTime, bool& otaMode);
+  bool loadConfigFromWeb(uint32_t& configLoadTime, bool& otaMode, uint32_t& serverTime);
   bool showRawBitmapFromWeb();
+  // Refreshes the panel with the frame left in the frame store by showRawBitmapFromWeb(), meant to be called with WiFi off
+  bool showPendingFrame();
+  bool loadFrameScheduleFromWeb();
+  bool updateFirmwareFromWeb();
 };
 
 #endif  // HTTP_CLIENT_MANAGER_H
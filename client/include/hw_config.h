@@ -13,6 +13,11 @@
 #define DISPLAY_ROTATION 1
 #endif
 
+// The display object is created at runtime (see DisplayManager::init()) and used through the GxEPD2_GFX base class
+#ifndef ENABLE_GxEPD2_GFX
+#define ENABLE_GxEPD2_GFX 1
+#endif
+
 // Include the correct GxEPD2 header file based on the display type defined in board.h and set the corresponding color type and bits per pixel (BPP) for bitmap
 // handling.
 #ifdef DISPLAY_TYPE_BW
@@ -30,14 +35,115 @@
 #include <GxEPD2_4C.h>
 #endif
 
-// TODO
-// #ifdef DISPLAY_TYPE_GRAYSCALE
-// #define DISPLAY_COLOR_TYPE_AS_STRING "4G"
-// #ifdef USE_GRAYSCALE_BW_DISPLAY
-// #include <GxEPD2_4G_BW.h>
-// #else
-// #include <GxEPD2_4G_4G.h>
-// #endif
-// #endif
+// 4 grey levels, needs the GxEPD2_4G library instead of GxEPD2. Define USE_GRAYSCALE_BW_DISPLAY in board.h to give the page
+// buffer (only used for text screens, see USE_DIRECT_FRAME_WRITE) 1 bit per pixel instead of 2 and save half of its RAM.
+#ifdef DISPLAY_TYPE_4G
+#define DISPLAY_COLOR_TYPE_AS_STRING "4G"
+#ifdef USE_GRAYSCALE_BW_DISPLAY
+#include <GxEPD2_4G_BW.h>
+#define DISPLAY_CLASS_TEMPLATE GxEPD2_4G_BW
+#else
+#include <GxEPD2_4G_4G.h>
+#define DISPLAY_CLASS_TEMPLATE GxEPD2_4G_4G
+#endif
+#endif
+
+#ifdef DISPLAY_TYPE_7C
+#define DISPLAY_COLOR_TYPE_AS_STRING "7C"
+#include <GxEPD2_7C.h>
+#endif
+
+// Frames of the 4G and 7C panels bypass the page buffer: the rows are converted to the controller's native format and
+// written straight into its memory in a single pass. The page buffer is left for the text screens, so it can be split into
+// more (smaller) pages.
+#if defined(DISPLAY_TYPE_4G) || defined(DISPLAY_TYPE_7C)
+#define USE_DIRECT_FRAME_WRITE
+#ifndef SPLIT_DISPLAY_INTO_N_PAGES
+#define SPLIT_DISPLAY_INTO_N_PAGES 8
+#endif
+#endif
+
+// GxEPD2 display class with the frame split into `pages` pages. The page buffer is a member of the class, each page is drawn
+// separately and the content has to be drawn again for every one of them.
+#define DISPLAY_CLASS_TYPE_WITH_PAGES(pages) DISPLAY_CLASS_TEMPLATE<DISPLAY_DRIVER_CLASS, DISPLAY_DRIVER_CLASS::HEIGHT / (pages)>
+
+// Boards with PSRAM always use a single full-frame page there. This is the fallback for the internal RAM.
+#ifndef SPLIT_DISPLAY_INTO_N_PAGES
+#define SPLIT_DISPLAY_INTO_N_PAGES 2
+#endif
+
+// Paged displays keep the rows of the first page PackBits-compressed in the heap and draw the following pages from there
+// instead of downloading the frame again. Define NO_COMPRESSED_FRAME in board.h to disable it.
+#ifndef NO_COMPRESSED_FRAME
+#define USE_COMPRESSED_FRAME
+#endif
+
+// Keep a copy of the currently displayed frame in flash (LittleFS) so that a reset or power loss doesn't force a redraw.
+// Define NO_FRAME_STORE in board.h to disable it.
+#ifndef NO_FRAME_STORE
+#define USE_FRAME_STORE
+#endif
+
+// Show frames pre-fetched from the server on the following wakeups without connecting to WiFi (needs the frame store).
+// It's enabled per display on the server side, define NO_FRAME_SCHEDULE in board.h to remove it from the firmware.
+#if defined(USE_FRAME_STORE) && !defined(NO_FRAME_SCHEDULE)
+#define USE_FRAME_SCHEDULE
+#endif
+
+// Download firmware updates advertised by the server during a normal wakeup (zlib-compressed, verified by SHA-256).
+// Define NO_PULL_OTA in board.h to disable it.
+#ifndef NO_PULL_OTA
+#define USE_PULL_OTA
+#endif
+
+// Refresh only the changed parts of the panel, found by comparing the new frame with the stored one. Used on black and
+// white panels with a fast partial update, define NO_PARTIAL_REFRESH in board.h to disable it.
+#if defined(USE_FRAME_STORE) && defined(DISPLAY_TYPE_BW) && !defined(NO_PARTIAL_REFRESH)
+#define USE_PARTIAL_REFRESH
+#endif
+
+// Receive and validate the whole frame into the frame store before touching the panel, switch WiFi off and only then
+// refresh it from the stored rows. The radio isn't on during the refresh (so its log lines only reach the serial port) and a
+// failed download never gets onto the panel. Define NO_DEFERRED_REFRESH in board.h to draw the rows while they arrive instead.
+#if defined(USE_FRAME_STORE) && !defined(NO_DEFERRED_REFRESH)
+#define USE_DEFERRED_REFRESH
+#endif
+
+// Sleep longer and skip optional work (firmware updates, frame schedule) as the battery runs low, see BatteryModel.
+// Needs the battery voltage, define NO_BATTERY_POLICY in board.h to disable it.
+#if defined(VOLTAGE_ADC_PIN) && !defined(NO_BATTERY_POLICY)
+#define USE_BATTERY_POLICY
+#endif
+
+// Run the phases of a wakeup (network, drawing, panel refresh) at their own CPU clock and WiFi power save mode, see
+// PowerManager. Define NO_POWER_GOVERNOR in board.h to keep the boot clock and the default power save for the whole wakeup.
+#ifndef NO_POWER_GOVERNOR
+#define USE_POWER_GOVERNOR
+#endif
+
+// Draw the common error screens from bitmaps pre-rendered at build time (tools/error_screens/generate_error_screens.py runs
+// as a PlatformIO pre-build script) instead of laying out the text at runtime, see error_screens.h. Define
+// NO_PRERENDERED_ERROR_SCREENS in board.h to disable it.
+#if !defined(NO_PRERENDERED_ERROR_SCREENS) && __has_include("generated/error_screens_data.h")
+#define USE_PRERENDERED_ERROR_SCREENS
+#endif
+
+// Start the display, ArduinoOTA (with mDNS) and the serial port on their first use instead of in setup(), so that a wakeup
+// which finds the same frame on the server doesn't pay for them. Define NO_FAST_BOOT in board.h to start everything at boot.
+#ifndef NO_FAST_BOOT
+#define USE_FAST_BOOT
+#endif
+
+// Talk to the server over HTTPS (define CALENDAR_URL_HTTPS in board.h, the port is then usually 443). The TLS session is
+// cached across deep sleep so that most wakeups only need an abbreviated handshake, see TlsClient.
+#ifdef CALENDAR_URL_HTTPS
+#define USE_HTTPS
+#endif
+
+// Sample the free heap, the largest free block, PSRAM and the stack high-water marks at the points of a wakeup and report the
+// minima of the previous wakeup with the telemetry, see MemoryProfiler. Define NO_MEMORY_PROFILER in board.h to disable it.
+#ifndef NO_MEMORY_PROFILER
+#define USE_MEMORY_PROFILER
+#endif
 
 #define DISPLAY_BUFFER_SIZE (DISPLAY_WIDTH * BITMAP_BPP / 8)
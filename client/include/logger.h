@@ -17,6 +17,10 @@ class Logger {
   bool syslogEnabled;
 #endif
   bool debugEnabled;
+  bool serialStarted;
+  bool serialConnected;
+
+  bool serialReady();
 
  public:
 #ifdef SYSLOG_SERVER
@@ -28,6 +32,7 @@ class Logger {
   void debug(const char* format, ...);
   void trace(const char* format, ...);
 
+  void beginSerial();
   void setEnabled(bool enable);
   bool isEnabled() const;
 };
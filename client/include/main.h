@@ -1,15 +1,20 @@
 #include <Adafruit_GFX.h>
 
+#include "error_screens.h"
+
 // fonts
 #include "fonts/DejaVu_Sans_Mono_16.h"
 #include "fonts/Open_Sans_Regular_16.h"
 #include "fonts/Open_Sans_Regular_24.h"
 
 void minimalHardwareInit();
-void wakeupDisplayAndConnectWiFi();
+void wakeupDisplay();
+void readBattery();
+void connectWiFi();
 
+void showPendingFrameWithWiFiOff();
 void disconnectWiFiAndHibernateAll();
-void showErrorOnDisplay(String message);
+void showErrorOnDisplay(ErrorScreen screen, String details = "");
 
 void logRuntimeStats();
 
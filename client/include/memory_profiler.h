@@ -0,0 +1,61 @@
+#ifndef MEMORY_PROFILER_H
+#define MEMORY_PROFILER_H
+
+#include <Arduino.h>
+
+#include "hw_config.h"
+
+// Points of a wakeup where the memory is sampled
+enum MemoryPoint : uint8_t {
+  MEMORY_POINT_BOOT = 0,     // before anything is allocated
+  MEMORY_POINT_NETWORK = 1,  // WiFi connected, config loaded
+  MEMORY_POINT_FRAME = 2,    // frame downloaded and drawn, the display buffer and the HTTP client still allocated
+  MEMORY_POINT_SLEEP = 3,    // right before the deep sleep
+  MEMORY_POINT_COUNT
+};
+
+// Lowest values seen during a wakeup. The free heap and PSRAM and the stacks are high-water marks kept by ESP-IDF and
+// FreeRTOS, so they include the peaks between the samples. The largest free block is only known at the samples.
+struct MemoryMinima {
+  uint32_t freeHeap;      // internal RAM, bytes
+  uint32_t largestBlock;  // largest allocatable block of the internal RAM, bytes
+  uint32_t freePsram;     // 0 without PSRAM
+  uint32_t loopStack;     // unused stack of the Arduino loop task, bytes
+  uint32_t tcpipStack;    // unused stack of the lwIP task, bytes (0 = not running)
+};
+
+// Kept in RTC memory (survives deep sleep, but not a reset or power loss)
+struct MemoryProfilerState {
+  bool valid;            // minima has been filled
+  MemoryMinima minima;   // of all wakeups since the last telemetry
+};
+
+// Forward declarations
+class Logger;
+
+// Samples the memory at the points of a wakeup and keeps the minima of the past wakeups for the telemetry. The telemetry
+// is sent before the frame is downloaded, so the minima of the current wakeup wouldn't include the largest allocations
+// (display buffer, row buffers, JSON documents) yet. The minima accumulate over all wakeups until they're sent, so the
+// offline ones (frame schedule) in between don't hide the wakeup which did the download.
+class MemoryProfiler {
+ private:
+  Logger& logger;
+  MemoryProfilerState& state;
+  MemoryMinima current;
+
+  static uint32_t taskStackHighWaterMark(const char* name);
+
+ public:
+  MemoryProfiler(Logger& logger, MemoryProfilerState& state);
+
+  void sample(MemoryPoint point);
+  // Adds the minima of this wakeup to the ones waiting for the telemetry
+  void endWake();
+
+  bool hasMinima() { return state.valid; }
+  const MemoryMinima& minima() { return state.minima; }
+  // The server has the minima, the following wakeups start over
+  void minimaSent() { state.valid = false; }
+};
+
+#endif  // MEMORY_PROFILER_H
@@ -1,20 +1,41 @@
 #ifndef OTA_MANAGER_H
 #define OTA_MANAGER_H
 
+#include <Arduino.h>
+
 // Forward declarations
 class Logger;
 class WDTManager;
+struct PullUpdateState;
 
+// Push updates from the Arduino IDE/PlatformIO (ArduinoOTA, only in the OTA debug mode) and pull updates downloaded from the
+// server during a normal wakeup. A pulled image is zlib-compressed, it's inflated chunk by chunk straight into the inactive
+// OTA partition and becomes the boot partition only if its size and SHA-256 match what the server advertised.
 class OTAManager {
  private:
   Logger& logger;
   WDTManager& wdtManager;
+  PullUpdateState* pull;
+  bool started;
+
+  bool flushInflated(const uint8_t* data, size_t size);
 
  public:
   OTAManager(Logger& logger, WDTManager& wdtManager);
-  
+
+  // Starts ArduinoOTA and mDNS, does nothing if they are already running
   void init();
   void loop();
+
+  // The SHA-256 of the last image downloaded in full (installed or rejected) is kept in NVS, survives the restart into
+  // the new firmware. The same image is never flashed again, even if the server keeps offering it.
+  bool isLastPullImage(const char* sha256);
+  void rememberPullImage(const char* sha256);
+
+  bool beginPullUpdate(size_t imageSize, const char* sha256);
+  bool writePullUpdate(const uint8_t* data, size_t size);
+  bool finishPullUpdate();
+  void abortPullUpdate();
 };
 
 #endif  // OTA_MANAGER_H
@@ -0,0 +1,22 @@
+#ifndef PACKBITS_H
+#define PACKBITS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// PackBits run-length coding (as used by TIFF/MacPaint). E-paper frames are mostly long runs of white, so a packed row is
+// typically a few bytes long. Each chunk starts with a header byte n:
+//   0..127   -> n + 1 literal bytes follow
+//   -127..-1 -> the next byte is repeated 1 - n times
+//   -128     -> no-op (never produced by the encoder)
+
+// Worst case size of an encoded buffer (incompressible data costs one header byte per 128 bytes)
+#define PACKBITS_MAX_ENCODED_SIZE(len) ((len) + ((len) + 127) / 128)
+
+// Encodes `len` bytes from `src` into `dst` (which must hold PACKBITS_MAX_ENCODED_SIZE(len) bytes), returns the encoded size
+size_t packbitsEncode(const uint8_t* src, size_t len, uint8_t* dst);
+
+// Decodes `srcLen` bytes into exactly `dstLen` bytes, returns false if the input is corrupted or of a different size
+bool packbitsDecode(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen);
+
+#endif  // PACKBITS_H
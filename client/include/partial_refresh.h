@@ -0,0 +1,78 @@
+#ifndef PARTIAL_REFRESH_H
+#define PARTIAL_REFRESH_H
+
+#include <Arduino.h>
+
+#include "hw_config.h"
+
+// Dirty rows closer than this are refreshed together, every partial refresh has a fixed overhead of its own
+#ifndef PARTIAL_REFRESH_BAND_GAP
+#define PARTIAL_REFRESH_BAND_GAP 16
+#endif
+
+// More bands than this are merged into the last one
+#ifndef PARTIAL_REFRESH_MAX_BANDS
+#define PARTIAL_REFRESH_MAX_BANDS 4
+#endif
+
+// A frame which changed in more than this part of its rows is refreshed as a whole (still with the fast waveform)
+#ifndef PARTIAL_REFRESH_MAX_DIRTY_PERCENT
+#define PARTIAL_REFRESH_MAX_DIRTY_PERCENT 60
+#endif
+
+// Forward declarations
+class Logger;
+class ServiceTicker;
+class DisplayManager;
+class FrameStore;
+class RefreshScheduler;
+
+// Rectangle of the panel which differs from the displayed frame, in rows and whole bytes of a row
+struct DirtyBand {
+  uint16_t top;
+  uint16_t bottom;  // exclusive
+  uint16_t left;
+  uint16_t right;  // exclusive
+};
+
+// Refreshes only the parts of the panel which changed. The new frame is written into the frame store first and every row
+// is compared with the displayed one (the stored frame) on the way, which gives a list of dirty bands. Each band is then
+// refreshed through a partial window, so the refresh time and the flashing scale with the size of the change.
+//
+// The panel controller loses its memory while the board sleeps, the partial waveforms need the previous content though.
+// It's written back from the stored frame before every band. The RefreshScheduler decides when the panel needs a clean
+// full refresh instead.
+class PartialRefresh {
+ private:
+  Logger& logger;
+  ServiceTicker& serviceTicker;
+  DisplayManager& displayManager;
+  FrameStore& frameStore;
+  RefreshScheduler& refreshScheduler;
+  char* lastChecksum;
+
+  uint16_t rowBytes;
+  bool active;
+  bool opened;  // frame store files
+  DirtyBand bands[PARTIAL_REFRESH_MAX_BANDS];
+  uint8_t bandCount;
+  uint16_t dirtyRows;
+
+  void markDirty(uint16_t row, uint16_t left, uint16_t right);
+  bool drawBand(const DirtyBand& band);
+  bool drawFullFrame();
+
+ public:
+  PartialRefresh(Logger& logger, ServiceTicker& serviceTicker, DisplayManager& displayManager, FrameStore& frameStore, RefreshScheduler& refreshScheduler,
+                 char* lastChecksum);
+
+  // Prepares for a new frame, which is written into the frame store as its rows are added. Returns false if the panel or the
+  // stored frame don't allow a partial refresh, the caller draws the frame the usual way then.
+  bool begin(uint16_t rowBytes);
+  bool addRow(uint16_t row, const uint8_t* data);
+  // Shows the new frame (all rows added), the caller commits it into the frame store afterwards
+  bool show();
+  void abort();
+};
+
+#endif  // PARTIAL_REFRESH_H
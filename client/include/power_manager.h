@@ -0,0 +1,122 @@
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#if CONFIG_PM_ENABLE
+#include <esp_pm.h>
+#endif
+
+#include "hw_config.h"
+
+// CPU clock of the individual wake phases in MHz, limited to the clock the board boots with (define in board.h to override)
+#ifndef POWER_CPU_MHZ_COMPUTE
+#define POWER_CPU_MHZ_COMPUTE 240
+#endif
+#ifndef POWER_CPU_MHZ_NETWORK
+#define POWER_CPU_MHZ_NETWORK 80
+#endif
+#ifndef POWER_CPU_MHZ_REFRESH
+#define POWER_CPU_MHZ_REFRESH 80
+#endif
+// Clock while blocked on a socket in any phase. 80 MHz is the lowest one which keeps APB (and so UART and WiFi) clocks stable.
+#ifndef POWER_CPU_MHZ_IDLE
+#define POWER_CPU_MHZ_IDLE 80
+#endif
+
+// WiFi power save of the phases: WIFI_PS_NONE (radio always listening), WIFI_PS_MIN_MODEM (wakes up for every DTIM beacon,
+// the Arduino default) or WIFI_PS_MAX_MODEM (wakes up every listen interval, slow to answer). Define in board.h to override.
+#ifndef POWER_WIFI_PS_COMPUTE
+#define POWER_WIFI_PS_COMPUTE WIFI_PS_NONE  // bulk downloads of frames and firmware
+#endif
+#ifndef POWER_WIFI_PS_NETWORK
+#define POWER_WIFI_PS_NETWORK WIFI_PS_MIN_MODEM
+#endif
+#ifndef POWER_WIFI_PS_REFRESH
+#define POWER_WIFI_PS_REFRESH WIFI_PS_MAX_MODEM
+#endif
+// Define POWER_WIFI_TX_POWER in board.h (e.g. WIFI_POWER_11dBm) to lower the transmit power if the access point is close
+
+// Estimated currents of the board for the energy report (define in board.h to override). The CPU draws
+// POWER_CURRENT_BASE_MA + POWER_CURRENT_PER_MHZ_UA * MHz, the radio adds the current of its power save mode.
+#ifndef POWER_CURRENT_BASE_MA
+#define POWER_CURRENT_BASE_MA 10
+#endif
+#ifndef POWER_CURRENT_PER_MHZ_UA
+#define POWER_CURRENT_PER_MHZ_UA 180
+#endif
+#ifndef POWER_CURRENT_WIFI_PS_NONE_MA
+#define POWER_CURRENT_WIFI_PS_NONE_MA 80
+#endif
+#ifndef POWER_CURRENT_WIFI_PS_MIN_MODEM_MA
+#define POWER_CURRENT_WIFI_PS_MIN_MODEM_MA 30
+#endif
+#ifndef POWER_CURRENT_WIFI_PS_MAX_MODEM_MA
+#define POWER_CURRENT_WIFI_PS_MAX_MODEM_MA 10
+#endif
+#ifndef POWER_CURRENT_PANEL_REFRESH_MA
+#define POWER_CURRENT_PANEL_REFRESH_MA 8
+#endif
+
+// Forward declarations
+class Logger;
+
+enum PowerPhase {
+  POWER_PHASE_COMPUTE,  // boot, decoding and drawing frames, SPI, flash, bulk downloads
+  POWER_PHASE_NETWORK,  // WiFi connection and small requests, mostly waiting for the server
+  POWER_PHASE_REFRESH,  // waiting while the panel is BUSY
+  POWER_PHASE_COUNT
+};
+
+// Runs every phase of a wakeup at its own CPU clock and WiFi power save mode (USE_POWER_GOVERNOR) and clocks the CPU down
+// while waiting for the network. If ESP-IDF power management is available the clock is scaled by its lock instead (and
+// automatic light sleep is entered if the SDK has been built with tickless idle).
+// The time and estimated charge of each phase are accounted for the battery model and logged at the end of the wakeup.
+class PowerManager {
+ private:
+  Logger& logger;
+  bool enabled;
+  int idleDepth;
+#if CONFIG_PM_ENABLE
+  esp_pm_lock_handle_t busyLock;
+  bool lockHeld;
+#endif
+  PowerPhase phase;
+  PowerPhase phaseBeforeRefresh;
+  uint32_t maxMhz;
+  uint32_t cpuMhz;
+  bool wifiOn;
+  wifi_ps_type_t wifiPs;
+
+  uint32_t accountedUntil;
+  uint32_t phaseMs[POWER_PHASE_COUNT];
+  float phaseMaMs[POWER_PHASE_COUNT];
+  float baselineMaMs;
+
+  static float currentMa(uint32_t mhz, bool wifiOn, wifi_ps_type_t wifiPs, bool refresh);
+  void account();
+  uint32_t targetMhz();
+  void setClock(uint32_t mhz);
+  void apply();
+
+ public:
+  PowerManager(Logger& logger);
+
+  void begin();
+  void init();
+  void setPhase(PowerPhase newPhase);
+  // The radio stays on until wifiStopped() or the deep sleep
+  void wifiStarted();
+  void wifiStopped();
+  void idleWaitBegin();
+  void idleWaitEnd();
+  // Called repeatedly while the panel is busy, the previous phase is restored by refreshWaitEnd()
+  void refreshWaitBegin();
+  void refreshWaitEnd();
+
+  float wakeMah();
+  void logStats();
+};
+
+#endif  // POWER_MANAGER_H
@@ -0,0 +1,44 @@
+#ifndef REFRESH_SCHEDULER_H
+#define REFRESH_SCHEDULER_H
+
+#include <Arduino.h>
+
+#include "hw_config.h"
+
+// Fast refreshes allowed between two clean ones, unless the server says otherwise (define in board.h to override)
+#ifndef REFRESH_MAX_FAST_REFRESHES
+#define REFRESH_MAX_FAST_REFRESHES 10
+#endif
+
+// Forward declarations
+class Logger;
+class SleepTimer;
+
+// Kept in RTC memory (survives deep sleep, but not a reset or power loss)
+struct RefreshSchedulerState {
+  bool valid;                 // false after a reset, the panel history is unknown then
+  uint16_t fastRefreshes;     // since the last clean refresh
+  uint16_t maxFastRefreshes;  // from the server
+  uint32_t cleanRefreshAt;    // server time when a clean refresh was requested, 0 = none
+};
+
+// Chooses between the fast refresh (partial update, flashes only what changed) and the clean full refresh of the panel.
+// The fast one leaves a bit of ghosting behind every time, so only a limited number of them is allowed in a row. A clean
+// refresh is also done on the first frame change after the time requested by the server (e.g. at night), and whenever
+// the count has been lost with the RTC memory.
+class RefreshScheduler {
+ private:
+  Logger& logger;
+  RefreshSchedulerState& state;
+  SleepTimer& sleepTimer;
+
+ public:
+  RefreshScheduler(Logger& logger, RefreshSchedulerState& state, SleepTimer& sleepTimer);
+
+  void configure(int maxFastRefreshes, uint32_t cleanRefreshAt);
+  bool cleanRefreshDue();
+  void fastRefreshDone();
+  void cleanRefreshDone();
+};
+
+#endif  // REFRESH_SCHEDULER_H
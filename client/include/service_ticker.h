@@ -0,0 +1,40 @@
+#ifndef SERVICE_TICKER_H
+#define SERVICE_TICKER_H
+
+#include <Arduino.h>
+
+// How often the background services run while the firmware is busy (define in board.h to override).
+// Has to be well below WDT_TIMEOUT.
+#ifndef SERVICE_TICK_INTERVAL_MS
+#define SERVICE_TICK_INTERVAL_MS 100
+#endif
+
+// Forward declarations
+class Logger;
+class WDTManager;
+class OTAManager;
+
+// Runs the periodic services (watchdog reset, ArduinoOTA socket handling) at a fixed cadence. Hot loops (per byte, per row)
+// call tick(), which only compares the time and is cheap enough for any loop. Places right before a long blocking operation
+// (display refresh) call run() to start it with a fresh watchdog.
+class ServiceTicker {
+ private:
+  Logger& logger;
+  WDTManager& wdtManager;
+  OTAManager& otaManager;
+  uint32_t lastRun;
+  uint32_t runCount;
+
+ public:
+  ServiceTicker(Logger& logger, WDTManager& wdtManager, OTAManager& otaManager);
+
+  inline void tick() {
+    if ((uint32_t)(millis() - lastRun) >= SERVICE_TICK_INTERVAL_MS) {
+      run();
+    }
+  }
+  void run();
+  void logStats();
+};
+
+#endif  // SERVICE_TICKER_H
@@ -0,0 +1,38 @@
+#ifndef SLEEP_TIMER_H
+#define SLEEP_TIMER_H
+
+#include <Arduino.h>
+
+// Forward declarations
+class Logger;
+
+// Kept in RTC memory (survives deep sleep, but not a reset or power loss)
+struct SleepTimerState {
+  uint32_t clockSyncedAt;   // server time when the system clock was last set, 0 = never
+  uint32_t sleepStartedAt;  // system clock when the last deep sleep started, 0 = unknown
+  uint32_t plannedSleep;    // seconds requested from the RTC timer for the last deep sleep
+  int32_t driftPpm;         // how much faster the server clock runs than the local one, in ppm
+  uint16_t calibrations;    // number of drift measurements so far
+};
+
+// Deep sleep on the RTC timer, with the system clock synchronised to the server. The clock keeps running during deep sleep,
+// so a wakeup can be planned for an absolute (server) time and compared against it afterwards.
+//
+// The RTC slow clock is off by several percent (depending on the temperature). Both the timer and the system clock run from
+// it during deep sleep, so comparing the system clock with the server time on every sync gives the drift. It's averaged into
+// a coefficient which scales the timer and corrects the clock between syncs.
+class SleepTimer {
+ private:
+  Logger& logger;
+  SleepTimerState& state;
+
+ public:
+  SleepTimer(Logger& logger, SleepTimerState& state);
+
+  bool clockValid();
+  uint32_t now();
+  void syncClock(uint32_t serverTime);
+  void deepSleep(uint32_t seconds);
+};
+
+#endif  // SLEEP_TIMER_H
@@ -13,7 +13,9 @@ class SystemInfo {
 
  public:
   SystemInfo(Logger& logger, int& wakeupCount);
-  
+
+  uint32_t wifiConnectTime = 0;  // ms, reported in the telemetry
+
   String resetReasonAsString();
   String wakeupReasonAsString();
   void logResetReason(const char* lastChecksum);
@@ -0,0 +1,89 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "hw_config.h"
+
+// Room for a serialized TLS session (mbedtls_ssl_session_save()), which includes the session ticket and with
+// MBEDTLS_SSL_KEEP_PEER_CERTIFICATE also the server certificate. A larger session is simply not cached. Define in board.h
+// to override.
+#ifndef TLS_SESSION_CACHE_SIZE
+#define TLS_SESSION_CACHE_SIZE 2048
+#endif
+
+// Timeout of the TLS handshake (after the TCP connection is established), define in board.h to override
+#ifndef TLS_HANDSHAKE_TIMEOUT
+#define TLS_HANDSHAKE_TIMEOUT 10000
+#endif
+
+// Kept in RTC memory (survives deep sleep, but not a reset or power loss)
+#ifdef USE_HTTPS
+struct TlsSessionState {
+  uint16_t sessionSize;                     // 0 = nothing to resume
+  uint8_t session[TLS_SESSION_CACHE_SIZE];  // session of the last handshake
+  bool fingerprintValid;
+  uint8_t fingerprint[32];  // SHA-256 of the server certificate, every later handshake must present the same one
+  // Handshakes of this wakeup and of the previous one (sent with the telemetry)
+  uint8_t handshakes;
+  uint8_t resumed;
+  uint32_t handshakeMs;
+  uint8_t lastHandshakes;
+  uint8_t lastResumed;
+  uint32_t lastHandshakeMs;
+};
+#else
+struct TlsSessionState {};
+#endif
+
+// Forward declarations
+class Logger;
+class PowerManager;
+struct TlsConnection;
+
+// HTTPS transport for HTTPClient (see USE_HTTPS in hw_config.h). The session of the last handshake is kept in RTC memory,
+// so the first connection of a wakeup resumes it with an abbreviated handshake (no certificate, no key exchange) instead of
+// a full one, which takes seconds of CPU and radio time on an ESP32.
+//
+// The server certificate is checked against CALENDAR_SERVER_CA_CERT (PEM) or pinned by CALENDAR_SERVER_CERT_SHA256 if
+// defined in board.h. Otherwise the certificate of the first handshake after a reset is trusted and all the following ones
+// must present the same one.
+class TlsClient : public WiFiClient {
+ private:
+  Logger& logger;
+  TlsSessionState& state;
+  PowerManager& powerManager;
+  TlsConnection* tls;
+  int peeked;  // byte read ahead by available(), -1 if none
+
+  bool handshake(const char* host);
+  bool verifyServerCertificate(bool fullHandshake);
+  void saveSession();
+  static int sendCallback(void* context, const unsigned char* data, size_t size);
+  static int receiveCallback(void* context, unsigned char* buffer, size_t size);
+
+ public:
+  TlsClient(Logger& logger, TlsSessionState& state, PowerManager& powerManager);
+  ~TlsClient();
+
+  // Moves the handshake statistics of the previous wakeup aside for lastWakeStats(), which is false if there were none
+  void beginWake();
+  bool lastWakeStats(uint8_t& handshakes, uint8_t& resumed, uint32_t& handshakeMs);
+
+  int connect(IPAddress ip, uint16_t port) override;
+  int connect(IPAddress ip, uint16_t port, int32_t timeout) override;
+  int connect(const char* host, uint16_t port) override;
+  int connect(const char* host, uint16_t port, int32_t timeout) override;
+  size_t write(uint8_t data) override;
+  size_t write(const uint8_t* buffer, size_t size) override;
+  int available() override;
+  int read() override;
+  int read(uint8_t* buffer, size_t size) override;
+  int peek() override;
+  void flush() override;
+  void stop() override;
+  uint8_t connected() override;
+};
+
+#endif  // TLS_CLIENT_H
@@ -6,16 +6,26 @@
 // Forward declarations
 class Logger;
 class WDTManager;
-class OTAManager;
+class ServiceTicker;
+class PowerManager;
+
+// Blocks until the socket behind the client is readable (data or EOF) or the timeout passes. The task sleeps in select()
+// instead of polling, which lets the power manager lower the clock or enter light sleep meanwhile.
+bool waitForSocketData(WiFiClient& client, uint32_t timeoutMs, PowerManager* powerManager = nullptr);
+
+// Reads exactly `size` bytes unless the deadline passes or the connection is closed first. Returns the number of bytes read.
+int readWithDeadline(WiFiClient& client, uint8_t* buffer, size_t size, uint32_t timeoutMs, PowerManager* powerManager = nullptr);
 
 class WiFiClientWithBlockingReads : public WiFiClient {
  protected:
   uint32_t blockingReadTimeout = 2000;
-  OTAManager* otaManager = nullptr;
+  ServiceTicker* serviceTicker = nullptr;
+  PowerManager* powerManager = nullptr;
   int blocking_read(uint8_t* buffer, size_t bytes);
 
  public:
-  void setOTAManager(OTAManager* manager);
+  void setServiceTicker(ServiceTicker* ticker);
+  void setPowerManager(PowerManager* manager);
   void setBlockingReadTimeout(uint32_t timeout);
   int read() override;
   int read(uint8_t* buf, size_t size) override;
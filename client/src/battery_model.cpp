@@ -0,0 +1,212 @@
+#include "battery_model.h"
+
+#include "logger.h"
+#include "main.h"
+#include "sleep_timer.h"
+
+// Voltage samples are added to the history at most this often, the slope of a few minutes is just noise
+#define BATTERY_HISTORY_INTERVAL (SECONDS_PER_HOUR * 6)
+
+// The slope is only trusted over a span at least this long
+#define BATTERY_MIN_SLOPE_SPAN (SECONDS_PER_HOUR * 24)
+
+// The consumption estimate is updated once the cycles since the last one cover this much time
+#define BATTERY_CONSUMPTION_WINDOW (SECONDS_PER_HOUR * 12)
+
+// A jump up this large means the battery has been charged (or replaced), the old history doesn't apply anymore
+#define BATTERY_CHARGED_JUMP_MV 150
+
+// The policy only returns to a better level this far above its threshold, so that the voltage noise doesn't flip it
+#define BATTERY_POLICY_HYSTERESIS_PERCENT 5
+
+BatteryModel::BatteryModel(Logger& logger, BatteryModelState& state, SleepTimer& sleepTimer) : logger(logger), state(state), sleepTimer(sleepTimer) {}
+
+void BatteryModel::update(float voltage) {
+  if (voltage <= 0) {
+    // Not measured on this board
+    return;
+  }
+
+  uint16_t mv = (uint16_t)(voltage * 1000);
+  if (state.filteredMv == 0 || mv > state.filteredMv + BATTERY_CHARGED_JUMP_MV) {
+    if (state.filteredMv != 0) {
+      logger.debug("Battery: %d mV after %d mV, assuming it was charged", mv, state.filteredMv);
+    }
+    state.filteredMv = mv;
+    state.historyCount = 0;
+    state.historyNext = 0;
+    state.policy = BATTERY_POLICY_NORMAL;
+  } else {
+    // The reading sags with the WiFi current and differs from wakeup to wakeup, smooth it out
+    state.filteredMv = (state.filteredMv * 3 + mv) / 4;
+  }
+
+  if (sleepTimer.clockValid()) {
+    addHistorySample(sleepTimer.now());
+  }
+
+  int percent = chargePercent();
+  BatteryPolicy newPolicy = BATTERY_POLICY_NORMAL;
+  if (percent < BATTERY_CRITICAL_PERCENT) {
+    newPolicy = BATTERY_POLICY_CRITICAL;
+  } else if (percent < BATTERY_SAVING_PERCENT) {
+    newPolicy = BATTERY_POLICY_SAVING;
+  }
+  if (newPolicy < state.policy) {
+    int threshold = state.policy == BATTERY_POLICY_CRITICAL ? BATTERY_CRITICAL_PERCENT : BATTERY_SAVING_PERCENT;
+    if (percent < threshold + BATTERY_POLICY_HYSTERESIS_PERCENT) {
+      newPolicy = state.policy;
+    }
+  }
+  if (newPolicy != state.policy) {
+    logger.debug("Battery: policy %d -> %d", state.policy, newPolicy);
+    state.policy = newPolicy;
+  }
+
+  logger.debug("Battery: %d mV (filtered %d mV), %d%%, %.1f days left, policy %d", mv, state.filteredMv, percent, daysRemaining(), state.policy);
+}
+
+void BatteryModel::addHistorySample(uint32_t now) {
+  if (state.historyCount > 0) {
+    uint8_t last = (state.historyNext + BATTERY_HISTORY_SIZE - 1) % BATTERY_HISTORY_SIZE;
+    if (now < state.history[last].time) {
+      // Clock jumped back, the old timestamps can't be compared anymore
+      state.historyCount = 0;
+      state.historyNext = 0;
+    } else if (now - state.history[last].time < BATTERY_HISTORY_INTERVAL) {
+      return;
+    }
+  }
+
+  state.history[state.historyNext] = {now, state.filteredMv};
+  state.historyNext = (state.historyNext + 1) % BATTERY_HISTORY_SIZE;
+  if (state.historyCount < BATTERY_HISTORY_SIZE) {
+    state.historyCount++;
+  }
+}
+
+void BatteryModel::endWake(float awakeMah, uint32_t awakeMs, uint32_t sleepSeconds) {
+  // uA * s / 3600000 = mAh
+  float mah = awakeMah + (float)sleepSeconds * BATTERY_CURRENT_SLEEP_UA / 3600000.0f;
+  state.windowMah += mah;
+  state.windowSeconds += awakeMs / 1000 + sleepSeconds;
+  logger.debug("Battery: this cycle uses %.4f mAh (%.4f mAh in %lu ms awake, %lu s sleep)", mah, awakeMah, awakeMs, sleepSeconds);
+
+  if (state.windowSeconds >= BATTERY_CONSUMPTION_WINDOW) {
+    float mahPerDay = state.windowMah * (SECONDS_PER_HOUR * 24) / state.windowSeconds;
+    state.mahPerDay = state.mahPerDay == 0 ? mahPerDay : (state.mahPerDay * 3 + mahPerDay) / 4;
+    state.windowMah = 0;
+    state.windowSeconds = 0;
+    logger.debug("Battery: %.2f mAh/day measured, using %.2f mAh/day", mahPerDay, state.mahPerDay);
+  }
+}
+
+// Charge left estimated from the smoothed voltage: linear between VOLTAGE_LINEAR_MIN and VOLTAGE_LINEAR_MAX (like the
+// server's battery percentage), then BATTERY_KNEE_PERCENT for the steep part down to VOLTAGE_MIN. -1 = unknown.
+int BatteryModel::chargePercent() {
+  if (state.filteredMv == 0) {
+    return -1;
+  }
+
+  float v = state.filteredMv / 1000.0f;
+  if (v >= VOLTAGE_LINEAR_MAX) {
+    return 100;
+  }
+  if (v >= VOLTAGE_LINEAR_MIN) {
+    return BATTERY_KNEE_PERCENT + (int)((100 - BATTERY_KNEE_PERCENT) * (v - VOLTAGE_LINEAR_MIN) / (VOLTAGE_LINEAR_MAX - VOLTAGE_LINEAR_MIN));
+  }
+  if (v <= VOLTAGE_MIN || VOLTAGE_LINEAR_MIN <= VOLTAGE_MIN) {
+    return 0;
+  }
+  return (int)(BATTERY_KNEE_PERCENT * (v - VOLTAGE_MIN) / (VOLTAGE_LINEAR_MIN - VOLTAGE_MIN));
+}
+
+// Days until the charge runs out at the measured consumption, -1 = unknown
+float BatteryModel::energyDaysRemaining() {
+  float mahPerDay = state.mahPerDay;
+  if (mahPerDay == 0 && state.windowSeconds > 0) {
+    // Not a full window yet, better than nothing
+    mahPerDay = state.windowMah * (SECONDS_PER_HOUR * 24) / state.windowSeconds;
+  }
+  int percent = chargePercent();
+  if (mahPerDay <= 0 || percent < 0) {
+    return -1;
+  }
+  return BATTERY_CAPACITY_MAH * percent / 100.0f / mahPerDay;
+}
+
+// Days until the voltage falls to VOLTAGE_MIN at the slope of the history, -1 = unknown or not discharging
+float BatteryModel::slopeDaysRemaining() {
+  if (state.historyCount < 2) {
+    return -1;
+  }
+
+  uint8_t oldest = state.historyCount < BATTERY_HISTORY_SIZE ? 0 : state.historyNext;
+  uint8_t newest = (state.historyNext + BATTERY_HISTORY_SIZE - 1) % BATTERY_HISTORY_SIZE;
+  uint32_t span = state.history[newest].time - state.history[oldest].time;
+  int32_t drop = (int32_t)state.history[oldest].mv - state.history[newest].mv;
+  if (span < BATTERY_MIN_SLOPE_SPAN || drop <= 0) {
+    return -1;
+  }
+
+  float left = state.filteredMv - VOLTAGE_MIN * 1000;
+  if (left <= 0) {
+    return 0;
+  }
+  return left * span / drop / (SECONDS_PER_HOUR * 24);
+}
+
+float BatteryModel::daysRemaining() {
+  float energy = energyDaysRemaining();
+  float slope = slopeDaysRemaining();
+  if (energy < 0) {
+    return slope;
+  }
+  if (slope < 0) {
+    return energy;
+  }
+  // The voltage curve is flat in the middle, either estimate may be too optimistic
+  return min(energy, slope);
+}
+
+int BatteryModel::sleepFactor() {
+#ifdef USE_BATTERY_POLICY
+  switch (state.policy) {
+    case BATTERY_POLICY_CRITICAL:
+      return BATTERY_CRITICAL_SLEEP_FACTOR;
+    case BATTERY_POLICY_SAVING:
+      return BATTERY_SAVING_SLEEP_FACTOR;
+    case BATTERY_POLICY_NORMAL:
+      break;
+  }
+#endif
+  return 1;
+}
+
+int BatteryModel::stretchSleep(int seconds) {
+  int factor = sleepFactor();
+  if (factor <= 1 || seconds >= BATTERY_MAX_STRETCHED_SLEEP) {
+    return seconds;
+  }
+
+  int stretched = min(seconds * factor, BATTERY_MAX_STRETCHED_SLEEP);
+  logger.debug("Battery: sleep stretched from %d to %d seconds", seconds, stretched);
+  return stretched;
+}
+
+bool BatteryModel::allowsFirmwareUpdate() {
+#ifdef USE_BATTERY_POLICY
+  // Flashing takes a while with the radio on, and a brownout in the middle of it would leave the device without firmware
+  return state.policy == BATTERY_POLICY_NORMAL;
+#else
+  return true;
+#endif
+}
+
+bool BatteryModel::allowsFrameSchedule() {
+#ifdef USE_BATTERY_POLICY
+  return state.policy != BATTERY_POLICY_CRITICAL;
+#else
+  return true;
+#endif
+}
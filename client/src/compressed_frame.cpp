@@ -0,0 +1,103 @@
+#include "compressed_frame.h"
+
+#include <esp_heap_caps.h>
+
+#include "logger.h"
+#include "packbits.h"
+
+// The data buffer grows in steps of this size, a realloc() per row would fragment the heap
+#define COMPRESSED_FRAME_GROW_STEP 4096
+
+CompressedFrame::CompressedFrame(Logger& logger)
+    : logger(logger), rowBytes(0), height(0), rowsStored(0), rowOffsets(nullptr), data(nullptr), capacity(0), failed(true) {}
+
+CompressedFrame::~CompressedFrame() { release(); }
+
+bool CompressedFrame::begin(uint16_t height, uint16_t rowBytes) {
+  release();
+
+  rowOffsets = (uint32_t*)heap_caps_malloc((height + 1) * sizeof(uint32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (rowOffsets == nullptr) {
+    logger.debug("Compressed frame: can't allocate the row index");
+    return false;
+  }
+
+  this->height = height;
+  this->rowBytes = rowBytes;
+  rowsStored = 0;
+  rowOffsets[0] = 0;
+  failed = false;
+  return true;
+}
+
+void CompressedFrame::release() {
+  if (data != nullptr) {
+    heap_caps_free(data);
+    data = nullptr;
+  }
+  if (rowOffsets != nullptr) {
+    heap_caps_free(rowOffsets);
+    rowOffsets = nullptr;
+  }
+  capacity = 0;
+  rowsStored = 0;
+  failed = true;
+}
+
+bool CompressedFrame::reserve(size_t size) {
+  if (size <= capacity) {
+    return true;
+  }
+
+  size_t newCapacity = capacity + COMPRESSED_FRAME_GROW_STEP;
+  while (newCapacity < size) {
+    newCapacity += COMPRESSED_FRAME_GROW_STEP;
+  }
+  if (heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT) < newCapacity - capacity + COMPRESSED_FRAME_HEAP_RESERVE) {
+    logger.debug("Compressed frame: not enough heap for %d bytes", newCapacity);
+    return false;
+  }
+
+  uint8_t* newData = (uint8_t*)heap_caps_realloc(data, newCapacity, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (newData == nullptr) {
+    logger.debug("Compressed frame: can't grow to %d bytes", newCapacity);
+    return false;
+  }
+  data = newData;
+  capacity = newCapacity;
+  return true;
+}
+
+bool CompressedFrame::appendRow(uint16_t row, const uint8_t* rowData) {
+  if (failed) {
+    return false;
+  }
+  if (row > rowsStored || row >= height) {
+    // A gap can't be filled later, the frame is useless
+    logger.debug("Compressed frame: row %d out of order (have %d)", row, rowsStored);
+    release();
+    return false;
+  }
+  rowsStored = row;
+
+  uint32_t offset = rowOffsets[row];
+  if (!reserve(offset + PACKBITS_MAX_ENCODED_SIZE(rowBytes))) {
+    release();
+    return false;
+  }
+
+  rowOffsets[row + 1] = offset + packbitsEncode(rowData, rowBytes, data + offset);
+  rowsStored = row + 1;
+  return true;
+}
+
+bool CompressedFrame::readRow(uint16_t row, uint8_t* rowData) {
+  if (failed || row >= rowsStored) {
+    return false;
+  }
+  return packbitsDecode(data + rowOffsets[row], rowOffsets[row + 1] - rowOffsets[row], rowData, rowBytes);
+}
+
+bool CompressedFrame::complete() { return !failed && rowsStored == height; }
+
+size_t CompressedFrame::size() { return failed ? 0 : rowOffsets[rowsStored] + (height + 1) * sizeof(uint32_t); }
@@ -0,0 +1,143 @@
+#include "device_protocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packbits.h"
+
+static bool fits(int written, size_t size) { return written > 0 && (size_t)written < size; }
+
+static uint16_t readUint16(const uint8_t* data) { return data[0] | (uint16_t)data[1] << 8; }
+
+static uint32_t readUint32(const uint8_t* data) { return readUint16(data) | (uint32_t)readUint16(data + 2) << 16; }
+
+static void writeUint16(uint8_t* data, uint16_t value) {
+  data[0] = value & 0xff;
+  data[1] = value >> 8;
+}
+
+static void writeUint32(uint8_t* data, uint32_t value) {
+  writeUint16(data, value & 0xffff);
+  writeUint16(data + 2, value >> 16);
+}
+
+// format 3 = the rows of format 2 (simple pixel drawing, no HW-specific code on server side) after a binary header. A
+// non-zero row resumes an interrupted download.
+bool buildBitmapPath(char* buffer, size_t size, const char* mac, uint16_t firstRow, unsigned int capabilities) {
+  int written = firstRow > 0 ? snprintf(buffer, size, DEVICE_API_BITMAP_PATH "?mac=%s&fmt=3&caps=%u&row=%u", mac, capabilities, (unsigned int)firstRow)
+                             : snprintf(buffer, size, DEVICE_API_BITMAP_PATH "?mac=%s&fmt=3&caps=%u", mac, capabilities);
+  return fits(written, size);
+}
+
+bool buildFrameSchedulePath(char* buffer, size_t size, const char* mac, int count) {
+  return fits(snprintf(buffer, size, DEVICE_API_SCHEDULE_PATH "?mac=%s&count=%d", mac, count), size);
+}
+
+bool buildFirmwarePath(char* buffer, size_t size, const char* mac) {
+  return fits(snprintf(buffer, size, DEVICE_API_FIRMWARE_PATH "?mac=%s", mac), size);
+}
+
+int bitmapBytesPerRow(const char* colorType, int width) {
+  if (strcmp(colorType, "BW") == 0) {
+    return width / 8;  // 8 pixels per byte
+  }
+  if (strcmp(colorType, "3C") == 0 || strcmp(colorType, "4C") == 0 || strcmp(colorType, "4G") == 0) {
+    return width / 4;  // 4 pixels per byte
+  }
+  if (strcmp(colorType, "7C") == 0) {
+    return width / 2;  // 2 pixels per byte
+  }
+  return 0;
+}
+
+bool parseBitmapV3Header(const uint8_t* data, BitmapV3Header& header) {
+  if (data[0] != 'M' || data[1] != 'M' || data[2] != BITMAP_V3_VERSION || data[3] < BITMAP_V3_HEADER_SIZE) {
+    return false;
+  }
+  header.headerSize = data[3];
+  header.width = readUint16(data + 4);
+  header.height = readUint16(data + 6);
+  header.bitsPerPixel = data[8];
+  header.encoding = data[9];
+  header.firstRow = readUint16(data + 12);
+  header.rowCount = readUint16(data + 14);
+  header.payloadLength = readUint32(data + 16);
+  header.frameHash = readUint32(data + 20) | (uint64_t)readUint32(data + 24) << 32;
+  for (int i = 0; i < BITMAP_V3_CHECKSUM_SIZE; i++) {
+    snprintf(header.checksum + i * 2, 3, "%02x", data[28 + i]);
+  }
+  return true;
+}
+
+bool writeBitmapV3Header(uint8_t* data, const BitmapV3Header& header) {
+  if (strlen(header.checksum) != BITMAP_V3_CHECKSUM_SIZE * 2) {
+    return false;
+  }
+  memset(data, 0, BITMAP_V3_HEADER_SIZE);
+  data[0] = 'M';
+  data[1] = 'M';
+  data[2] = BITMAP_V3_VERSION;
+  data[3] = BITMAP_V3_HEADER_SIZE;
+  writeUint16(data + 4, header.width);
+  writeUint16(data + 6, header.height);
+  data[8] = header.bitsPerPixel;
+  data[9] = header.encoding;
+  writeUint16(data + 12, header.firstRow);
+  writeUint16(data + 14, header.rowCount);
+  writeUint32(data + 16, header.payloadLength);
+  writeUint32(data + 20, (uint32_t)header.frameHash);
+  writeUint32(data + 24, (uint32_t)(header.frameHash >> 32));
+  for (int i = 0; i < BITMAP_V3_CHECKSUM_SIZE; i++) {
+    char digits[3] = {header.checksum[i * 2], header.checksum[i * 2 + 1], 0};
+    char* end = nullptr;
+    data[28 + i] = (uint8_t)strtoul(digits, &end, 16);
+    if (end != digits + 2) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const char* validateBitmapV3Header(const BitmapV3Header& header, int width, int height, int bitsPerPixel, uint16_t firstRow,
+                                   unsigned int capabilities) {
+  if (header.width != width || header.height != height) {
+    return "different size";
+  }
+  if (header.bitsPerPixel != bitsPerPixel) {
+    return "different bits per pixel";
+  }
+  if (header.firstRow != firstRow || header.firstRow + header.rowCount != height) {
+    return "different rows than requested";
+  }
+
+  uint32_t rowBytes = (uint32_t)(width * bitsPerPixel + 7) / 8;
+  switch (header.encoding) {
+    case BITMAP_ENCODING_RAW:
+      if (header.payloadLength != header.rowCount * rowBytes) {
+        return "wrong payload length";
+      }
+      break;
+    case BITMAP_ENCODING_PACKBITS_ROWS:
+      if (!(capabilities & DEVICE_CAPS_PACKBITS_ROWS)) {
+        return "unsupported encoding";
+      }
+      // Every row needs at least its length and one chunk (2 bytes), and at most the worst case of PackBits
+      if (header.payloadLength < header.rowCount * 4u || header.payloadLength > header.rowCount * (2 + PACKBITS_MAX_ENCODED_SIZE(rowBytes))) {
+        return "wrong payload length";
+      }
+      break;
+    default:
+      return "unsupported encoding";
+  }
+  return nullptr;
+}
+
+bool parseFrameScheduleHeader(const char* line, int requested, unsigned int& count, uint32_t& validUntil) {
+  unsigned long until = 0;
+  if (sscanf(line, "%u %lu", &count, &until) != 2 || count > (unsigned int)requested) {
+    return false;
+  }
+  validUntil = until;
+  return true;
+}
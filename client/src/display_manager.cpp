@@ -1,18 +1,25 @@
 #include "display_manager.h"
 
 #include <ArduinoOTA.h>
+#include <esp_heap_caps.h>
+
+#include <new>
 
 #include "hw_config.h"
 #include "logger.h"
 #include "main.h"
-#include "ota_manager.h"
-#include "wdt_manager.h"
+#include "packbits.h"
+#include "power_manager.h"
+#include "refresh_scheduler.h"
+#include "service_ticker.h"
 
 #ifdef SPI_BUS
 #include <SPI.h>
 #endif
 
-extern DISPLAY_CLASS_TYPE display;
+// Layout of the text screens, tools/error_screens/generate_error_screens.py uses the same values
+#define TEXT_MARGIN 10
+#define TEXT_LINE_SPACING 4
 
 const uint16_t DisplayManager::serverByteToGxEPDColor[8] = {
     // 1-bit (2 combinations) variants
@@ -28,10 +35,108 @@ const uint16_t DisplayManager::serverByteToGxEPDColor[8] = {
     GxEPD_WHITE    // 7 = white (fallback)
 };
 
-DisplayManager::DisplayManager(Logger& logger, WDTManager& wdtManager, OTAManager& otaManager) : logger(logger), wdt(wdtManager), ota(otaManager) {}
+#ifdef USE_DIRECT_FRAME_WRITE
+// Server byte to the same pixels in the native format of the controller, filled by init()
+static uint8_t serverByteToNative[256];
+
+static void initServerByteToNative() {
+#ifdef DISPLAY_TYPE_4G
+  // 4 pixels of 0 = white, 1 = black, 2 = light grey, 3 = dark grey to the grey levels of GxEPD2_4G (3 = white .. 0 = black)
+  static const uint8_t levels[4] = {3, 0, 2, 1};
+  for (int i = 0; i < 256; i++) {
+    serverByteToNative[i] = (levels[(i >> 6) & 0x03] << 6) | (levels[(i >> 4) & 0x03] << 4) | (levels[(i >> 2) & 0x03] << 2) | levels[i & 0x03];
+  }
+#endif
+#ifdef DISPLAY_TYPE_7C
+  // 2 pixels of the serverByteToGxEPDColor codes to the 4-bit colors of the 7-color controllers (as in GxEPD2_7C)
+  static const uint8_t colors[8] = {
+      0x1,  // white
+      0x0,  // black
+      0x4,  // red
+      0x5,  // yellow
+      0x3,  // blue
+      0x2,  // green
+      0x6,  // orange
+      0x1   // white (fallback)
+  };
+  for (int i = 0; i < 256; i++) {
+    serverByteToNative[i] = (colors[(i >> 4) & 0x07] << 4) | colors[i & 0x07];
+  }
+#endif
+}
+#endif
+
+DisplayManager::DisplayManager(Logger& logger, ServiceTicker& serviceTicker, PowerManager& powerManager, RefreshScheduler& refreshScheduler)
+    : logger(logger),
+      serviceTicker(serviceTicker),
+      powerManager(powerManager),
+      refreshScheduler(refreshScheduler),
+      display(nullptr),
+      bufferedFrame(logger),
+      bufferingRows(false),
+      partialWindow(false),
+      initialized(false) {}
+
+// In the internal RAM, nullptr if there isn't enough of it
+template <int pages>
+static GxEPD2_GFX* createPagedDisplay(Logger& logger) {
+  typedef DISPLAY_CLASS_TYPE_WITH_PAGES(pages) PagedDisplay;
+
+  void* memory = heap_caps_malloc(sizeof(PagedDisplay), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (memory == nullptr) {
+    logger.debug("Display buffer: can't allocate %d bytes for %d pages", sizeof(PagedDisplay), pages);
+    return nullptr;
+  }
+  logger.debug("Display buffer: %d pages, %d bytes in internal RAM", pages, sizeof(PagedDisplay));
+  return new (memory) PagedDisplay DISPLAY_CLASS_ARGUMENTS;
+}
+
+// The page buffer is a member of the GxEPD2 display object, so the whole object is placed into the best memory available:
+// one full-frame page in PSRAM if the board has it (single pass rendering), SPLIT_DISPLAY_INTO_N_PAGES pages in the internal
+// RAM otherwise. A fragmented heap gets more and smaller pages.
+GxEPD2_GFX* DisplayManager::createDisplay() {
+  typedef DISPLAY_CLASS_TYPE_WITH_PAGES(1) FullFrameDisplay;
+
+  if (psramFound()) {
+    void* memory = heap_caps_malloc(sizeof(FullFrameDisplay), MALLOC_CAP_SPIRAM);
+    if (memory != nullptr) {
+      logger.debug("Display buffer: 1 page, %d bytes in PSRAM", sizeof(FullFrameDisplay));
+      return new (memory) FullFrameDisplay DISPLAY_CLASS_ARGUMENTS;
+    }
+    logger.debug("Display buffer: PSRAM allocation failed");
+  }
+
+  GxEPD2_GFX* created = createPagedDisplay<SPLIT_DISPLAY_INTO_N_PAGES>(logger);
+  if (created == nullptr) {
+    created = createPagedDisplay<SPLIT_DISPLAY_INTO_N_PAGES * 2>(logger);
+  }
+  if (created == nullptr) {
+    created = createPagedDisplay<SPLIT_DISPLAY_INTO_N_PAGES * 4>(logger);
+  }
+  if (created == nullptr) {
+    // Not even an error screen can be shown. A restart would find the same heap and fail again right away, sleep instead
+    // of draining the battery in a boot loop.
+    logger.debug("Display buffer: no memory left for any page size, sleeping");
+    espDeepSleep(SECONDS_PER_HOUR);
+  }
+  return created;
+}
+
+// Called by GxEPD2 in a loop while the panel is BUSY, instead of its own delay(1)
+void DisplayManager::busyCallback(const void* param) {
+  ((DisplayManager*)param)->powerManager.refreshWaitBegin();
+  delay(1);
+}
 
 void DisplayManager::init() {
+  if (initialized) {
+    return;
+  }
+  initialized = true;
   logger.debug("Display setup start");
+  if (display == nullptr) {
+    display = createDisplay();
+  }
   logger.trace("CS=%d, DC=%d, RST=%d, BUSY=%d", CS_PIN, DC_PIN, RST_PIN, BUSY_PIN);
 
   delay(100);
@@ -43,30 +148,40 @@ void DisplayManager::init() {
   spi->begin(PIN_SPI_CLK, PIN_SPI_MISO, PIN_SPI_MOSI, PIN_SPI_SS);
 #endif
   logger.debug("remapped, now initialising SPI");
-  display.init(115200, false, 2, false, *spi, SPISettings(7000000, MSBFIRST, SPI_MODE0));
+  display->epd2.selectSPI(*spi, SPISettings(7000000, MSBFIRST, SPI_MODE0));
+  display->init(115200, false, 2, false);
 #else
-  display.init(115200, false, 2, false);
+  display->init(115200, false, 2, false);
+#endif
+  display->epd2.setBusyCallback(busyCallback, this);
+#ifdef USE_DIRECT_FRAME_WRITE
+  initServerByteToNative();
 #endif
 
   logger.debug("Display setup finished");
 }
 
 void DisplayManager::stop() {
+  if (!initialized) {
+    return;  // never woken up
+  }
   logger.debug("stopDisplay()");
-  wdt.ping();
-  display.powerOff();
-  wdt.ping();
+  serviceTicker.run();
+  display->powerOff();
+  powerManager.refreshWaitEnd();
+  serviceTicker.run();
 }
 
 void DisplayManager::displayText(String message, const GFXfont* font) {
-  display.setRotation(DISPLAY_ROTATION);  // see hw_config.h for details
+  init();
+  display->setRotation(DISPLAY_ROTATION);  // see hw_config.h for details
 
   if (font == nullptr) {
     font = &Open_Sans_Regular_16;
   }
 
-  const int16_t margin = 10;
-  const int16_t lineSpacing = 4;
+  const int16_t margin = TEXT_MARGIN;
+  const int16_t lineSpacing = TEXT_LINE_SPACING;
   const int16_t titleGap = 36;
   const GFXfont* titleFont = &Open_Sans_Regular_24;
   const char* titleText = "Error";
@@ -74,117 +189,203 @@ void DisplayManager::displayText(String message, const GFXfont* font) {
   // Measure title
   int16_t tbx, tby;
   uint16_t tbw, tbh;
-  display.setFont(titleFont);
-  display.getTextBounds(titleText, 0, 0, &tbx, &tby, &tbw, &tbh);
+  display->setFont(titleFont);
+  display->getTextBounds(titleText, 0, 0, &tbx, &tby, &tbw, &tbh);
   int16_t titleHeight = tbh;
   int16_t titleBaselineOffset = -tby;  // distance from top of bounding box to baseline
 
-  // Split message into lines
-  String lines[20];
-  int lineCount = 0;
-  int start = 0;
-  for (int i = 0; i <= (int)message.length(); i++) {
-    if (i == (int)message.length() || message[i] == '\n') {
-      lines[lineCount++] = message.substring(start, i);
-      start = i + 1;
-      if (lineCount >= 20) break;
-    }
-  }
-
-  // Word-wrap lines that exceed the available width
-  int16_t maxWidth = display.width() - 2 * margin;
+  // Split message into lines and word-wrap lines that exceed the available width
   String wrappedLines[40];
-  int wrappedCount = 0;
-  display.setFont(font);
-  for (int i = 0; i < lineCount && wrappedCount < 40; i++) {
-    if (lines[i].length() == 0) {
-      wrappedLines[wrappedCount++] = "";
-      continue;
-    }
-    display.getTextBounds(lines[i], 0, 0, &tbx, &tby, &tbw, &tbh);
-    if ((int16_t)tbw <= maxWidth) {
-      wrappedLines[wrappedCount++] = lines[i];
-    } else {
-      // Wrap by words
-      String remaining = lines[i];
-      while (remaining.length() > 0 && wrappedCount < 40) {
-        String candidate = "";
-        int pos = 0;
-        int lastSpace = -1;
-        while (pos < (int)remaining.length()) {
-          char c = remaining[pos];
-          String test = candidate + c;
-          display.getTextBounds(test, 0, 0, &tbx, &tby, &tbw, &tbh);
-          if ((int16_t)tbw > maxWidth && candidate.length() > 0) break;
-          candidate = test;
-          if (c == ' ') lastSpace = pos;
-          pos++;
-        }
-        if (pos < (int)remaining.length() && lastSpace > 0) {
-          wrappedLines[wrappedCount++] = remaining.substring(0, lastSpace);
-          remaining = remaining.substring(lastSpace + 1);
-        } else {
-          wrappedLines[wrappedCount++] = candidate;
-          remaining = remaining.substring(pos);
-        }
-      }
-    }
-  }
+  display->setFont(font);
+  int wrappedCount = wrapText(message, wrappedLines, 40);
 
   // Measure body line height
-  display.setFont(font);
-  display.getTextBounds("Ag", 0, 0, &tbx, &tby, &tbw, &tbh);
+  display->getTextBounds("Ag", 0, 0, &tbx, &tby, &tbw, &tbh);
   int16_t bodyLineHeight = tbh + lineSpacing;
   int16_t bodyBaselineOffset = -tby;
 
   // Total height: title + gap + body lines
   int16_t totalHeight = titleHeight + titleGap + wrappedCount * bodyLineHeight;
-  int16_t startY = (display.height() - totalHeight) / 2;
+  int16_t startY = (display->height() - totalHeight) / 2;
   if (startY < margin) startY = margin;
 
-  wdt.ping();
-  display.firstPage();
+  serviceTicker.run();
+  display->setFullWindow();
+  display->firstPage();
   do {
-    ota.loop();
-    display.fillScreen(GxEPD_WHITE);
+    display->fillScreen(GxEPD_WHITE);
 
     // Draw title centered
-    display.setFont(titleFont);
-    display.setTextColor(GxEPD_BLACK);
-    display.getTextBounds(titleText, 0, 0, &tbx, &tby, &tbw, &tbh);
-    int16_t tx = (display.width() - tbw) / 2 - tbx;
-    display.setCursor(tx, startY + titleBaselineOffset);
-    display.print(titleText);
+    display->setFont(titleFont);
+    display->setTextColor(GxEPD_BLACK);
+    display->getTextBounds(titleText, 0, 0, &tbx, &tby, &tbw, &tbh);
+    int16_t tx = (display->width() - tbw) / 2 - tbx;
+    display->setCursor(tx, startY + titleBaselineOffset);
+    display->print(titleText);
 
     // Draw body lines, each horizontally centered
-    display.setFont(font);
-    display.setTextColor(GxEPD_BLACK);
+    display->setFont(font);
+    display->setTextColor(GxEPD_BLACK);
     int16_t y = startY + titleHeight + titleGap + bodyBaselineOffset;
     for (int i = 0; i < wrappedCount; i++) {
       if (wrappedLines[i].length() > 0) {
-        display.getTextBounds(wrappedLines[i], 0, 0, &tbx, &tby, &tbw, &tbh);
-        int16_t lx = (display.width() - tbw) / 2 - tbx;
+        display->getTextBounds(wrappedLines[i], 0, 0, &tbx, &tby, &tbw, &tbh);
+        int16_t lx = (display->width() - tbw) / 2 - tbx;
         if (lx < margin) lx = margin;
-        display.setCursor(lx, y);
-        display.print(wrappedLines[i]);
+        display->setCursor(lx, y);
+        display->print(wrappedLines[i]);
       }
       y += bodyLineHeight;
     }
 
-    wdt.ping();
-  } while (display.nextPage());
-  wdt.ping();
+    serviceTicker.run();
+  } while (display->nextPage());
+  powerManager.refreshWaitEnd();
+  serviceTicker.run();
+  refreshScheduler.cleanRefreshDone();
 }
 
-int DisplayManager::displayWidth() { return display.width(); }
+// Splits the message into lines fitting the width of the display in the current font, word-wrapped where possible.
+// tools/error_screens/generate_error_screens.py does the same when pre-rendering the error screens.
+int DisplayManager::wrapText(const String& message, String* wrappedLines, int maxLines) {
+  int16_t maxWidth = display->width() - 2 * TEXT_MARGIN;
+  int16_t tbx, tby;
+  uint16_t tbw, tbh;
+  int wrappedCount = 0;
+  int start = 0;
+  for (int i = 0; i <= (int)message.length() && wrappedCount < maxLines; i++) {
+    if (i < (int)message.length() && message[i] != '\n') {
+      continue;
+    }
+    String line = message.substring(start, i);
+    start = i + 1;
 
-int DisplayManager::displayHeight() { return display.height(); }
+    if (line.length() == 0) {
+      wrappedLines[wrappedCount++] = "";
+      continue;
+    }
+    display->getTextBounds(line, 0, 0, &tbx, &tby, &tbw, &tbh);
+    if ((int16_t)tbw <= maxWidth) {
+      wrappedLines[wrappedCount++] = line;
+      continue;
+    }
+    // Wrap by words
+    String remaining = line;
+    while (remaining.length() > 0 && wrappedCount < maxLines) {
+      String candidate = "";
+      int pos = 0;
+      int lastSpace = -1;
+      while (pos < (int)remaining.length()) {
+        char c = remaining[pos];
+        String test = candidate + c;
+        display->getTextBounds(test, 0, 0, &tbx, &tby, &tbw, &tbh);
+        if ((int16_t)tbw > maxWidth && candidate.length() > 0) break;
+        candidate = test;
+        if (c == ' ') lastSpace = pos;
+        pos++;
+      }
+      if (pos < (int)remaining.length() && lastSpace > 0) {
+        wrappedLines[wrappedCount++] = remaining.substring(0, lastSpace);
+        remaining = remaining.substring(lastSpace + 1);
+      } else {
+        wrappedLines[wrappedCount++] = candidate;
+        remaining = remaining.substring(pos);
+      }
+    }
+  }
+  return wrappedCount;
+}
+
+// Draws a pre-rendered error screen (see error_screens.h) and prints the band text below its fixed text. Only the band is
+// laid out at runtime, the rest is decoded from flash and drawn as runs of black pixels.
+void DisplayManager::displayPrerendered(const PrerenderedErrorScreen& screen, String bandText, const GFXfont* font) {
+  static uint8_t row[DISPLAY_WIDTH / 8];
+
+  init();
+  display->setRotation(DISPLAY_ROTATION);
+  display->setFont(font);
+  String bandLines[ERROR_SCREEN_BAND_LINES];
+  int bandCount = wrapText(bandText, bandLines, ERROR_SCREEN_BAND_LINES);
+  int16_t tbx, tby;
+  uint16_t tbw, tbh;
+  display->getTextBounds("Ag", 0, 0, &tbx, &tby, &tbw, &tbh);
+  int16_t bandLineHeight = tbh + TEXT_LINE_SPACING;
+
+  serviceTicker.run();
+  display->setFullWindow();
+  display->firstPage();
+  do {
+    display->fillScreen(GxEPD_WHITE);
+
+    // The rows are in the native orientation
+    display->setRotation(0);
+    const uint8_t* data = screen.rows;
+    const uint8_t* end = screen.rows + screen.size;
+    for (int16_t y = 0; y < DISPLAY_HEIGHT && data + 2 <= end; y++) {
+      size_t packedSize = data[0] | (size_t)data[1] << 8;
+      data += 2;
+      if (packedSize == 0) {
+        continue;  // white
+      }
+      if (data + packedSize > end || !packbitsDecode(data, packedSize, row, sizeof(row))) {
+        logger.debug("Corrupted error screen on row %d", y);
+        break;
+      }
+      data += packedSize;
+      for (int16_t x = 0; x < DISPLAY_WIDTH;) {
+        if (!(row[x / 8] & (0x80 >> (x % 8)))) {
+          x++;
+          continue;
+        }
+        int16_t runStart = x;
+        while (x < DISPLAY_WIDTH && (row[x / 8] & (0x80 >> (x % 8)))) {
+          x++;
+        }
+        display->drawFastHLine(runStart, y, x - runStart, GxEPD_BLACK);
+      }
+    }
+
+    display->setRotation(DISPLAY_ROTATION);
+    display->setTextColor(GxEPD_BLACK);
+    int16_t y = screen.bandBaseline;
+    for (int i = 0; i < bandCount; i++) {
+      if (bandLines[i].length() > 0) {
+        display->getTextBounds(bandLines[i], 0, 0, &tbx, &tby, &tbw, &tbh);
+        int16_t lx = (display->width() - tbw) / 2 - tbx;
+        if (lx < TEXT_MARGIN) lx = TEXT_MARGIN;
+        display->setCursor(lx, y);
+        display->print(bandLines[i]);
+      }
+      y += bandLineHeight;
+    }
+
+    serviceTicker.run();
+  } while (display->nextPage());
+  powerManager.refreshWaitEnd();
+  serviceTicker.run();
+  refreshScheduler.cleanRefreshDone();
+}
+
+int DisplayManager::displayWidth() {
+  init();
+  return display->width();
+}
+
+int DisplayManager::displayHeight() {
+  init();
+  return display->height();
+}
+
+int DisplayManager::pageCount() {
+  init();
+  return display->pages();
+}
 
 int DisplayManager::bytesPerRow() {
 #ifdef DISPLAY_TYPE_BW
   return DISPLAY_WIDTH / 8;  // 8 pixels per byte
 #endif
-#if defined(DISPLAY_TYPE_3C) || defined(DISPLAY_TYPE_4C)
+#if defined(DISPLAY_TYPE_3C) || defined(DISPLAY_TYPE_4C) || defined(DISPLAY_TYPE_4G)
   return DISPLAY_WIDTH / 4;  // 4 pixels per byte
 #endif
 #ifdef DISPLAY_TYPE_7C
@@ -192,15 +393,87 @@ int DisplayManager::bytesPerRow() {
 #endif
 }
 
+int DisplayManager::bitsPerPixel() { return bytesPerRow() * 8 / DISPLAY_WIDTH; }
+
 void DisplayManager::beginBitmapDraw() {
+  init();
+  startTime = millis();
+  bufferingRows = false;
+  partialWindow = false;
+#ifdef USE_DIRECT_FRAME_WRITE
+  // Rows go straight into the controller's memory (see drawBitmapRow()), so there is a single pass whatever the page count
+  return;
+#endif
+#ifdef USE_COMPRESSED_FRAME
+  if (display->pages() > 1) {
+    // Rows drawn into the first page are kept compressed for the following ones
+    bufferingRows = bufferedFrame.begin(DISPLAY_HEIGHT, bytesPerRow());
+  }
+#endif
+  display->setFullWindow();
+  display->fillScreen(GxEPD_WHITE);
+  display->firstPage();
+}
+
+bool DisplayManager::supportsPartialRefresh() {
+#if defined(USE_PARTIAL_REFRESH) && defined(DISPLAY_TYPE_BW)
+  // Only the fast (differential) partial update is worth it, the others flash the window just like a full refresh. Known from
+  // the driver class, so a wakeup which finds the frame unchanged doesn't have to start the display.
+  return DISPLAY_DRIVER_CLASS::hasFastPartialUpdate;
+#else
+  return false;
+#endif
+}
+
+void DisplayManager::beginPartialBitmapDraw(uint16_t top, uint16_t bottom, uint16_t left, uint16_t right) {
+  int pixelsPerByte = DISPLAY_WIDTH / bytesPerRow();
+
+  init();
   startTime = millis();
-  display.fillScreen(GxEPD_WHITE);
-  display.firstPage();
+  bufferingRows = false;
+  partialWindow = true;
+  display->setPartialWindow(left * pixelsPerByte, top, (right - left) * pixelsPerByte, bottom - top);
+  display->firstPage();
+}
+
+void DisplayManager::writePreviousBitmapRow(const uint8_t* data, int16_t y, uint16_t left, uint16_t right) {
+#if defined(USE_PARTIAL_REFRESH) && defined(DISPLAY_TYPE_BW)
+  init();
+  // The same call GxEPD2 uses after a fast partial update to make the previous image match the new one. Server bits are
+  // 1 = black, the controller's are 1 = white.
+  static_cast<DISPLAY_DRIVER_CLASS&>(display->epd2).writeImageAgain(data + left, left * 8, y, (right - left) * 8, 1, true, false, false);
+#endif
 }
 
 void DisplayManager::drawBitmapRow(unsigned char* data, int16_t y) {
   int16_t w = displayWidth();
 
+  if (bufferingRows) {
+    bufferingRows = bufferedFrame.appendRow(y, data);
+  }
+
+#ifdef USE_DIRECT_FRAME_WRITE
+  // Converted a byte at a time, the page buffer isn't involved
+  static uint8_t nativeRow[DISPLAY_WIDTH / 2];
+  int rowBytes = bytesPerRow();
+  for (int i = 0; i < rowBytes; i++) {
+    nativeRow[i] = serverByteToNative[data[i]];
+  }
+#ifdef DISPLAY_TYPE_4G
+  // Written into both memory planes of the controller by the driver
+  static_cast<DISPLAY_DRIVER_CLASS&>(display->epd2).writeImage_4G(nativeRow, 2, 0, y, w, 1);
+#endif
+#ifdef DISPLAY_TYPE_7C
+  // The 7-color controllers only take the whole frame as one stream of rows (the way GxEPD2_7C sends its pages). It's
+  // started again by the first row, also when a download restarts from it.
+  if (y == 0) {
+    display->epd2.setPaged();
+  }
+  display->epd2.writeNative(nativeRow, nullptr, 0, y, w, 1);
+#endif
+  return;
+#endif
+
   int byteIndex = 0;
   int16_t x = 0;
   uint16_t color;
@@ -210,52 +483,43 @@ void DisplayManager::drawBitmapRow(unsigned char* data, int16_t y) {
 #ifdef DISPLAY_TYPE_BW
     // 1 bit per pixel = 8 pixels per byte
     color = serverByteToGxEPDColor[(byte >> 7) & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 6) & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 5) & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 4) & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 3) & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 2) & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 1) & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[byte & 0x01];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
 #endif
 #if defined(DISPLAY_TYPE_3C) || defined(DISPLAY_TYPE_4C)
     // 2 bits per pixel = 4 pixels per byte
     color = serverByteToGxEPDColor[(byte >> 6) & 0x03];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 4) & 0x03];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[(byte >> 2) & 0x03];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
     color = serverByteToGxEPDColor[byte & 0x03];
-    display.drawPixel(x, y, color);
-    x++;
-#endif
-#ifdef DISPLAY_TYPE_7C
-    // 3 bits per pixel = 2 pixels per byte (lower 3 bits used)
-    color = serverByteToGxEPDColor[(byte >> 4) & 0x07];
-    display.drawPixel(x, y, color);
-    x++;
-    color = serverByteToGxEPDColor[byte & 0x07];
-    display.drawPixel(x, y, color);
+    display->drawPixel(x, y, color);
     x++;
 #endif
     byteIndex++;
@@ -263,12 +527,55 @@ void DisplayManager::drawBitmapRow(unsigned char* data, int16_t y) {
 }
 
 bool DisplayManager::nextPageBitmapDraw() {
-  wdt.ping();
+  serviceTicker.run();
   logger.debug("Refreshing display page");
-  return display.nextPage();
+  if (bufferingRows) {
+    logger.debug("Compressed frame: %d bytes", bufferedFrame.size());
+    bufferingRows = false;
+  }
+#ifdef USE_DIRECT_FRAME_WRITE
+  // The frame is complete in the controller's memory
+  display->epd2.refresh(false);
+  bool morePages = false;
+#else
+  bool morePages = display->nextPage();
+#endif
+  powerManager.refreshWaitEnd();
+  if (morePages) {
+    return true;
+  }
+  // The panel has been refreshed with the last page, a partial window is counted by PartialRefresh (once per frame)
+  if (!partialWindow) {
+    refreshScheduler.cleanRefreshDone();
+  }
+  return false;
+}
+
+bool DisplayManager::drawBufferedBitmap() {
+#ifdef USE_COMPRESSED_FRAME
+  static unsigned char row_buffer[DISPLAY_WIDTH];
+
+  if (!bufferedFrame.complete()) {
+    return false;
+  }
+
+  for (int16_t row = 0; row < DISPLAY_HEIGHT; row++) {
+    serviceTicker.tick();
+    if (!bufferedFrame.readRow(row, row_buffer)) {
+      logger.debug("Compressed frame: can't decode row %d", row);
+      bufferedFrame.release();
+      return false;
+    }
+    drawBitmapRow(row_buffer, row);
+  }
+  return true;
+#else
+  return false;
+#endif
 }
 
 void DisplayManager::endBitmapDraw() {
-  //
+  bufferingRows = false;
+  bufferedFrame.release();
   logger.debug("Display refresh time: %lu ms", millis() - startTime);
 }
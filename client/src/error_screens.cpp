@@ -0,0 +1,22 @@
+#include "error_screens.h"
+
+#ifdef USE_PRERENDERED_ERROR_SCREENS
+#include "generated/error_screens_data.h"
+#endif
+
+static const char* const errorScreenTexts[ERROR_SCREEN_COUNT] = {
+#define ERROR_SCREEN_TEXT(id, text) text,
+    ERROR_SCREEN_LIST(ERROR_SCREEN_TEXT)
+#undef ERROR_SCREEN_TEXT
+};
+
+const char* errorScreenText(ErrorScreen screen) { return screen < ERROR_SCREEN_COUNT ? errorScreenTexts[screen] : ""; }
+
+const PrerenderedErrorScreen* prerenderedErrorScreen(ErrorScreen screen) {
+#ifdef HAVE_PRERENDERED_ERROR_SCREENS
+  if (screen < ERROR_SCREEN_COUNT) {
+    return &prerenderedErrorScreens[screen];
+  }
+#endif
+  return nullptr;
+}
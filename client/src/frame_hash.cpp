@@ -0,0 +1,12 @@
+#include "frame_hash.h"
+
+#define FNV_PRIME_64 0x100000001b3ULL
+
+uint64_t frameHashAddRow(uint64_t hash, const uint8_t* data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    hash ^= data[i];
+    hash *= FNV_PRIME_64;
+  }
+  // A hash of exactly 0 would look like an unknown panel content
+  return hash == FRAME_HASH_UNKNOWN ? FRAME_HASH_INIT : hash;
+}
@@ -0,0 +1,367 @@
+#include "frame_schedule.h"
+
+#include "display_manager.h"
+#include "frame_hash.h"
+#include "frame_store.h"
+#include "hw_config.h"
+#include "logger.h"
+#include "packbits.h"
+#include "partial_refresh.h"
+#include "service_ticker.h"
+#include "sleep_timer.h"
+
+#ifdef USE_FRAME_SCHEDULE
+
+#define FRAME_SCHEDULE_PATH "/schedule.bin"
+#define FRAME_SCHEDULE_TMP_PATH "/schedule.tmp"
+#define FRAME_SCHEDULE_MAGIC 0x53534350  // "PCSS"
+#define FRAME_SCHEDULE_VERSION 1
+
+// The RTC timer isn't exact, a wakeup this much before the frame time still counts as being on time
+#define FRAME_SCHEDULE_EARLY_WAKEUP_TOLERANCE 60
+
+struct FrameScheduleHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t width;
+  uint16_t height;
+  uint16_t rowBytes;
+  uint16_t count;
+  uint32_t validUntil;
+};
+
+static bool readPackedRow(File& file, uint8_t* row_buffer, uint16_t rowBytes) {
+  static uint8_t packed[PACKBITS_MAX_ENCODED_SIZE(DISPLAY_WIDTH)];
+
+  uint16_t packedSize = 0;
+  return file.read((uint8_t*)&packedSize, sizeof(packedSize)) == sizeof(packedSize) && packedSize <= sizeof(packed) &&
+         file.read(packed, packedSize) == packedSize && packbitsDecode(packed, packedSize, row_buffer, rowBytes);
+}
+
+#endif
+
+FrameSchedule::FrameSchedule(Logger& logger, ServiceTicker& serviceTicker, DisplayManager& displayManager, FrameStore& frameStore,
+                             PartialRefresh& partialRefresh, SleepTimer& sleepTimer, int& sleepTime, char* lastChecksum, uint64_t& displayedFrameHash)
+    : logger(logger),
+      serviceTicker(serviceTicker),
+      displayManager(displayManager),
+      frameStore(frameStore),
+      partialRefresh(partialRefresh),
+      sleepTimer(sleepTimer),
+      sleepTime(sleepTime),
+      lastChecksum(lastChecksum),
+      displayedFrameHash(displayedFrameHash),
+      count(0),
+      framesWritten(0),
+      validUntil(0),
+      rowBytes(0) {}
+
+bool FrameSchedule::loadIndex() {
+#ifdef USE_FRAME_SCHEDULE
+  if (!frameStore.begin()) {
+    return false;
+  }
+
+  File file = LittleFS.open(FRAME_SCHEDULE_PATH, "r");
+  if (!file) {
+    logger.debug("Frame schedule: none stored");
+    return false;
+  }
+
+  FrameScheduleHeader header;
+  bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) && header.magic == FRAME_SCHEDULE_MAGIC &&
+            header.version == FRAME_SCHEDULE_VERSION && header.width == DISPLAY_WIDTH && header.height == DISPLAY_HEIGHT &&
+            header.rowBytes == displayManager.bytesPerRow() && header.count <= FRAME_SCHEDULE_MAX_FRAMES;
+  if (ok) {
+    size_t indexSize = header.count * sizeof(FrameScheduleEntry);
+    ok = file.read((uint8_t*)entries, indexSize) == indexSize;
+  }
+  file.close();
+
+  if (!ok) {
+    logger.debug("Frame schedule: stored schedule is invalid");
+    return false;
+  }
+
+  count = header.count;
+  validUntil = header.validUntil;
+  rowBytes = header.rowBytes;
+  for (int i = 0; i < count; i++) {
+    entries[i].checksum[sizeof(entries[i].checksum) - 1] = '\0';
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameSchedule::showDueFrame() {
+#ifdef USE_FRAME_SCHEDULE
+  if (!sleepTimer.clockValid()) {
+    logger.debug("Frame schedule: clock not set, skipping");
+    return false;
+  }
+
+  if (!loadIndex()) {
+    return false;
+  }
+
+  uint32_t now = sleepTimer.now();
+
+  if (now + FRAME_SCHEDULE_EARLY_WAKEUP_TOLERANCE >= validUntil) {
+    logger.debug("Frame schedule: expired at %lu", validUntil);
+    clear();
+    return false;
+  }
+
+  int due = -1;
+  for (int i = 0; i < count; i++) {
+    if (entries[i].displayAt <= now + FRAME_SCHEDULE_EARLY_WAKEUP_TOLERANCE) {
+      due = i;
+    }
+  }
+  if (due < 0) {
+    // Woken up before the first frame (e.g. by a button), let the server decide what to show
+    logger.debug("Frame schedule: no frame due yet");
+    return false;
+  }
+
+  uint32_t nextWakeup = due + 1 < count ? entries[due + 1].displayAt : validUntil;
+  logger.debug("Frame schedule: frame %d of %d (at %lu), next wakeup at %lu", due + 1, count, entries[due].displayAt, nextWakeup);
+
+  if (strcmp(entries[due].checksum, lastChecksum) == 0) {
+    logger.debug("Frame schedule: frame already displayed, skipping");
+  } else if (!drawFrame(due)) {
+    clear();
+    return false;
+  }
+
+  sleepTime = nextWakeup > now ? nextWakeup - now : 0;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameSchedule::drawFrame(int index) {
+#ifdef USE_FRAME_SCHEDULE
+  static uint8_t row_buffer[DISPLAY_WIDTH];
+
+  File file = LittleFS.open(FRAME_SCHEDULE_PATH, "r");
+  if (!file) {
+    return false;
+  }
+
+  bool ok = true;
+  uint64_t hash = FRAME_HASH_INIT;
+  if (partialRefresh.begin(rowBytes)) {
+    ok = file.seek(entries[index].offset);
+    for (uint16_t row = 0; row < DISPLAY_HEIGHT && ok; row++) {
+      serviceTicker.tick();
+      ok = readPackedRow(file, row_buffer, rowBytes) && partialRefresh.addRow(row, row_buffer);
+      hash = frameHashAddRow(hash, row_buffer, rowBytes);
+    }
+    if (ok && partialRefresh.show()) {
+      file.close();
+      frameStore.commit(entries[index].checksum);
+      strncpy(lastChecksum, entries[index].checksum, 64);
+      lastChecksum[64] = '\0';
+      displayedFrameHash = hash;
+      return true;
+    }
+    partialRefresh.abort();
+    logger.debug("Frame schedule: partial refresh failed, drawing the whole frame");
+    ok = true;
+  }
+
+  bool storing = false;
+  int pagesDrawn = 0;
+  hash = FRAME_HASH_INIT;
+  displayManager.beginBitmapDraw();
+
+  do {
+    if (pagesDrawn > 0 && displayManager.drawBufferedBitmap()) {
+      pagesDrawn++;
+      continue;
+    }
+
+    // Every page needs all the rows, decoding from flash is cheap compared to the refresh itself
+    if (!file.seek(entries[index].offset)) {
+      ok = false;
+      break;
+    }
+    if (pagesDrawn == 0) {
+      storing = frameStore.beginWrite(rowBytes);
+    }
+
+    for (uint16_t row = 0; row < DISPLAY_HEIGHT; row++) {
+      serviceTicker.tick();
+
+      if (!readPackedRow(file, row_buffer, rowBytes)) {
+        logger.debug("Frame schedule: corrupted data on row %d", row);
+        ok = false;
+        break;
+      }
+
+      displayManager.drawBitmapRow(row_buffer, row);
+      if (storing) {
+        storing = frameStore.writeRow(row, row_buffer);
+      }
+      if (pagesDrawn == 0) {
+        hash = frameHashAddRow(hash, row_buffer, rowBytes);
+      }
+    }
+    if (!ok) {
+      break;
+    }
+    if (pagesDrawn == 0 && hash == displayedFrameHash) {
+      // Whole frame known before the first page is sent to the panel, no need to refresh it with the same pixels
+      logger.debug("Frame schedule: same pixels as on the panel, skipping the refresh");
+      break;
+    }
+    pagesDrawn++;
+  } while (displayManager.nextPageBitmapDraw());
+
+  file.close();
+  displayManager.endBitmapDraw();
+
+  if (!ok) {
+    frameStore.abort();
+    return false;
+  }
+
+  frameStore.commit(entries[index].checksum);
+
+  strncpy(lastChecksum, entries[index].checksum, 64);
+  lastChecksum[64] = '\0';
+  displayedFrameHash = hash;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FrameSchedule::clear() {
+#ifdef USE_FRAME_SCHEDULE
+  abort();
+  if (frameStore.begin() && LittleFS.exists(FRAME_SCHEDULE_PATH)) {
+    logger.debug("Frame schedule: removing stored schedule");
+    LittleFS.remove(FRAME_SCHEDULE_PATH);
+  }
+#endif
+  count = 0;
+}
+
+bool FrameSchedule::beginWrite(uint16_t count, uint32_t validUntil, uint16_t rowBytes) {
+#ifdef USE_FRAME_SCHEDULE
+  abort();
+  if (count > FRAME_SCHEDULE_MAX_FRAMES || !frameStore.begin()) {
+    return false;
+  }
+
+  writeFile = LittleFS.open(FRAME_SCHEDULE_TMP_PATH, "w");
+  if (!writeFile) {
+    logger.debug("Frame schedule: can't create %s", FRAME_SCHEDULE_TMP_PATH);
+    return false;
+  }
+
+  this->count = count;
+  this->validUntil = validUntil;
+  this->rowBytes = rowBytes;
+  framesWritten = 0;
+  memset(entries, 0, sizeof(entries));
+
+  // Placeholder, the real header and index are written by commit()
+  FrameScheduleHeader header = {};
+  writeFile.write((const uint8_t*)&header, sizeof(header));
+  writeFile.write((const uint8_t*)entries, count * sizeof(FrameScheduleEntry));
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameSchedule::beginFrame(uint32_t displayAt, const char* checksum) {
+#ifdef USE_FRAME_SCHEDULE
+  if (!writeFile || framesWritten >= count) {
+    return false;
+  }
+
+  FrameScheduleEntry& entry = entries[framesWritten++];
+  entry.displayAt = displayAt;
+  entry.offset = writeFile.position();
+  strncpy(entry.checksum, checksum, sizeof(entry.checksum) - 1);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameSchedule::writeRow(const uint8_t* data) {
+#ifdef USE_FRAME_SCHEDULE
+  static uint8_t packed[PACKBITS_MAX_ENCODED_SIZE(DISPLAY_WIDTH)];
+
+  if (!writeFile) {
+    return false;
+  }
+
+  uint16_t packedSize = packbitsEncode(data, rowBytes, packed);
+  if (writeFile.write((const uint8_t*)&packedSize, sizeof(packedSize)) != sizeof(packedSize) || writeFile.write(packed, packedSize) != packedSize) {
+    logger.debug("Frame schedule: write failed, discarding");
+    abort();
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameSchedule::commit() {
+#ifdef USE_FRAME_SCHEDULE
+  if (!writeFile) {
+    return false;
+  }
+
+  if (framesWritten != count) {
+    logger.debug("Frame schedule: incomplete (%d of %d frames), discarding", framesWritten, count);
+    abort();
+    return false;
+  }
+
+  FrameScheduleHeader header = {};
+  header.magic = FRAME_SCHEDULE_MAGIC;
+  header.version = FRAME_SCHEDULE_VERSION;
+  header.width = DISPLAY_WIDTH;
+  header.height = DISPLAY_HEIGHT;
+  header.rowBytes = rowBytes;
+  header.count = count;
+  header.validUntil = validUntil;
+
+  uint32_t size = writeFile.size();
+  writeFile.seek(0);
+  writeFile.write((const uint8_t*)&header, sizeof(header));
+  writeFile.write((const uint8_t*)entries, count * sizeof(FrameScheduleEntry));
+  writeFile.close();
+
+  if (!LittleFS.rename(FRAME_SCHEDULE_TMP_PATH, FRAME_SCHEDULE_PATH)) {
+    logger.debug("Frame schedule: rename failed");
+    LittleFS.remove(FRAME_SCHEDULE_TMP_PATH);
+    return false;
+  }
+
+  logger.debug("Frame schedule: saved %d frames (%lu bytes), valid until %lu", count, size, validUntil);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FrameSchedule::abort() {
+#ifdef USE_FRAME_SCHEDULE
+  if (writeFile) {
+    writeFile.close();
+    LittleFS.remove(FRAME_SCHEDULE_TMP_PATH);
+  }
+#endif
+}
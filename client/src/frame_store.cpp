@@ -0,0 +1,288 @@
+#include "frame_store.h"
+
+#include "hw_config.h"
+#include "logger.h"
+
+#ifdef USE_FRAME_STORE
+
+#define FRAME_STORE_PATH "/frame.bin"
+#define FRAME_STORE_TMP_PATH "/frame.tmp"
+#define FRAME_STORE_MAGIC 0x53464350  // "PCFS"
+#define FRAME_STORE_VERSION 1
+
+struct FrameStoreHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t width;
+  uint16_t height;
+  uint16_t rowBytes;
+  char checksum[64 + 1];
+};
+
+static bool readHeader(File& file, FrameStoreHeader& header) {
+  if (!file || file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  if (header.magic != FRAME_STORE_MAGIC || header.version != FRAME_STORE_VERSION || header.width != DISPLAY_WIDTH || header.height != DISPLAY_HEIGHT) {
+    return false;
+  }
+  header.checksum[sizeof(header.checksum) - 1] = '\0';
+  return true;
+}
+
+#endif
+
+FrameStore::FrameStore(Logger& logger) : logger(logger), mounted(false), rowBytes(0) {}
+
+bool FrameStore::begin() {
+#ifdef USE_FRAME_STORE
+  if (mounted) {
+    return true;
+  }
+  uint32_t start = millis();
+  // Formats the partition on the first boot (or if it contains something else than LittleFS)
+  mounted = LittleFS.begin(true);
+  logger.debug("Frame store: %s in %lu ms", mounted ? "mounted" : "mount failed", millis() - start);
+#endif
+  return mounted;
+}
+
+void FrameStore::end() {
+#ifdef USE_FRAME_STORE
+  if (mounted) {
+    abort();
+    endRead();
+    LittleFS.end();
+    mounted = false;
+  }
+#endif
+}
+
+bool FrameStore::loadChecksum(char* checksum, size_t size) {
+  checksum[0] = '\0';
+#ifdef USE_FRAME_STORE
+  if (!begin()) {
+    return false;
+  }
+
+  File file = LittleFS.open(FRAME_STORE_PATH, "r");
+  FrameStoreHeader header;
+  bool ok = readHeader(file, header);
+  if (file) {
+    file.close();
+  }
+  if (!ok) {
+    logger.debug("Frame store: no valid frame stored");
+    return false;
+  }
+
+  strncpy(checksum, header.checksum, size - 1);
+  checksum[size - 1] = '\0';
+  logger.debug("Frame store: stored frame checksum %s", checksum);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FrameStore::invalidate() {
+#ifdef USE_FRAME_STORE
+  if (begin() && LittleFS.exists(FRAME_STORE_PATH)) {
+    logger.debug("Frame store: invalidating stored frame");
+    LittleFS.remove(FRAME_STORE_PATH);
+  }
+#endif
+}
+
+bool FrameStore::retag(const char* oldChecksum, const char* newChecksum) {
+#ifdef USE_FRAME_STORE
+  if (!begin()) {
+    return false;
+  }
+  endRead();
+
+  // Only the header changes, LittleFS commits the file on close so a power loss leaves either the old or the new one
+  File file = LittleFS.open(FRAME_STORE_PATH, "r+");
+  FrameStoreHeader header;
+  bool ok = readHeader(file, header) && strcmp(header.checksum, oldChecksum) == 0;
+  if (ok) {
+    memset(header.checksum, 0, sizeof(header.checksum));
+    strncpy(header.checksum, newChecksum, sizeof(header.checksum) - 1);
+    ok = file.seek(0) && file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+  }
+  if (file) {
+    file.close();
+  }
+  if (!ok) {
+    logger.debug("Frame store: can't retag the stored frame");
+    return false;
+  }
+
+  logger.debug("Frame store: stored frame retagged as %s", newChecksum);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameStore::beginWrite(uint16_t rowBytes) {
+#ifdef USE_FRAME_STORE
+  abort();
+  if (!begin()) {
+    return false;
+  }
+
+  this->rowBytes = rowBytes;
+  // Readable as well, see readPendingRow()
+  writeFile = LittleFS.open(FRAME_STORE_TMP_PATH, "w+");
+  if (!writeFile) {
+    logger.debug("Frame store: can't create %s", FRAME_STORE_TMP_PATH);
+    return false;
+  }
+
+  // Placeholder, the real header is written by commit()
+  FrameStoreHeader header = {};
+  writeFile.write((const uint8_t*)&header, sizeof(header));
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameStore::writeRow(uint16_t row, const uint8_t* data) {
+#ifdef USE_FRAME_STORE
+  if (!writeFile) {
+    return false;
+  }
+
+  uint32_t offset = sizeof(FrameStoreHeader) + (uint32_t)row * rowBytes;
+  if (writeFile.position() != offset && !writeFile.seek(offset)) {
+    return false;
+  }
+  if (writeFile.write(data, rowBytes) != rowBytes) {
+    logger.debug("Frame store: write failed on row %d, discarding", row);
+    abort();
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameStore::commit(const char* checksum) {
+#ifdef USE_FRAME_STORE
+  if (!writeFile) {
+    return false;
+  }
+
+  uint32_t expectedSize = sizeof(FrameStoreHeader) + (uint32_t)DISPLAY_HEIGHT * rowBytes;
+  if (writeFile.size() != expectedSize) {
+    logger.debug("Frame store: incomplete frame (%d of %lu bytes), discarding", writeFile.size(), expectedSize);
+    abort();
+    return false;
+  }
+
+  FrameStoreHeader header = {};
+  header.magic = FRAME_STORE_MAGIC;
+  header.version = FRAME_STORE_VERSION;
+  header.width = DISPLAY_WIDTH;
+  header.height = DISPLAY_HEIGHT;
+  header.rowBytes = rowBytes;
+  strncpy(header.checksum, checksum, sizeof(header.checksum) - 1);
+
+  writeFile.seek(0);
+  writeFile.write((const uint8_t*)&header, sizeof(header));
+  writeFile.close();
+
+  // rename() replaces the old frame atomically, a power loss leaves either the old or the new one
+  if (!LittleFS.rename(FRAME_STORE_TMP_PATH, FRAME_STORE_PATH)) {
+    logger.debug("Frame store: rename failed");
+    LittleFS.remove(FRAME_STORE_TMP_PATH);
+    return false;
+  }
+
+  logger.debug("Frame store: saved frame %s", checksum);
+  return true;
+#else
+  return false;
+#endif
+}
+
+void FrameStore::abort() {
+#ifdef USE_FRAME_STORE
+  if (writeFile) {
+    writeFile.close();
+    LittleFS.remove(FRAME_STORE_TMP_PATH);
+  }
+#endif
+}
+
+bool FrameStore::pendingComplete() {
+#ifdef USE_FRAME_STORE
+  // A failed write closes the file, see writeRow()
+  return writeFile && writeFile.size() == sizeof(FrameStoreHeader) + (uint32_t)DISPLAY_HEIGHT * rowBytes;
+#else
+  return false;
+#endif
+}
+
+bool FrameStore::readPendingRow(uint16_t row, uint8_t* data) {
+#ifdef USE_FRAME_STORE
+  if (!writeFile || row >= DISPLAY_HEIGHT) {
+    return false;
+  }
+
+  uint32_t offset = sizeof(FrameStoreHeader) + (uint32_t)row * rowBytes;
+  if (writeFile.position() != offset && !writeFile.seek(offset)) {
+    return false;
+  }
+  return writeFile.read(data, rowBytes) == rowBytes;
+#else
+  return false;
+#endif
+}
+
+bool FrameStore::beginRead() {
+#ifdef USE_FRAME_STORE
+  endRead();
+  if (!begin()) {
+    return false;
+  }
+
+  readFile = LittleFS.open(FRAME_STORE_PATH, "r");
+  FrameStoreHeader header;
+  if (!readHeader(readFile, header)) {
+    endRead();
+    return false;
+  }
+  rowBytes = header.rowBytes;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool FrameStore::readRow(uint16_t row, uint8_t* data) {
+#ifdef USE_FRAME_STORE
+  if (!readFile || row >= DISPLAY_HEIGHT) {
+    return false;
+  }
+
+  uint32_t offset = sizeof(FrameStoreHeader) + (uint32_t)row * rowBytes;
+  if (readFile.position() != offset && !readFile.seek(offset)) {
+    return false;
+  }
+  return readFile.read(data, rowBytes) == rowBytes;
+#else
+  return false;
+#endif
+}
+
+void FrameStore::endRead() {
+#ifdef USE_FRAME_STORE
+  if (readFile) {
+    readFile.close();
+  }
+#endif
+}
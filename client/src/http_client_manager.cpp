@@ -4,26 +4,51 @@
 #include <ESPmDNS.h>
 #include <HTTPClient.h>
 
+#include "battery_model.h"
+#include "device_protocol.h"
 #include "display_manager.h"
+#include "frame_hash.h"
+#include "frame_schedule.h"
+#include "frame_store.h"
 #include "hw_config.h"
 #include "logger.h"
 #include "main.h"
+#include "memory_profiler.h"
 #include "ota_manager.h"
+#include "packbits.h"
+#include "partial_refresh.h"
+#include "power_manager.h"
+#include "refresh_scheduler.h"
+#include "service_ticker.h"
+#include "tls_client.h"
 #include "system_info.h"
 #include "version.h"
 #include "voltage.h"
-#include "wdt_manager.h"
+#include "wifi_client.h"
 
-HTTPClientManager::HTTPClientManager(Logger& logger, WDTManager& wdtManager, OTAManager& otaManager, VoltageReader& voltageReader, SystemInfo& systemInfo,
-                                     DisplayManager& displayManager, int& sleepTime, char* lastChecksum, const char* defined_color_type)
+HTTPClientManager::HTTPClientManager(Logger& logger, ServiceTicker& serviceTicker, OTAManager& otaManager, PowerManager& powerManager, VoltageReader& voltageReader,
+                                     BatteryModel& batteryModel, SystemInfo& systemInfo, MemoryProfiler& memoryProfiler, TlsClient& tlsClient, DisplayManager& displayManager,
+                                     FrameStore& frameStore, PartialRefresh& partialRefresh, RefreshScheduler& refreshScheduler,
+                                     FrameSchedule& frameSchedule, int& sleepTime, char* lastChecksum, uint64_t& displayedFrameHash, bool& staticTelemetrySent,
+                                     const char* defined_color_type)
     : logger(logger),
-      wdtManager(wdtManager),
+      serviceTicker(serviceTicker),
       otaManager(otaManager),
+      powerManager(powerManager),
       voltageReader(voltageReader),
+      batteryModel(batteryModel),
       displayManager(displayManager),
       systemInfo(systemInfo),
+      memoryProfiler(memoryProfiler),
+      tlsClient(tlsClient),
+      frameStore(frameStore),
+      partialRefresh(partialRefresh),
+      refreshScheduler(refreshScheduler),
+      frameSchedule(frameSchedule),
       sleepTime(sleepTime),
       lastChecksum(lastChecksum),
+      displayedFrameHash(displayedFrameHash),
+      staticTelemetrySent(staticTelemetrySent),
       defined_color_type(defined_color_type) {}
 
 String HTTPClientManager::statusCodeAsString(int statusCode) {
@@ -47,10 +72,17 @@ String HTTPClientManager::statusCodeAsString(int statusCode) {
   }
 }
 
+#ifdef USE_HTTPS
+#define SERVER_URL_SCHEME "https://"
+#else
+#define SERVER_URL_SCHEME "http://"
+#endif
+
 void HTTPClientManager::init() {
+  tlsClient.beginWake();
 #ifdef USE_MDNS_FOR_SERVER
-  // Note: MDNS.begin() is already called by ArduinoOTA.begin() in OTAManager::init(),
-  // no need to call it again here.
+  // MDNS.begin() is called by ArduinoOTA.begin() in OTAManager::init() (not at boot with USE_FAST_BOOT)
+  otaManager.init();
 
   logger.debug("mDNS: Querying for _portal-calendar._tcp service...");
   int n = MDNS.queryService("portal-calendar", "tcp");
@@ -63,17 +95,35 @@ void HTTPClientManager::init() {
   IPAddress ip = MDNS.IP(0);
   uint16_t port = MDNS.port(0);
   logger.debug("mDNS: Found server at %s:%d", ip.toString().c_str(), port);
-  serverUrl = String("http://") + ip.toString() + ":" + String(port);
+  serverUrl = String(SERVER_URL_SCHEME) + ip.toString() + ":" + String(port);
+#else
+  serverUrl = String(SERVER_URL_SCHEME) + CALENDAR_URL_HOST + ":" + String(CALENDAR_URL_PORT);
+#endif
+}
+
+// Every request goes through the TLS client with USE_HTTPS, which resumes the cached session
+void HTTPClientManager::_beginRequest(HTTPClient& http, const String& url) {
+#ifdef USE_HTTPS
+  http.begin(tlsClient, url);
 #else
-  serverUrl = String("http://") + CALENDAR_URL_HOST + ":" + String(CALENDAR_URL_PORT);
+  http.begin(url);
 #endif
 }
 
 int HTTPClientManager::readLineFromStream(WiFiClient* stream, String& result) {
   result = "";
   int bytesRead = 0;
+  uint32_t start = millis();
+
+  while (true) {
+    if (!stream->available()) {
+      uint32_t elapsed = millis() - start;
+      if (elapsed >= 5000 || !stream->connected() || !waitForSocketData(*stream, 5000 - elapsed, &powerManager)) {
+        break;
+      }
+      continue;
+    }
 
-  while (stream->available()) {
     char c = stream->read();
     bytesRead++;
 
@@ -84,23 +134,41 @@ int HTTPClientManager::readLineFromStream(WiFiClient* stream, String& result) {
       result += c;
     }
 
-    wdtManager.ping();
-    otaManager.loop();
+    serviceTicker.tick();
   }
 
   return bytesRead;
 }
 
+// Reads one row of a v3 bitmap in the given encoding, returns the number of bytes taken from the stream or -1 on error
+int HTTPClientManager::_readBitmapRow(WiFiClient* stream, uint8_t encoding, unsigned char* row, int rowBytes) {
+  static uint8_t packed[PACKBITS_MAX_ENCODED_SIZE(DISPLAY_WIDTH)];
+
+  if (encoding == BITMAP_ENCODING_RAW) {
+    return readWithDeadline(*stream, row, rowBytes, 1000, &powerManager) == rowBytes ? rowBytes : -1;  // 1 second timeout per row
+  }
+
+  uint8_t length[2];
+  if (readWithDeadline(*stream, length, sizeof(length), 1000, &powerManager) != sizeof(length)) {
+    return -1;
+  }
+  size_t packedSize = length[0] | (size_t)length[1] << 8;
+  if (packedSize > PACKBITS_MAX_ENCODED_SIZE((size_t)rowBytes) || readWithDeadline(*stream, packed, packedSize, 1000, &powerManager) != (int)packedSize) {
+    return -1;
+  }
+  if (!packbitsDecode(packed, packedSize, row, rowBytes)) {
+    logger.debug("WARNING: Corrupted PackBits row");
+    return -1;
+  }
+  return sizeof(length) + packedSize;
+}
+
 bool HTTPClientManager::_verifyConfig() {
   if (serverUrl == "") {
     sleepTime = SLEEP_TIME_PERMANENT_ERROR;
 #ifdef USE_MDNS_FOR_SERVER
-    lastErrorMessage =
-        "mDNS is enabled but no server found on LAN.\n"
-        "\n"
-        "Ensure that the server is running\n"
-        "on the same network as this device (" +
-        WiFi.localIP().toString() + ").\n";
+    lastErrorScreen = ERROR_SCREEN_NO_SERVER;
+    lastErrorMessage = "Device IP: " + WiFi.localIP().toString();
 #else
     lastErrorMessage =  //
         "Server URL is not set. Please check your platformio.ini configuration.\n";
@@ -111,7 +179,7 @@ bool HTTPClientManager::_verifyConfig() {
   return true;
 }
 
-bool HTTPClientManager::loadConfigFromWeb(uint32_t& configLoadTime, bool& otaMode) {
+bool HTTPClientManager::loadConfigFromWeb(uint32_t& configLoadTime, bool& otaMode, uint32_t& serverTime) {
   if (!_verifyConfig()) {
     return false;
   }
@@ -119,36 +187,91 @@ bool HTTPClientManager::loadConfigFromWeb(uint32_t& configLoadTime, bool& otaMod
   logger.debug("loadConfigFromWeb()");
   configLoadTime = millis();
 
+  // Telemetry goes in the body as a MessagePack map (see DeviceTelemetry on the server side). Values which can't change
+  // between deep sleeps are only sent after a reset or when the server asks for them.
+  StaticJsonDocument<768> telemetry;
+  telemetry["ver"] = TELEMETRY_VERSION;
+  telemetry["mac"] = WiFi.macAddress();
+  telemetry["fw"] = FIRMWARE_VERSION;
+  telemetry["c"] = defined_color_type;
+  telemetry["adc"] = voltageReader.getAdcRaw();
+  telemetry["v"] = voltageReader.getVoltageReal();
+  telemetry["reset"] = systemInfo.resetReasonAsString();
+  telemetry["wakeup"] = systemInfo.wakeupReasonAsString();
+  telemetry["rssi"] = WiFi.RSSI();
+  telemetry["heap"] = ESP.getFreeHeap();
+  telemetry["minheap"] = ESP.getMinFreeHeap();
+  telemetry["wifi"] = systemInfo.wifiConnectTime;
+  telemetry["up"] = millis();
+  telemetry["bpol"] = (int)batteryModel.policy();
+  telemetry["bsf"] = batteryModel.sleepFactor();
+  float batteryDays = batteryModel.daysRemaining();
+  if (batteryDays >= 0) {
+    telemetry["bdays"] = batteryDays;
+  }
+  if (memoryProfiler.hasMinima()) {
+    // Minima of the previous wakeups, this one hasn't downloaded the frame yet
+    const MemoryMinima& memory = memoryProfiler.minima();
+    telemetry["mheap"] = memory.freeHeap;
+    telemetry["mblk"] = memory.largestBlock;
+    if (memory.freePsram > 0) {
+      telemetry["mpsram"] = memory.freePsram;
+    }
+    telemetry["mstk"] = memory.loopStack;
+    telemetry["mstkip"] = memory.tcpipStack;
+  }
+  uint8_t tlsHandshakes, tlsResumed;
+  uint32_t tlsHandshakeMs;
+  if (tlsClient.lastWakeStats(tlsHandshakes, tlsResumed, tlsHandshakeMs)) {
+    // Of the previous wakeup as well, this request is the one making the handshake
+    telemetry["tlsn"] = tlsHandshakes;
+    telemetry["tlsr"] = tlsResumed;
+    telemetry["tlsms"] = tlsHandshakeMs;
+  }
+  if (!staticTelemetrySent) {
+    telemetry["w"] = DISPLAY_WIDTH;
+    telemetry["h"] = DISPLAY_HEIGHT;
+    telemetry["rot"] = DISPLAY_ROTATION;  // new in 2.1.1, not used for anything yet
+    telemetry["vmin"] = VOLTAGE_MIN;
+    telemetry["vmax"] = VOLTAGE_MAX;
+    telemetry["vlmin"] = VOLTAGE_LINEAR_MIN;
+    telemetry["vlmax"] = VOLTAGE_LINEAR_MAX;
+  }
+
+  if (telemetry.overflowed()) {
+    logger.debug("WARNING: telemetry document full, some values not sent");
+  }
+  // Sized for the actual values, a map cut short would be refused by the server
+  size_t bodySize = measureMsgPack(telemetry);
+  uint8_t* body = (uint8_t*)malloc(bodySize);
+  if (body == nullptr) {
+    sleepTime = SLEEP_TIME_TEMPORARY_ERROR;
+    lastErrorScreen = ERROR_SCREEN_CONFIG_FAILED;
+    lastErrorMessage = "Out of memory for the telemetry (" + String(bodySize) + " bytes)";
+    return false;
+  }
+  serializeMsgPack(telemetry, body, bodySize);
+
   HTTPClient http;
-  String url = serverUrl + "/api/device/config?mac=" + WiFi.macAddress() +  //
-               "&adc=" + String(voltageReader.getAdcRaw()) +                //
-               "&v=" + String(voltageReader.getVoltageReal()) +             //
-               "&vmin=" + String(VOLTAGE_MIN) +                             //
-               "&vmax=" + String(VOLTAGE_MAX) +                             //
-               "&vlmin=" + String(VOLTAGE_LINEAR_MIN) +                     //
-               "&vlmax=" + String(VOLTAGE_LINEAR_MAX) +                     //
-               "&w=" + String(DISPLAY_WIDTH) +                              //
-               "&h=" + String(DISPLAY_HEIGHT) +                             //
-               "&c=" + String(defined_color_type) +                         //
-               "&fw=" + String(FIRMWARE_VERSION) +                          //
-               "&rot=" + String(DISPLAY_ROTATION) +                         // new in 2.1.1, not used for anything yet
-               "&reset=" + systemInfo.resetReasonAsString() +               //
-               "&wakeup=" + systemInfo.wakeupReasonAsString();
-
-  logger.trace("URL: %s", url.c_str());
-  http.begin(url);
+  String url = serverUrl + DEVICE_API_CONFIG_PATH;
+  logger.trace("URL: %s, telemetry: %d bytes", url.c_str(), bodySize);
+  _beginRequest(http, url);
   http.setTimeout(10000);
+  http.addHeader("Content-Type", "application/msgpack");
 
-  int httpCode = http.GET();
+  int httpCode = http.POST(body, bodySize);
+  free(body);
   logger.debug("HTTP response code: %d (%s)", httpCode, statusCodeAsString(httpCode).c_str());
 
   if (httpCode != 200) {
     sleepTime = SLEEP_TIME_TEMPORARY_ERROR;
     logger.debug("Failed to load config, HTTP code: %d", httpCode);
     http.end();
-    lastErrorMessage = "Failed to load config, HTTP code: " + String(httpCode) + " (" + statusCodeAsString(httpCode) + ")";
+    lastErrorScreen = ERROR_SCREEN_CONFIG_FAILED;
+    lastErrorMessage = "HTTP code: " + String(httpCode) + " (" + statusCodeAsString(httpCode) + ")";
     return false;
   }
+  memoryProfiler.minimaSent();
 
   String jsonText = http.getString();
   http.end();
@@ -169,6 +292,30 @@ bool HTTPClientManager::loadConfigFromWeb(uint32_t& configLoadTime, bool& otaMod
     sleepTime = tmpi;
   }
 
+  serverTime = response["now"] | 0;
+  uint32_t nextChange = response["next_change"] | 0;
+  logger.trace("serverTime from JSON: %lu, nextChange: %lu", serverTime, nextChange);
+  if (serverTime != 0 && nextChange > serverTime) {
+    // Absolute wakeup time measured against the server clock, the request latency doesn't shift the wakeup then
+    sleepTime = min(nextChange - serverTime, (uint32_t)SLEEP_TIME_MAX);
+    configLoadTime = millis();
+  }
+
+  // The server may have lost the static values (e.g. the display has been deleted and created again)
+  staticTelemetrySent = !(response["resend_static"] | false);
+
+  refreshScheduler.configure(response["max_fast_refreshes"] | -1, response["clean_refresh_at"] | 0);
+
+  scheduleFrameCount = response["schedule"] | 0;
+  logger.trace("scheduleFrameCount from JSON: %d", scheduleFrameCount);
+
+  firmwareVersion = (const char*)(response["firmware"]["version"] | "");
+  firmwareSize = response["firmware"]["size"] | 0;
+  firmwareSha256 = (const char*)(response["firmware"]["sha256"] | "");
+  if (firmwareVersion != "") {
+    logger.debug("Firmware %s (%d bytes) offered by the server", firmwareVersion.c_str(), firmwareSize);
+  }
+
   bool tmpb = response["ota_mode"];
   logger.trace("otaMode from JSON: %d", tmpb);
   otaMode = tmpb;
@@ -181,7 +328,7 @@ bool HTTPClientManager::loadConfigFromWeb(uint32_t& configLoadTime, bool& otaMod
     }
   }
 
-  wdtManager.ping();
+  serviceTicker.tick();
   return true;
 }
 
@@ -191,21 +338,74 @@ bool HTTPClientManager::showRawBitmapFromWeb() {
   }
 
   String newChecksum = "?";
+  int pagesDrawn = 0;
+
+  int status = _showBitmapWithPartialRefresh(newChecksum);
+  if (status == 0) {
+    status = _downloadDeferredBitmap(newChecksum);
+  }
+  if (status < 0) {
+    return false;
+  } else if (status > 0) {
+    // A pending frame updates the checksum once it's on the panel
+    if (pendingFrame == PENDING_FRAME_NONE) {
+      strncpy(lastChecksum, newChecksum.c_str(), 64);
+      lastChecksum[64] = '\0';
+    }
+    return true;
+  }
+
+  // Of the download which stored the rows into flash (the first page)
+  String storedChecksum = "";
+  uint64_t storedFrameHash = FRAME_HASH_UNKNOWN;
+  bool frameChanged = false;
+
   displayManager.beginBitmapDraw();
 
   do {
-    int status = _displayPartialPageFromWeb(newChecksum);
+    if (pagesDrawn > 0 && displayManager.drawBufferedBitmap()) {
+      // The following pages are drawn from the compressed copy of the frame kept in RAM, no need to download it again
+      pagesDrawn++;
+      continue;
+    }
+
+    // Without the compressed copy all rows are downloaded for every page, it's enough to store them into flash during the first one
+    int status = _displayPartialPageFromWeb(newChecksum, pagesDrawn == 0);
     if (status < 0) {
       // error
+      frameStore.abort();
       return false;
-    } else if (status == 0) {
+    }
+    if (pagesDrawn == 0) {
+      storedChecksum = newChecksum;
+      storedFrameHash = downloadedFrameHash;
+    } else if (newChecksum != storedChecksum) {
+      // Regenerated on the server between the pages, the panel gets parts of two frames
+      frameChanged = true;
+    }
+    if (status == 0) {
       // not modified, no need to continue and definitely no need to switch pages
       break;
     }
+    pagesDrawn++;
   } while (displayManager.nextPageBitmapDraw());
 
   displayManager.endBitmapDraw();
 
+  if (frameChanged) {
+    // Neither the stored rows nor the checksum describe the panel, the next wakeup draws the frame again
+    logger.debug("Frame changed on the server between the pages, not storing it");
+    frameStore.abort();
+    strcpy(lastChecksum, "");
+    displayedFrameHash = FRAME_HASH_UNKNOWN;
+    return true;
+  }
+
+  if (pagesDrawn > 0) {
+    frameStore.commit(storedChecksum.c_str());
+    displayedFrameHash = storedFrameHash;
+  }
+
   // Update checksum in semi-permanent storage for next time
   strncpy(lastChecksum, newChecksum.c_str(), 64);
   lastChecksum[64] = '\0';
@@ -213,29 +413,165 @@ bool HTTPClientManager::showRawBitmapFromWeb() {
   return true;
 }
 
-int HTTPClientManager::_displayPartialPageFromWeb(String& newChecksum) {
+// Downloads the frame into the frame store and refreshes only what changed, see PartialRefresh. Returns -1 on error, 1 if
+// the frame is on the panel (or unchanged) and 0 if it has to be drawn the usual way.
+int HTTPClientManager::_showBitmapWithPartialRefresh(String& newChecksum) {
+#ifdef USE_PARTIAL_REFRESH
+  if (!partialRefresh.begin(displayManager.bytesPerRow())) {
+    return 0;
+  }
+
+  int status = _displayPartialPageFromWeb(newChecksum, false, BITMAP_ROWS_TO_PARTIAL_REFRESH);
+  if (status < 0) {
+    partialRefresh.abort();
+    return -1;
+  } else if (status == 0) {
+    partialRefresh.abort();
+    return 1;
+  }
+
+#ifdef USE_DEFERRED_REFRESH
+  if (!frameStore.pendingComplete()) {
+    partialRefresh.abort();
+    logger.debug("Partial refresh: frame store failed, downloading the frame again");
+    return 0;
+  }
+  // Shown by showPendingFrame() once WiFi is off
+  pendingFrame = PENDING_FRAME_PARTIAL;
+  pendingChecksum = newChecksum;
+  return 1;
+#endif
+
+  if (!partialRefresh.show()) {
+    partialRefresh.abort();
+    logger.debug("Partial refresh failed, downloading the whole frame again");
+    return 0;
+  }
+  frameStore.commit(newChecksum.c_str());
+  displayedFrameHash = downloadedFrameHash;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+// Downloads the whole frame into the frame store without touching the panel, showPendingFrame() draws it after WiFi has been
+// switched off. Returns -1 on error, 1 if the frame is stored (or unchanged) and 0 if it has to be drawn the usual way.
+int HTTPClientManager::_downloadDeferredBitmap(String& newChecksum) {
+#ifdef USE_DEFERRED_REFRESH
+  if (!frameStore.begin()) {
+    return 0;
+  }
+
+  // The pending file is created only once the header says the frame has to be downloaded
+  int status = _displayPartialPageFromWeb(newChecksum, true, BITMAP_ROWS_TO_FRAME_STORE);
+  if (status < 0) {
+    frameStore.abort();
+    return -1;
+  } else if (status == 0) {
+    frameStore.abort();
+    return 1;
+  }
+
+  if (!frameStore.pendingComplete()) {
+    // Nothing has been drawn yet, so the panel still shows the previous frame
+    frameStore.abort();
+    logger.debug("Deferred refresh: frame store failed, downloading the frame again");
+    return 0;
+  }
+  pendingFrame = PENDING_FRAME_FULL;
+  pendingChecksum = newChecksum;
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+bool HTTPClientManager::_drawPendingFrame() {
+  static unsigned char row_buffer[DISPLAY_WIDTH];
+
+  int pagesDrawn = 0;
+  displayManager.beginBitmapDraw();
+  do {
+    if (pagesDrawn > 0 && displayManager.drawBufferedBitmap()) {
+      pagesDrawn++;
+      continue;
+    }
+    for (uint16_t row = 0; row < DISPLAY_HEIGHT; row++) {
+      serviceTicker.tick();
+      if (!frameStore.readPendingRow(row, row_buffer)) {
+        logger.debug("Deferred refresh: can't read row %d from the frame store", row);
+        displayManager.endBitmapDraw();
+        return false;
+      }
+      displayManager.drawBitmapRow(row_buffer, row);
+    }
+    pagesDrawn++;
+  } while (displayManager.nextPageBitmapDraw());
+  displayManager.endBitmapDraw();
+  return true;
+}
+
+bool HTTPClientManager::showPendingFrame() {
+  if (pendingFrame == PENDING_FRAME_NONE) {
+    return true;
+  }
+
+  uint32_t startTime = millis();
+  bool ok = pendingFrame == PENDING_FRAME_PARTIAL && partialRefresh.show();
+  if (!ok) {
+    if (pendingFrame == PENDING_FRAME_PARTIAL) {
+      logger.debug("Partial refresh failed, drawing the whole frame");
+    }
+    // The downloaded rows are still in the frame store
+    ok = _drawPendingFrame();
+  }
+  pendingFrame = PENDING_FRAME_NONE;
+
+  if (!ok) {
+    // Whatever is on the panel now, the next wakeup downloads and draws the frame again
+    partialRefresh.abort();
+    strcpy(lastChecksum, "");
+    displayedFrameHash = FRAME_HASH_UNKNOWN;
+    return false;
+  }
+
+  frameStore.commit(pendingChecksum.c_str());
+  displayedFrameHash = downloadedFrameHash;
+  strncpy(lastChecksum, pendingChecksum.c_str(), 64);
+  lastChecksum[64] = '\0';
+  logger.debug("Deferred refresh: done in %lu ms", millis() - startTime);
+  return true;
+}
+
+int HTTPClientManager::_displayPartialPageFromWeb(String& newChecksum, bool storeRows, BitmapRowTarget rowTarget) {
   static unsigned char row_buffer[DISPLAY_WIDTH];  // 1 byte per pixel as a theoretical worst case, actual may be less depending on display type
 
   uint32_t startTime = millis();
 
-  String path = "/api/device/bitmap/epaper";
-  String url = serverUrl + path + "?" +      //
-               "mac=" + WiFi.macAddress() +  //
-               "&fmt=2"                      // format 2 = optimized for simple pixel drawing, no HW-specific code on server side
-      ;
-  logger.debug("Loading bitmap from: %s", url.c_str());
+  char path[DEVICE_API_MAX_PATH];
+  String mac = WiFi.macAddress();
+  buildBitmapPath(path, sizeof(path), mac.c_str(), 0, DEVICE_CAPABILITIES);
+  logger.debug("Loading bitmap from: %s%s", serverUrl.c_str(), path);
 
   int rowBytes = displayManager.bytesPerRow();
   bool ok = false;
 
+  // Rows already drawn into the page buffer are kept between attempts, a retry only asks the server for the missing tail.
+  uint16_t firstMissingRow = 0;
+  String frameChecksum = "";
+  bool storing = false;
+  downloadedFrameHash = FRAME_HASH_INIT;
+
   for (int attempt = 1; attempt <= 5; attempt++) {
     if (attempt > 1) {
-      logger.debug("Retrying download, attempt #%d", attempt);
+      logger.debug("Retrying download from row %d, attempt #%d", firstMissingRow, attempt);
       delay(1000);
     }
+    buildBitmapPath(path, sizeof(path), mac.c_str(), firstMissingRow, DEVICE_CAPABILITIES);
 
     HTTPClient http;
-    http.begin(url);
+    _beginRequest(http, serverUrl + path);
     http.setTimeout(30000);  // 30 second timeout for bitmap download
 
     int httpCode = http.GET();
@@ -250,23 +586,53 @@ int HTTPClientManager::_displayPartialPageFromWeb(String& newChecksum) {
     int contentLength = http.getSize();
     logger.debug("Content length: %d", contentLength);
 
-    // Read magic header "MM"
-    wdtManager.ping();
-    String line;
-    int bytesRead = readLineFromStream(stream, line);
-
-    logger.debug("Magic: %s", line.c_str());
-    if (line != "MM") {
+    // Binary header, the whole frame is validated before the first row arrives
+    serviceTicker.tick();
+    uint8_t headerData[BITMAP_V3_HEADER_SIZE];
+    BitmapV3Header header;
+    int bytesRead = readWithDeadline(*stream, headerData, sizeof(headerData), 5000, &powerManager);
+    if (bytesRead != sizeof(headerData)) {
+      logger.debug("WARNING: Timeout waiting for the bitmap header");
+      http.end();
+      continue;  // next attempt
+    }
+    if (!parseBitmapV3Header(headerData, header)) {
       sleepTime = SLEEP_TIME_PERMANENT_ERROR;
       http.end();
-      lastErrorMessage = "Invalid magic header: " + line;
+      lastErrorMessage = "Invalid bitmap header (is the server older than the firmware?)";
       return -1;
     }
+    // Fields added by a newer server are skipped
+    bool skipError = false;
+    while (bytesRead < header.headerSize) {
+      int skip = min(header.headerSize - bytesRead, (int)sizeof(row_buffer));
+      if (readWithDeadline(*stream, row_buffer, skip, 1000, &powerManager) != skip) {
+        skipError = true;
+        break;
+      }
+      bytesRead += skip;
+    }
+    if (skipError) {
+      // The rows wouldn't start where expected
+      logger.debug("WARNING: Timeout waiting for the rest of the bitmap header");
+      http.end();
+      continue;  // next attempt
+    }
 
-    // Read checksum
-    wdtManager.ping();
-    bytesRead += readLineFromStream(stream, line);
-    newChecksum = line;
+    logger.debug("Bitmap: %dx%d, %d bpp, encoding %d, rows %d+%d, %lu bytes", header.width, header.height, header.bitsPerPixel,
+                 header.encoding, header.firstRow, header.rowCount, header.payloadLength);
+    const char* headerError =
+        validateBitmapV3Header(header, DISPLAY_WIDTH, DISPLAY_HEIGHT, displayManager.bitsPerPixel(), firstMissingRow, DEVICE_CAPABILITIES);
+    if (headerError == nullptr && contentLength > 0 && (uint32_t)contentLength != header.headerSize + header.payloadLength) {
+      headerError = "content length doesn't match the header";
+    }
+    if (headerError != nullptr) {
+      sleepTime = SLEEP_TIME_PERMANENT_ERROR;
+      http.end();
+      lastErrorMessage = String("Invalid bitmap: ") + headerError;
+      return -1;
+    }
+    newChecksum = header.checksum;
 
     logger.debug("Last checksum: %s", lastChecksum);
     logger.debug("New checksum: %s", newChecksum.c_str());
@@ -276,33 +642,59 @@ int HTTPClientManager::_displayPartialPageFromWeb(String& newChecksum) {
       http.end();
       return 0;
     }
+    if (header.frameHash == displayedFrameHash) {
+      // Regenerated on the server but with the same pixels, known from the header without downloading the rows. The caller
+      // takes over the new checksum only if the stored frame does too, otherwise PartialRefresh::begin() wouldn't find the
+      // displayed frame on the next wakeup.
+      logger.debug("Frame hash unchanged, skipping");
+      http.end();
+      if (!frameStore.retag(lastChecksum, newChecksum.c_str())) {
+        newChecksum = lastChecksum;
+      }
+      return 0;
+    }
+
+    if (firstMissingRow > 0 && newChecksum != frameChecksum) {
+      // The image has been regenerated on the server since the first attempt, the rows we already have are useless
+      logger.debug("Checksum changed between attempts, restarting download from row 0");
+      firstMissingRow = 0;
+      downloadedFrameHash = FRAME_HASH_INIT;
+      http.end();
+      continue;
+    }
+    frameChecksum = newChecksum;
+
+    if (storeRows && !storing && firstMissingRow == 0) {
+      // Opened only now that the rows are known to be needed. Not on a retry from the middle of the frame, the file would
+      // be missing the rows before it.
+      storing = frameStore.beginWrite(rowBytes);
+    }
 
     logger.debug("Reading bitmap data");
     uint32_t totalBytesRead = bytesRead;
+    uint32_t expectedBytes = bytesRead + header.payloadLength;
     bool readError = false;
 
-    for (uint16_t row = 0; row < displayManager.displayHeight(); row++) {
-      wdtManager.ping();
-      otaManager.loop();
-
-      int timeout = 100;  // 1 second timeout per row
-      while (stream->available() < rowBytes && timeout > 0) {
-        delay(10);
-        timeout--;
-      }
+    for (uint16_t row = firstMissingRow; row < DISPLAY_HEIGHT; row++) {
+      serviceTicker.tick();
 
-      if (stream->available() >= rowBytes) {
-        size_t read = stream->readBytes(row_buffer, rowBytes);
-        if (read == (size_t)rowBytes) {
+      int read = _readBitmapRow(stream, header.encoding, row_buffer, rowBytes);
+      if (read > 0) {
+        if (rowTarget == BITMAP_ROWS_TO_PARTIAL_REFRESH) {
+          // A failure here is noticed by PartialRefresh::show()
+          partialRefresh.addRow(row, row_buffer);
+        } else if (rowTarget == BITMAP_ROWS_TO_DISPLAY) {
           displayManager.drawBitmapRow(row_buffer, row);
-          totalBytesRead += read;
-        } else {
-          logger.debug("WARNING: Read %d bytes, expected %d on row %d", read, rowBytes, row);
-          readError = true;
-          break;
         }
+        // BITMAP_ROWS_TO_FRAME_STORE rows are only stored, a failure is noticed by FrameStore::pendingComplete()
+        if (storing) {
+          storing = frameStore.writeRow(row, row_buffer);
+        }
+        downloadedFrameHash = frameHashAddRow(downloadedFrameHash, row_buffer, rowBytes);
+        totalBytesRead += read;
+        firstMissingRow = row + 1;
       } else {
-        logger.debug("WARNING: Timeout waiting for data on row %d", row);
+        logger.debug("WARNING: Failed to read row %d", row);
         readError = true;
         break;
       }
@@ -310,8 +702,15 @@ int HTTPClientManager::_displayPartialPageFromWeb(String& newChecksum) {
 
     http.end();
 
-    logger.debug("Total bytes read: %d, expected: %d", totalBytesRead, contentLength);
+    logger.debug("Total bytes read: %d, expected: %d (content length %d)", totalBytesRead, expectedBytes, contentLength);
 
+    if (!readError && downloadedFrameHash != header.frameHash) {
+      // All rows arrived but not the ones the server has hashed, none of them can be trusted
+      logger.debug("WARNING: Frame hash mismatch, downloading the whole frame again");
+      firstMissingRow = 0;
+      downloadedFrameHash = FRAME_HASH_INIT;
+      continue;
+    }
     if (!readError) {
       ok = true;
       break;
@@ -322,11 +721,172 @@ int HTTPClientManager::_displayPartialPageFromWeb(String& newChecksum) {
 
   if (!ok) {
     sleepTime = SLEEP_TIME_PERMANENT_ERROR;
-    lastErrorMessage = "Failed to download image after all attempts";
+    lastErrorScreen = ERROR_SCREEN_DOWNLOAD_FAILED;
+    lastErrorMessage = "";
     return -1;
   }
 
-  wdtManager.ping();
+  serviceTicker.tick();
 
   return 1;
 }
+
+bool HTTPClientManager::loadFrameScheduleFromWeb() {
+#ifdef USE_FRAME_SCHEDULE
+  static unsigned char row_buffer[DISPLAY_WIDTH];
+
+  // Whatever was stored before is superseded by what the server says now
+  frameSchedule.clear();
+
+  int requested = min(scheduleFrameCount, FRAME_SCHEDULE_MAX_FRAMES);
+  if (requested <= 0 || !_verifyConfig()) {
+    return false;
+  }
+
+  uint32_t startTime = millis();
+  char path[DEVICE_API_MAX_PATH];
+  buildFrameSchedulePath(path, sizeof(path), WiFi.macAddress().c_str(), requested);
+  logger.debug("Loading frame schedule from: %s%s", serverUrl.c_str(), path);
+
+  HTTPClient http;
+  _beginRequest(http, serverUrl + path);
+  http.setTimeout(60000);  // the server renders the frames on request
+
+  int httpCode = http.GET();
+  logger.debug("HTTP response code: %d (%s)", httpCode, statusCodeAsString(httpCode).c_str());
+  if (httpCode != 200) {
+    http.end();
+    return false;
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  int rowBytes = displayManager.bytesPerRow();
+  String line;
+
+  serviceTicker.tick();
+  readLineFromStream(stream, line);
+  if (line != FRAME_SCHEDULE_MAGIC) {
+    logger.debug("Invalid frame schedule magic: %s", line.c_str());
+    http.end();
+    return false;
+  }
+
+  unsigned int count = 0;
+  uint32_t validUntil = 0;
+  readLineFromStream(stream, line);
+  if (!parseFrameScheduleHeader(line.c_str(), requested, count, validUntil)) {
+    logger.debug("Invalid frame schedule header: %s", line.c_str());
+    http.end();
+    return false;
+  }
+  if (count == 0) {
+    logger.debug("Server sent no scheduled frames");
+    http.end();
+    return true;
+  }
+
+  bool ok = frameSchedule.beginWrite(count, validUntil, rowBytes);
+  for (unsigned int frame = 0; ok && frame < count; frame++) {
+    String displayAt, magic, checksum;
+    readLineFromStream(stream, displayAt);
+    readLineFromStream(stream, magic);
+    readLineFromStream(stream, checksum);
+    if (magic != BITMAP_V2_MAGIC || !frameSchedule.beginFrame(strtoul(displayAt.c_str(), nullptr, 10), checksum.c_str())) {
+      logger.debug("Invalid scheduled frame #%d header", frame);
+      ok = false;
+      break;
+    }
+
+    for (uint16_t row = 0; row < DISPLAY_HEIGHT; row++) {
+      serviceTicker.tick();
+
+      if (readWithDeadline(*stream, row_buffer, rowBytes, 1000, &powerManager) != rowBytes || !frameSchedule.writeRow(row_buffer)) {
+        logger.debug("WARNING: Failed to read scheduled frame #%d, row %d", frame, row);
+        ok = false;
+        break;
+      }
+    }
+  }
+  http.end();
+
+  ok = ok && frameSchedule.commit();
+  if (!ok) {
+    frameSchedule.abort();
+  }
+
+  logger.debug("Frame schedule download time: %lu ms", millis() - startTime);
+  return ok;
+#else
+  return false;
+#endif
+}
+
+bool HTTPClientManager::updateFirmwareFromWeb() {
+#ifdef USE_PULL_OTA
+  static uint8_t buffer[1024];
+
+  if (firmwareVersion == "" || firmwareVersion == FIRMWARE_VERSION || firmwareSize == 0 || !_verifyConfig()) {
+    return false;
+  }
+  // Installed already (the image reports a different version than the server expects) or rejected, flashing it again
+  // would only repeat that on every wakeup
+  if (otaManager.isLastPullImage(firmwareSha256.c_str())) {
+    logger.debug("Firmware %s (%s) was already tried, skipping", firmwareVersion.c_str(), firmwareSha256.c_str());
+    return false;
+  }
+
+  uint32_t startTime = millis();
+  char path[DEVICE_API_MAX_PATH];
+  buildFirmwarePath(path, sizeof(path), WiFi.macAddress().c_str());
+  logger.debug("Updating firmware %s -> %s from: %s%s", FIRMWARE_VERSION, firmwareVersion.c_str(), serverUrl.c_str(), path);
+
+  HTTPClient http;
+  _beginRequest(http, serverUrl + path);
+  http.setTimeout(30000);
+
+  int httpCode = http.GET();
+  logger.debug("HTTP response code: %d (%s)", httpCode, statusCodeAsString(httpCode).c_str());
+  int contentLength = http.getSize();
+  if (httpCode != 200 || contentLength <= 0) {
+    http.end();
+    return false;
+  }
+
+  if (!otaManager.beginPullUpdate(firmwareSize, firmwareSha256.c_str())) {
+    http.end();
+    return false;
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  int remaining = contentLength;
+  bool ok = true;
+  bool timedOut = false;
+  while (ok && remaining > 0) {
+    serviceTicker.tick();
+    int read = readWithDeadline(*stream, buffer, min(remaining, (int)sizeof(buffer)), 5000, &powerManager);
+    if (read <= 0) {
+      logger.debug("WARNING: Timeout waiting for firmware data, %d bytes missing", remaining);
+      ok = false;
+      timedOut = true;
+      break;
+    }
+    ok = otaManager.writePullUpdate(buffer, read);
+    remaining -= read;
+  }
+  http.end();
+
+  ok = ok && otaManager.finishPullUpdate();
+  if (!ok) {
+    otaManager.abortPullUpdate();
+  }
+  // A network timeout is retried on the next wakeup, a corrupted or rejected image would fail the same way again
+  if (!timedOut) {
+    otaManager.rememberPullImage(firmwareSha256.c_str());
+  }
+
+  logger.debug("Firmware download time: %lu ms (%d compressed bytes), %s", millis() - startTime, contentLength, ok ? "success" : "failed");
+  return ok;
+#else
+  return false;
+#endif
+}
@@ -5,14 +5,14 @@
 #include "hw_config.h"
 
 #ifdef SYSLOG_SERVER
-Logger::Logger(WiFiUDP& udpClient, Syslog& syslog) : udpClient(udpClient), syslog(syslog), syslogEnabled(false), debugEnabled(false) {
+Logger::Logger(WiFiUDP& udpClient, Syslog& syslog) : udpClient(udpClient), syslog(syslog), syslogEnabled(false), debugEnabled(false), serialStarted(false), serialConnected(false) {
 #ifdef DEBUG
   debugEnabled = true;
   syslogEnabled = true;
 #endif
 }
 #else
-Logger::Logger() : debugEnabled(false) {
+Logger::Logger() : debugEnabled(false), serialStarted(false), serialConnected(false) {
 #ifdef DEBUG
   debugEnabled = true;
 #endif
@@ -32,9 +32,11 @@ void Logger::debug(const char* format, ...) {
   va_end(args);
 
   // Print to Serial
-  Serial.print(buffer);
-  Serial.print('\n');
-  Serial.flush();
+  if (serialReady()) {
+    Serial.print(buffer);
+    Serial.print('\n');
+    Serial.flush();
+  }
 
 #ifdef SYSLOG_SERVER
   // Send to syslog if enabled and WiFi connected
@@ -46,7 +48,7 @@ void Logger::debug(const char* format, ...) {
         delay(100);
       }
     }
-  } else if (syslogEnabled) {
+  } else if (syslogEnabled && serialReady()) {
     Serial.println(" (no syslog, WiFi not connected)");
   }
 #endif
@@ -65,12 +67,34 @@ void Logger::trace(const char* format, ...) {
   vsnprintf(buffer, sizeof(buffer), format, args);
   va_end(args);
 
-  Serial.print(buffer);
-  Serial.print('\n');
-  Serial.flush();
+  if (serialReady()) {
+    Serial.print(buffer);
+    Serial.print('\n');
+    Serial.flush();
+  }
+#endif
+}
+
+// Without USE_FAST_BOOT this is called at boot, otherwise by the first message printed. The USB CDC console (ESP32-S3 boards
+// without a USB-UART bridge) is then skipped when no host has it open, nobody would read the output anyway.
+void Logger::beginSerial() {
+  if (serialStarted) {
+    return;
+  }
+  serialStarted = true;
+  Serial.begin(115200);
+#if defined(USE_FAST_BOOT) && ARDUINO_USB_CDC_ON_BOOT
+  serialConnected = (bool)Serial;
+#else
+  serialConnected = true;
 #endif
 }
 
+bool Logger::serialReady() {
+  beginSerial();
+  return serialConnected;
+}
+
 void Logger::setEnabled(bool enable) { debugEnabled = enable; }
 
 bool Logger::isEnabled() const { return debugEnabled; }
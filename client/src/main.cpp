@@ -22,24 +22,41 @@
 #include <WiFiManager.h>
 #endif
 
+#include "battery_model.h"
 #include "debug.h"
 #include "display_manager.h"
+#include "frame_hash.h"
+#include "frame_schedule.h"
+#include "frame_store.h"
 #include "http_client_manager.h"
 #include "logger.h"
 #include "main.h"
+#include "memory_profiler.h"
 #include "ota_manager.h"
+#include "partial_refresh.h"
+#include "power_manager.h"
+#include "refresh_scheduler.h"
+#include "service_ticker.h"
+#include "sleep_timer.h"
 #include "system_info.h"
+#include "tls_client.h"
 #include "version.h"
 #include "voltage.h"
 #include "wdt_manager.h"
 #include "wifi_client.h"
 
-DISPLAY_CLASS_TYPE display(DISPLAY_CLASS_ARGUMENTS);
 const char* defined_color_type = DISPLAY_COLOR_TYPE_AS_STRING;
 
 /* RTC vars (survives deep sleep) */
 RTC_DATA_ATTR int wakeupCount = 0;
 RTC_DATA_ATTR char lastChecksum[64 + 1] = "<not_defined_yet>";
+RTC_DATA_ATTR uint64_t displayedFrameHash = FRAME_HASH_UNKNOWN;
+RTC_DATA_ATTR SleepTimerState sleepTimerState = {};
+RTC_DATA_ATTR bool staticTelemetrySent = false;
+RTC_DATA_ATTR BatteryModelState batteryModelState = {};
+RTC_DATA_ATTR RefreshSchedulerState refreshSchedulerState = {};
+RTC_DATA_ATTR MemoryProfilerState memoryProfilerState = {};
+RTC_DATA_ATTR TlsSessionState tlsSessionState = {};
 
 #define SLEEP_TIME_DEFAULT (SECONDS_PER_MINUTE * 5)
 
@@ -64,71 +81,146 @@ Logger logger;
 
 WDTManager wdtManager(logger);
 OTAManager otaManager(logger, wdtManager);
-DisplayManager displayManager(logger, wdtManager, otaManager);
+ServiceTicker serviceTicker(logger, wdtManager, otaManager);
+PowerManager powerManager(logger);
+SleepTimer sleepTimer(logger, sleepTimerState);
+RefreshScheduler refreshScheduler(logger, refreshSchedulerState, sleepTimer);
+DisplayManager displayManager(logger, serviceTicker, powerManager, refreshScheduler);
+FrameStore frameStore(logger);
+PartialRefresh partialRefresh(logger, serviceTicker, displayManager, frameStore, refreshScheduler, lastChecksum);
+FrameSchedule frameSchedule(logger, serviceTicker, displayManager, frameStore, partialRefresh, sleepTimer, nextSleepTime, lastChecksum, displayedFrameHash);
 WiFiConnectionManager wifiConnectionManager(logger, wdtManager);
 SystemInfo systemInfo(logger, wakeupCount);
 VoltageReader voltageReader(logger);
-HTTPClientManager httpClientManager(logger, wdtManager, otaManager, voltageReader, systemInfo, displayManager, nextSleepTime, lastChecksum, defined_color_type);
+BatteryModel batteryModel(logger, batteryModelState, sleepTimer);
+MemoryProfiler memoryProfiler(logger, memoryProfilerState);
+TlsClient tlsClient(logger, tlsSessionState, powerManager);
+HTTPClientManager httpClientManager(logger, serviceTicker, otaManager, powerManager, voltageReader, batteryModel, systemInfo, memoryProfiler, tlsClient,
+                                    displayManager, frameStore, partialRefresh, refreshScheduler, frameSchedule, nextSleepTime, lastChecksum,
+                                    displayedFrameHash, staticTelemetrySent, defined_color_type);
 
 class TimingInfo {
  public:
   uint32_t fullStartTime;
   uint32_t configLoadTime;
-
-  TimingInfo() : fullStartTime(0), configLoadTime(0) {}
-
-  void logStats() { DEBUG_PRINT("Total execution time: %lu ms", millis() - fullStartTime); }
+  uint32_t wifiStartTime;
+  uint32_t firstRequestTime;
+  uint32_t wifiStopTime;
+
+  TimingInfo() : fullStartTime(0), configLoadTime(0), wifiStartTime(0), firstRequestTime(0), wifiStopTime(0) {}
+
+  // Boot profile, in ms since the reset (millis() starts with the application, the ROM and the bootloader take a few tens of
+  // ms more)
+  void logStats() {
+    if (firstRequestTime != 0) {
+      DEBUG_PRINT("Boot profile: reset to first request %lu ms, reset to sleep %lu ms", firstRequestTime, millis());
+    } else {
+      DEBUG_PRINT("Boot profile: no request, reset to sleep %lu ms", millis());
+    }
+    if (wifiStopTime != 0) {
+      DEBUG_PRINT("WiFi on for %lu ms, switched off %lu ms before sleep", wifiStopTime - wifiStartTime, millis() - wifiStopTime);
+    }
+    DEBUG_PRINT("Total execution time: %lu ms", millis() - fullStartTime);
+  }
 };
 TimingInfo timing;
 
 void minimalHardwareInit() {
   timing.fullStartTime = millis();
   ++wakeupCount;
-  Serial.begin(115200);
+#ifndef USE_FAST_BOOT
+  logger.beginSerial();
+#endif
   wdtManager.init();
+  powerManager.begin();
   DEBUG_PRINT("Started");
+  memoryProfiler.sample(MEMORY_POINT_BOOT);
 }
 
-void wakeupDisplayAndConnectWiFi() {
+void wakeupDisplay() {
+#ifndef USE_FAST_BOOT
   displayManager.init();
+#endif
+
+  if (strcmp(lastChecksum, "<not_defined_yet>") == 0) {
+    // RTC memory doesn't survive power loss or a reset, the flash copy knows what is on the panel
+    char storedChecksum[sizeof(lastChecksum)];
+    if (frameStore.loadChecksum(storedChecksum, sizeof(storedChecksum))) {
+      strcpy(lastChecksum, storedChecksum);
+    }
+  }
+}
+
+// Before anything is drawn, a frame from the frame schedule included
+void readBattery() {
+  voltageReader.read();
+  batteryModel.update(voltageReader.getVoltageReal());
+}
 
+void connectWiFi() {
+  powerManager.setPhase(POWER_PHASE_NETWORK);
+  powerManager.wifiStarted();
+  timing.wifiStartTime = millis();
   if (!wifiConnectionManager.init()) {
     nextSleepTime = SECONDS_PER_HOUR * 1;
-    showErrorOnDisplay("WiFi connect/login unsuccessful.");
+    showErrorOnDisplay(ERROR_SCREEN_WIFI);
   }
 
+  systemInfo.wifiConnectTime = millis() - timing.wifiStartTime;
+
+#ifndef USE_FAST_BOOT
   otaManager.init();
-  wifiClient.setOTAManager(&otaManager);
+#endif
+  powerManager.init();
+  wifiClient.setServiceTicker(&serviceTicker);
+  wifiClient.setPowerManager(&powerManager);
   wifiClient.setBlockingReadTimeout(5000);
 
-  systemInfo.logResetReason(lastChecksum);
-
 #ifdef USE_WDT
   if (esp_reset_reason() == ESP_RST_TASK_WDT) {
     nextSleepTime = SECONDS_PER_HOUR * 1;
-    showErrorOnDisplay("Watchdog issue. Please report this to the developer.");
+    showErrorOnDisplay(ERROR_SCREEN_WATCHDOG);
   }
 #endif
 
-  voltageReader.read();
-  otaManager.loop();
+  serviceTicker.tick();
   httpClientManager.init();  // must be after WiFi is connected
 
-  if (!httpClientManager.loadConfigFromWeb(timing.configLoadTime, otaDebugModeNoSleep)) {
-    showErrorOnDisplay(httpClientManager.lastErrorMessage);
+  uint32_t serverTime = 0;
+  timing.firstRequestTime = millis();
+  bool configLoaded = httpClientManager.loadConfigFromWeb(timing.configLoadTime, otaDebugModeNoSleep, serverTime);
+  if (serverTime != 0) {
+    sleepTimer.syncClock(serverTime);
+  }
+  systemInfo.logResetReason(lastChecksum);
+  memoryProfiler.sample(MEMORY_POINT_NETWORK);
+  if (!configLoaded) {
+    showErrorOnDisplay(httpClientManager.lastErrorScreen, httpClientManager.lastErrorMessage);
   }
 
-  otaManager.loop();
+  serviceTicker.tick();
   if (voltageReader.getVoltageReal() > 0 && voltageReader.getVoltageReal() < VOLTAGE_MIN) {
     nextSleepTime = SECONDS_PER_HOUR * 1;
-    showErrorOnDisplay(String("Battery voltage too low: ") + String(voltageReader.getVoltageReal()) + " V\n" + "Minimum is: " + String(VOLTAGE_MIN) + " V\n" +
-                       "Please charge the battery and try again.");
+    showErrorOnDisplay(ERROR_SCREEN_LOW_BATTERY, String("Voltage: ") + String(voltageReader.getVoltageReal()) + " V, minimum is " + String(VOLTAGE_MIN) + " V");
   }
 }
 
+// Everything has been received, the frame downloaded by showRawBitmapFromWeb() is drawn with the radio off (see
+// USE_DEFERRED_REFRESH in hw_config.h)
+void showPendingFrameWithWiFiOff() {
+#ifdef USE_DEFERRED_REFRESH
+  wifiConnectionManager.stop();
+  powerManager.wifiStopped();
+  timing.wifiStopTime = millis();
+  httpClientManager.showPendingFrame();
+#endif
+}
+
 void disconnectWiFiAndHibernateAll() {
-  timing.logStats();
+  serviceTicker.logStats();
   displayManager.stop();
+  powerManager.logStats();
+  frameStore.end();
   wdtManager.stop();
 
   nextSleepTime -= (millis() - timing.configLoadTime) / 1000;
@@ -136,37 +228,70 @@ void disconnectWiFiAndHibernateAll() {
     DEBUG_PRINT("SleepTime is too low (%d seconds), resetting to a sane value", nextSleepTime);
     nextSleepTime = 300;
   }
+  nextSleepTime = batteryModel.stretchSleep(nextSleepTime);
+  batteryModel.endWake(powerManager.wakeMah(), millis(), nextSleepTime);
+  memoryProfiler.endWake();
 
   DEBUG_PRINT("Going to hibernate for %d seconds", nextSleepTime);
+  timing.logStats();
 
   wifiConnectionManager.stop();
   boardSpecificDone();
   espDeepSleep(nextSleepTime);
 }
 
-void showErrorOnDisplay(String message) {
+// The fixed text of the common errors is pre-rendered (see error_screens.h), only the details and the retry time are laid
+// out here
+void showErrorOnDisplay(ErrorScreen screen, String details) {
   strcpy(lastChecksum, "");
-  DEBUG_PRINT("Displaying error: %s", message.c_str());
-  displayManager.displayText(message + "\n\nRetrying after " + String(nextSleepTime / 60) + " minutes.", &DejaVu_Sans_Mono_16);
+  displayedFrameHash = FRAME_HASH_UNKNOWN;
+  frameStore.invalidate();
+  frameSchedule.clear();
+  DEBUG_PRINT("Displaying error: %s %s", errorScreenText(screen), details.c_str());
+  powerManager.setPhase(POWER_PHASE_COMPUTE);
+  String retry = "Retrying after " + String(nextSleepTime / 60) + " minutes.";
+  const PrerenderedErrorScreen* prerendered = prerenderedErrorScreen(screen);
+  if (prerendered != nullptr) {
+    displayManager.displayPrerendered(*prerendered, details.length() > 0 ? details + "\n" + retry : retry, &DejaVu_Sans_Mono_16);
+  } else {
+    String message = errorScreenText(screen);
+    if (details.length() > 0) {
+      message += message.length() > 0 ? "\n" + details : details;
+    }
+    displayManager.displayText(message + "\n\n" + retry, &DejaVu_Sans_Mono_16);
+  }
   disconnectWiFiAndHibernateAll();
 }
 
 void espDeepSleep(uint64_t seconds) {
   wdtManager.stop();
   TRACE_PRINT("Going to deep sleep for %lu s", seconds);
-  esp_sleep_enable_timer_wakeup(seconds * uS_PER_S);
-  esp_deep_sleep_start();
+  sleepTimer.deepSleep(seconds);
 }
 
 void setup() {
   minimalHardwareInit();
 
   boardSpecificInit();
-  wakeupDisplayAndConnectWiFi();
+  wakeupDisplay();
+
+  readBattery();
+  float voltage = voltageReader.getVoltageReal();
+  if ((voltage > 0 && voltage < VOLTAGE_MIN) || !batteryModel.allowsFrameSchedule()) {
+    // No full refreshes from the schedule on a flat battery, the online path reports the voltage and shows the error
+    DEBUG_PRINT("Battery low (%f V), not showing scheduled frames", voltage);
+  } else if (frameSchedule.showDueFrame()) {
+    // Pre-fetched frame is on the panel, nothing to ask the server
+    DEBUG_PRINT("Scheduled frame shown without WiFi");
+    disconnectWiFiAndHibernateAll();
+  }
+
+  connectWiFi();
 
   if (otaDebugModeNoSleep) {
     DEBUG_PRINT("Running OTA loop on %s (%s.local)", WiFi.localIP().toString().c_str(), HOSTNAME);
     wdtManager.stop();
+    otaManager.init();
     while (true) {
       otaManager.loop();
       delay(5);
@@ -175,9 +300,28 @@ void setup() {
 }
 
 void loop() {
+  // Bulk downloads from here on, the clock goes down while waiting for the data anyway
+  powerManager.setPhase(POWER_PHASE_COMPUTE);
   if (!httpClientManager.showRawBitmapFromWeb()) {
-    showErrorOnDisplay(httpClientManager.lastErrorMessage);
+    showErrorOnDisplay(httpClientManager.lastErrorScreen, httpClientManager.lastErrorMessage);
+  }
+  memoryProfiler.sample(MEMORY_POINT_FRAME);
+
+  // Frames for the next wakeups, failure is not fatal (the device simply connects again next time)
+  if (batteryModel.allowsFrameSchedule()) {
+    httpClientManager.loadFrameScheduleFromWeb();
+  }
+
+  if (batteryModel.allowsFirmwareUpdate() && httpClientManager.updateFirmwareFromWeb()) {
+    // Unlike a deep sleep wakeup, a reset reinitialises the RTC variables whose layout may differ in the new firmware
+    DEBUG_PRINT("Firmware updated, restarting");
+    showPendingFrameWithWiFiOff();
+    displayManager.stop();
+    frameStore.end();
+    wifiConnectionManager.stop();
+    ESP.restart();
   }
 
+  showPendingFrameWithWiFiOff();
   disconnectWiFiAndHibernateAll();
 }
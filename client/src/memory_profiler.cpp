@@ -0,0 +1,66 @@
+#include "memory_profiler.h"
+
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include "logger.h"
+
+static const char* const pointNames[MEMORY_POINT_COUNT] = {"boot", "network", "frame", "sleep"};
+
+MemoryProfiler::MemoryProfiler(Logger& logger, MemoryProfilerState& state) : logger(logger), state(state), current() {}
+
+// In bytes, ESP-IDF counts the stacks in bytes rather than in words
+uint32_t MemoryProfiler::taskStackHighWaterMark(const char* name) {
+  TaskHandle_t task = name == nullptr ? nullptr : xTaskGetHandle(name);
+  if (name != nullptr && task == nullptr) {
+    return 0;
+  }
+  return uxTaskGetStackHighWaterMark(task);
+}
+
+void MemoryProfiler::sample(MemoryPoint point) {
+#ifdef USE_MEMORY_PROFILER
+  uint32_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  uint32_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  uint32_t freePsram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+
+  current.freeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+  if (current.largestBlock == 0 || largestBlock < current.largestBlock) {
+    current.largestBlock = largestBlock;
+  }
+  current.freePsram = heap_caps_get_minimum_free_size(MALLOC_CAP_SPIRAM);
+  current.loopStack = taskStackHighWaterMark(nullptr);
+  uint32_t tcpipStack = taskStackHighWaterMark("tiT");
+  if (tcpipStack != 0) {
+    current.tcpipStack = tcpipStack;
+  }
+
+  logger.debug("Memory at %s: heap %lu free (min %lu), largest block %lu, PSRAM %lu free, stack %lu unused (lwIP %lu)", pointNames[point], freeHeap,
+               current.freeHeap, largestBlock, freePsram, current.loopStack, current.tcpipStack);
+#endif
+}
+
+// 0 means unknown (e.g. the lwIP task of an offline wakeup)
+static uint32_t minKnown(uint32_t a, uint32_t b) {
+  if (a == 0 || b == 0) {
+    return a == 0 ? b : a;
+  }
+  return min(a, b);
+}
+
+void MemoryProfiler::endWake() {
+#ifdef USE_MEMORY_PROFILER
+  sample(MEMORY_POINT_SLEEP);
+  if (!state.valid) {
+    state.minima = current;
+  } else {
+    state.minima.freeHeap = min(state.minima.freeHeap, current.freeHeap);
+    state.minima.largestBlock = min(state.minima.largestBlock, current.largestBlock);
+    state.minima.freePsram = min(state.minima.freePsram, current.freePsram);
+    state.minima.loopStack = min(state.minima.loopStack, current.loopStack);
+    state.minima.tcpipStack = minKnown(state.minima.tcpipStack, current.tcpipStack);
+  }
+  state.valid = true;
+#endif
+}
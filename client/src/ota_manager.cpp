@@ -6,9 +6,38 @@
 #include "logger.h"
 #include "wdt_manager.h"
 
-OTAManager::OTAManager(Logger& logger, WDTManager& wdtManager) : logger(logger), wdtManager(wdtManager) {}
+#ifdef USE_PULL_OTA
+#include <Preferences.h>
+#include <Update.h>
+#include <mbedtls/sha256.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include <esp32s3/rom/miniz.h>
+#else
+#include <esp32/rom/miniz.h>
+#endif
+
+// The inflater (from the ROM, no extra code in the firmware) needs the whole 32 kB window as its output buffer
+struct PullUpdateState {
+  tinfl_decompressor inflator;
+  uint8_t dictionary[TINFL_LZ_DICT_SIZE];
+  size_t dictionaryOffset;
+  size_t imageSize;
+  size_t written;
+  bool inflated;
+  char expectedSha256[64 + 1];
+  mbedtls_sha256_context sha256;
+};
+#else
+struct PullUpdateState {};
+#endif
+
+OTAManager::OTAManager(Logger& logger, WDTManager& wdtManager) : logger(logger), wdtManager(wdtManager), pull(nullptr), started(false) {}
 
 void OTAManager::init() {
+  if (started) {
+    return;
+  }
+  started = true;
   ArduinoOTA.setHostname(HOSTNAME);
   ArduinoOTA.onStart([this]() {
     wdtManager.stop();
@@ -22,4 +51,178 @@ void OTAManager::init() {
   logger.debug("OTA: Ready on %s.local", HOSTNAME);
 }
 
-void OTAManager::loop() { ArduinoOTA.handle(); }
\ No newline at end of file
+void OTAManager::loop() {
+  if (started) {
+    ArduinoOTA.handle();
+  }
+}
+
+bool OTAManager::isLastPullImage(const char* sha256) {
+#ifdef USE_PULL_OTA
+  char lastSha256[64 + 1] = "";
+  Preferences preferences;
+  if (preferences.begin("ota", true)) {
+    preferences.getString("sha256", lastSha256, sizeof(lastSha256));
+    preferences.end();
+  }
+  return strcmp(lastSha256, sha256) == 0;
+#else
+  return false;
+#endif
+}
+
+void OTAManager::rememberPullImage(const char* sha256) {
+#ifdef USE_PULL_OTA
+  Preferences preferences;
+  if (!preferences.begin("ota", false)) {
+    logger.debug("OTA pull: can't open NVS, the image may be downloaded again");
+    return;
+  }
+  preferences.putString("sha256", sha256);
+  preferences.end();
+#endif
+}
+
+bool OTAManager::beginPullUpdate(size_t imageSize, const char* sha256) {
+#ifdef USE_PULL_OTA
+  abortPullUpdate();
+
+  if (strlen(sha256) != 64) {
+    logger.debug("OTA pull: invalid SHA-256 '%s'", sha256);
+    return false;
+  }
+
+  pull = (PullUpdateState*)malloc(sizeof(PullUpdateState));
+  if (pull == nullptr) {
+    logger.debug("OTA pull: can't allocate %d bytes for the inflater", sizeof(PullUpdateState));
+    return false;
+  }
+
+  if (!Update.begin(imageSize, U_FLASH)) {
+    logger.debug("OTA pull: can't start the update: %s", Update.errorString());
+    free(pull);
+    pull = nullptr;
+    return false;
+  }
+
+  tinfl_init(&pull->inflator);
+  pull->dictionaryOffset = 0;
+  pull->imageSize = imageSize;
+  pull->written = 0;
+  pull->inflated = false;
+  strncpy(pull->expectedSha256, sha256, 64);
+  pull->expectedSha256[64] = '\0';
+  mbedtls_sha256_init(&pull->sha256);
+  mbedtls_sha256_starts(&pull->sha256, 0);
+
+  logger.debug("OTA pull: writing %d bytes into the inactive partition", imageSize);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool OTAManager::flushInflated(const uint8_t* data, size_t size) {
+#ifdef USE_PULL_OTA
+  if (pull->written + size > pull->imageSize) {
+    logger.debug("OTA pull: image is larger than announced");
+    return false;
+  }
+  if (Update.write((uint8_t*)data, size) != size) {
+    logger.debug("OTA pull: flash write failed: %s", Update.errorString());
+    return false;
+  }
+  mbedtls_sha256_update(&pull->sha256, data, size);
+  pull->written += size;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool OTAManager::writePullUpdate(const uint8_t* data, size_t size) {
+#ifdef USE_PULL_OTA
+  if (pull == nullptr) {
+    return false;
+  }
+
+  while (!pull->inflated) {
+    size_t inBytes = size;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - pull->dictionaryOffset;
+    tinfl_status status = tinfl_decompress(&pull->inflator, data, &inBytes, pull->dictionary, pull->dictionary + pull->dictionaryOffset, &outBytes,
+                                           TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+    data += inBytes;
+    size -= inBytes;
+
+    if (outBytes > 0) {
+      if (!flushInflated(pull->dictionary + pull->dictionaryOffset, outBytes)) {
+        return false;
+      }
+      pull->dictionaryOffset = (pull->dictionaryOffset + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    }
+
+    if (status < TINFL_STATUS_DONE) {
+      logger.debug("OTA pull: corrupted compressed data (status %d)", status);
+      return false;
+    }
+    if (status == TINFL_STATUS_DONE) {
+      pull->inflated = true;
+    } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && size == 0) {
+      break;
+    }
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool OTAManager::finishPullUpdate() {
+#ifdef USE_PULL_OTA
+  if (pull == nullptr) {
+    return false;
+  }
+
+  if (!pull->inflated || pull->written != pull->imageSize) {
+    logger.debug("OTA pull: incomplete image (%d of %d bytes)", pull->written, pull->imageSize);
+    abortPullUpdate();
+    return false;
+  }
+
+  uint8_t hash[32];
+  char hashHex[64 + 1];
+  mbedtls_sha256_finish(&pull->sha256, hash);
+  for (int i = 0; i < 32; i++) {
+    sprintf(hashHex + i * 2, "%02x", hash[i]);
+  }
+  if (strcmp(hashHex, pull->expectedSha256) != 0) {
+    logger.debug("OTA pull: SHA-256 mismatch, got %s", hashHex);
+    abortPullUpdate();
+    return false;
+  }
+
+  // Validates the image header and switches the boot partition
+  bool ok = Update.end();
+  if (!ok) {
+    logger.debug("OTA pull: can't activate the image: %s", Update.errorString());
+  }
+  mbedtls_sha256_free(&pull->sha256);
+  free(pull);
+  pull = nullptr;
+  return ok;
+#else
+  return false;
+#endif
+}
+
+void OTAManager::abortPullUpdate() {
+#ifdef USE_PULL_OTA
+  if (pull == nullptr) {
+    return;
+  }
+  Update.abort();
+  mbedtls_sha256_free(&pull->sha256);
+  free(pull);
+  pull = nullptr;
+#endif
+}
@@ -0,0 +1,66 @@
+#include "packbits.h"
+
+#include <string.h>
+
+size_t packbitsEncode(const uint8_t* src, size_t len, uint8_t* dst) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in < len) {
+    // Length of the run starting at the current position
+    size_t run = 1;
+    while (in + run < len && run < 128 && src[in + run] == src[in]) {
+      run++;
+    }
+
+    if (run >= 2) {
+      dst[out++] = (uint8_t)(int8_t)(1 - (int)run);
+      dst[out++] = src[in];
+      in += run;
+      continue;
+    }
+
+    // Literal chunk, ends where a run of at least 3 equal bytes starts (breaking it for a run of 2 would cost an extra header)
+    size_t literal = 1;
+    while (in + literal < len && literal < 128) {
+      size_t next = in + literal;
+      if (next + 2 < len && src[next] == src[next + 1] && src[next] == src[next + 2]) {
+        break;
+      }
+      literal++;
+    }
+    dst[out++] = (uint8_t)(literal - 1);
+    memcpy(dst + out, src + in, literal);
+    out += literal;
+    in += literal;
+  }
+
+  return out;
+}
+
+bool packbitsDecode(const uint8_t* src, size_t srcLen, uint8_t* dst, size_t dstLen) {
+  size_t in = 0;
+  size_t out = 0;
+
+  while (in < srcLen) {
+    int8_t n = (int8_t)src[in++];
+    if (n >= 0) {
+      size_t count = (size_t)n + 1;
+      if (in + count > srcLen || out + count > dstLen) {
+        return false;
+      }
+      memcpy(dst + out, src + in, count);
+      in += count;
+      out += count;
+    } else if (n != -128) {
+      size_t count = (size_t)(1 - n);
+      if (in >= srcLen || out + count > dstLen) {
+        return false;
+      }
+      memset(dst + out, src[in++], count);
+      out += count;
+    }
+  }
+
+  return out == dstLen;
+}
@@ -0,0 +1,194 @@
+#include "partial_refresh.h"
+
+#include "display_manager.h"
+#include "frame_store.h"
+#include "logger.h"
+#include "refresh_scheduler.h"
+#include "service_ticker.h"
+
+PartialRefresh::PartialRefresh(Logger& logger, ServiceTicker& serviceTicker, DisplayManager& displayManager, FrameStore& frameStore,
+                               RefreshScheduler& refreshScheduler, char* lastChecksum)
+    : logger(logger),
+      serviceTicker(serviceTicker),
+      displayManager(displayManager),
+      frameStore(frameStore),
+      refreshScheduler(refreshScheduler),
+      lastChecksum(lastChecksum),
+      rowBytes(0),
+      active(false),
+      opened(false),
+      bandCount(0),
+      dirtyRows(0) {}
+
+bool PartialRefresh::begin(uint16_t rowBytes) {
+  active = false;
+#ifdef USE_PARTIAL_REFRESH
+  // The stored frame is only a valid "previous" image if it's the one on the panel
+  char storedChecksum[64 + 1];
+  if (lastChecksum[0] == '\0' || !frameStore.loadChecksum(storedChecksum, sizeof(storedChecksum)) || strcmp(storedChecksum, lastChecksum) != 0) {
+    logger.debug("Partial refresh: displayed frame not stored");
+    return false;
+  }
+  if (!displayManager.supportsPartialRefresh()) {
+    return false;
+  }
+
+  // The frame store files are opened with the first row, a wakeup which finds the frame unchanged doesn't write the flash
+  this->rowBytes = rowBytes;
+  bandCount = 0;
+  dirtyRows = 0;
+  opened = false;
+  active = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool PartialRefresh::addRow(uint16_t row, const uint8_t* data) {
+  static uint8_t previous[DISPLAY_WIDTH];
+
+  if (!active) {
+    return false;
+  }
+  if (!opened) {
+    if (!frameStore.beginRead() || !frameStore.beginWrite(rowBytes)) {
+      logger.debug("Partial refresh: can't open the frame store");
+      abort();
+      return false;
+    }
+    opened = true;
+  }
+  if (!frameStore.writeRow(row, data) || !frameStore.readRow(row, previous)) {
+    logger.debug("Partial refresh: frame store failed on row %d", row);
+    abort();
+    return false;
+  }
+
+  uint16_t left = 0;
+  while (left < rowBytes && data[left] == previous[left]) {
+    left++;
+  }
+  if (left == rowBytes) {
+    return true;
+  }
+  uint16_t right = rowBytes;
+  while (data[right - 1] == previous[right - 1]) {
+    right--;
+  }
+  markDirty(row, left, right);
+  return true;
+}
+
+void PartialRefresh::markDirty(uint16_t row, uint16_t left, uint16_t right) {
+  if (bandCount > 0) {
+    DirtyBand& last = bands[bandCount - 1];
+    if (row < last.bottom) {
+      // The download started over (the frame changed on the server meanwhile), the bands are mixed up now
+      dirtyRows = DISPLAY_HEIGHT;
+      return;
+    }
+    if (row - last.bottom < PARTIAL_REFRESH_BAND_GAP || bandCount == PARTIAL_REFRESH_MAX_BANDS) {
+      dirtyRows += row + 1 - last.bottom;
+      last.bottom = row + 1;
+      last.left = min(last.left, left);
+      last.right = max(last.right, right);
+      return;
+    }
+  }
+
+  bands[bandCount++] = {row, (uint16_t)(row + 1), left, right};
+  dirtyRows++;
+}
+
+bool PartialRefresh::show() {
+  if (!active) {
+    return false;
+  }
+
+  uint32_t start = millis();
+  bool ok = true;
+  if (bandCount == 0) {
+    // Different checksum, same pixels
+    logger.debug("Partial refresh: nothing changed on the panel");
+  } else if (refreshScheduler.cleanRefreshDue()) {
+    ok = drawFullFrame();
+  } else {
+    if (dirtyRows * 100 > DISPLAY_HEIGHT * PARTIAL_REFRESH_MAX_DIRTY_PERCENT) {
+      logger.debug("Partial refresh: %d of %d rows changed, refreshing the whole panel", dirtyRows, DISPLAY_HEIGHT);
+      ok = drawBand({0, DISPLAY_HEIGHT, 0, rowBytes});
+    } else {
+      logger.debug("Partial refresh: %d rows changed in %d band(s)", dirtyRows, bandCount);
+      for (int i = 0; i < bandCount && ok; i++) {
+        ok = drawBand(bands[i]);
+      }
+    }
+    if (ok) {
+      refreshScheduler.fastRefreshDone();
+    }
+  }
+
+  frameStore.endRead();
+  active = false;
+  logger.debug("Partial refresh: done in %lu ms", millis() - start);
+  return ok;
+}
+
+bool PartialRefresh::drawBand(const DirtyBand& band) {
+  static uint8_t row_buffer[DISPLAY_WIDTH];
+
+  logger.debug("Partial refresh: rows %d-%d, bytes %d-%d", band.top, band.bottom - 1, band.left, band.right - 1);
+
+  // The previous content of the band goes into the controller, the partial waveform is computed against it
+  for (uint16_t row = band.top; row < band.bottom; row++) {
+    serviceTicker.tick();
+    if (!frameStore.readRow(row, row_buffer)) {
+      return false;
+    }
+    displayManager.writePreviousBitmapRow(row_buffer, row, band.left, band.right);
+  }
+
+  displayManager.beginPartialBitmapDraw(band.top, band.bottom, band.left, band.right);
+  do {
+    for (uint16_t row = band.top; row < band.bottom; row++) {
+      serviceTicker.tick();
+      if (!frameStore.readPendingRow(row, row_buffer)) {
+        displayManager.endBitmapDraw();
+        return false;
+      }
+      displayManager.drawBitmapRow(row_buffer, row);
+    }
+  } while (displayManager.nextPageBitmapDraw());
+  displayManager.endBitmapDraw();
+  return true;
+}
+
+bool PartialRefresh::drawFullFrame() {
+  static uint8_t row_buffer[DISPLAY_WIDTH];
+
+  int pagesDrawn = 0;
+  displayManager.beginBitmapDraw();
+  do {
+    if (pagesDrawn > 0 && displayManager.drawBufferedBitmap()) {
+      pagesDrawn++;
+      continue;
+    }
+    for (uint16_t row = 0; row < DISPLAY_HEIGHT; row++) {
+      serviceTicker.tick();
+      if (!frameStore.readPendingRow(row, row_buffer)) {
+        displayManager.endBitmapDraw();
+        return false;
+      }
+      displayManager.drawBitmapRow(row_buffer, row);
+    }
+    pagesDrawn++;
+  } while (displayManager.nextPageBitmapDraw());
+  displayManager.endBitmapDraw();
+  return true;
+}
+
+void PartialRefresh::abort() {
+  frameStore.abort();
+  frameStore.endRead();
+  active = false;
+}
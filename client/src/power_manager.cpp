@@ -0,0 +1,227 @@
+#include "power_manager.h"
+
+#include "logger.h"
+
+// Lowest clock the power management of ESP-IDF scales down to
+#define PM_MIN_FREQ_MHZ 80
+
+static const char* const phaseNames[POWER_PHASE_COUNT] = {"compute", "network", "refresh"};
+static const uint32_t phaseMhz[POWER_PHASE_COUNT] = {POWER_CPU_MHZ_COMPUTE, POWER_CPU_MHZ_NETWORK, POWER_CPU_MHZ_REFRESH};
+static const wifi_ps_type_t phaseWifiPs[POWER_PHASE_COUNT] = {POWER_WIFI_PS_COMPUTE, POWER_WIFI_PS_NETWORK, POWER_WIFI_PS_REFRESH};
+
+PowerManager::PowerManager(Logger& logger)
+    : logger(logger),
+      enabled(false),
+      idleDepth(0),
+      phase(POWER_PHASE_COMPUTE),
+      phaseBeforeRefresh(POWER_PHASE_COMPUTE),
+      maxMhz(0),
+      cpuMhz(0),
+      wifiOn(false),
+      wifiPs(WIFI_PS_MIN_MODEM),
+      accountedUntil(0),
+      phaseMs(),
+      phaseMaMs(),
+      baselineMaMs(0) {
+#if CONFIG_PM_ENABLE
+  busyLock = nullptr;
+  lockHeld = false;
+#endif
+}
+
+// Everything since the boot runs at the boot clock until begin() is called
+void PowerManager::begin() {
+  maxMhz = getCpuFrequencyMhz();
+  cpuMhz = maxMhz;
+  apply();
+}
+
+void PowerManager::init() {
+#if CONFIG_PM_ENABLE
+  if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "busy", &busyLock) != ESP_OK) {
+    logger.debug("PM: can't create lock, power management disabled");
+    return;
+  }
+  // Hold the lock by default so that SPI, ADC and the display never run at a reduced clock
+  esp_pm_lock_acquire(busyLock);
+  lockHeld = true;
+
+#if ESP_IDF_VERSION_MAJOR >= 5
+  esp_pm_config_t pmConfig = {};
+#elif CONFIG_IDF_TARGET_ESP32S3
+  esp_pm_config_esp32s3_t pmConfig = {};
+#else
+  esp_pm_config_esp32_t pmConfig = {};
+#endif
+  pmConfig.max_freq_mhz = maxMhz;  // the current clock may be already lowered by the governor
+  pmConfig.min_freq_mhz = PM_MIN_FREQ_MHZ;
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  pmConfig.light_sleep_enable = true;
+#else
+  pmConfig.light_sleep_enable = false;
+#endif
+
+  esp_err_t err = esp_pm_configure(&pmConfig);
+  if (err != ESP_OK) {
+    logger.debug("PM: esp_pm_configure() failed with %d, power management disabled", err);
+    esp_pm_lock_release(busyLock);
+    esp_pm_lock_delete(busyLock);
+    busyLock = nullptr;
+    lockHeld = false;
+    return;
+  }
+
+  account();
+  enabled = true;
+  cpuMhz = maxMhz;
+  apply();
+  logger.debug("PM: %d-%d MHz, automatic light sleep %s", pmConfig.min_freq_mhz, pmConfig.max_freq_mhz, pmConfig.light_sleep_enable ? "enabled" : "not available");
+#else
+  logger.debug("PM: power management not available in this SDK build");
+#endif
+}
+
+// mA drawn in the given state, the mA * ms sums are converted to mAh at the end
+float PowerManager::currentMa(uint32_t mhz, bool wifiOn, wifi_ps_type_t wifiPs, bool refresh) {
+  float ma = POWER_CURRENT_BASE_MA + mhz * POWER_CURRENT_PER_MHZ_UA / 1000.0f;
+  if (wifiOn) {
+    ma += wifiPs == WIFI_PS_NONE ? POWER_CURRENT_WIFI_PS_NONE_MA : wifiPs == WIFI_PS_MIN_MODEM ? POWER_CURRENT_WIFI_PS_MIN_MODEM_MA : POWER_CURRENT_WIFI_PS_MAX_MODEM_MA;
+  }
+  if (refresh) {
+    ma += POWER_CURRENT_PANEL_REFRESH_MA;
+  }
+  return ma;
+}
+
+// Charges the time since the last state change to the current phase. The baseline is the same wakeup at the boot clock with
+// the default power save, i.e. without the governor.
+void PowerManager::account() {
+  uint32_t now = millis();
+  uint32_t elapsed = now - accountedUntil;
+  accountedUntil = now;
+
+  bool refresh = phase == POWER_PHASE_REFRESH;
+  uint32_t mhz = cpuMhz != 0 ? cpuMhz : getCpuFrequencyMhz();
+  phaseMs[phase] += elapsed;
+  phaseMaMs[phase] += elapsed * currentMa(mhz, wifiOn, wifiPs, refresh);
+  baselineMaMs += elapsed * currentMa(maxMhz != 0 ? maxMhz : mhz, wifiOn, WIFI_PS_MIN_MODEM, refresh);
+}
+
+uint32_t PowerManager::targetMhz() {
+#ifdef USE_POWER_GOVERNOR
+  uint32_t mhz = idleDepth > 0 ? POWER_CPU_MHZ_IDLE : phaseMhz[phase];
+  return min(mhz, maxMhz);
+#else
+  // Only the waits for the network are clocked down, and only by the power management of ESP-IDF
+  return enabled && idleDepth > 0 ? PM_MIN_FREQ_MHZ : maxMhz;
+#endif
+}
+
+void PowerManager::setClock(uint32_t mhz) {
+#if CONFIG_PM_ENABLE
+  if (enabled) {
+    // The actual clock is up to ESP-IDF, anything below the maximum lets it scale down
+    bool hold = mhz >= maxMhz;
+    if (hold != lockHeld) {
+      if (hold) {
+        esp_pm_lock_acquire(busyLock);
+      } else {
+        esp_pm_lock_release(busyLock);
+      }
+      lockHeld = hold;
+    }
+    cpuMhz = hold ? maxMhz : PM_MIN_FREQ_MHZ;
+    return;
+  }
+#endif
+  if (mhz != cpuMhz && setCpuFrequencyMhz(mhz)) {
+    cpuMhz = mhz;
+  }
+}
+
+void PowerManager::apply() {
+  if (maxMhz == 0) {
+    return;  // not started yet
+  }
+  setClock(targetMhz());
+
+#ifdef USE_POWER_GOVERNOR
+  if (wifiOn && wifiPs != phaseWifiPs[phase]) {
+    wifiPs = phaseWifiPs[phase];
+    WiFi.setSleep(wifiPs);
+  }
+#endif
+}
+
+void PowerManager::setPhase(PowerPhase newPhase) {
+  if (newPhase == phase) {
+    return;
+  }
+  account();
+  phase = newPhase;
+  apply();
+}
+
+void PowerManager::wifiStarted() {
+  account();
+  wifiOn = true;
+#ifdef USE_POWER_GOVERNOR
+  // Stored by the WiFi library if the station isn't running yet, applied when it starts
+  wifiPs = phaseWifiPs[phase];
+  WiFi.setSleep(wifiPs);
+#ifdef POWER_WIFI_TX_POWER
+  WiFi.setTxPower(POWER_WIFI_TX_POWER);
+#endif
+#endif
+}
+
+void PowerManager::wifiStopped() {
+  account();
+  wifiOn = false;
+}
+
+void PowerManager::idleWaitBegin() {
+  if (idleDepth++ == 0) {
+    account();
+    apply();
+  }
+}
+
+void PowerManager::idleWaitEnd() {
+  if (--idleDepth == 0) {
+    account();
+    apply();
+  }
+}
+
+void PowerManager::refreshWaitBegin() {
+  if (phase != POWER_PHASE_REFRESH) {
+    phaseBeforeRefresh = phase;
+    setPhase(POWER_PHASE_REFRESH);
+  }
+}
+
+void PowerManager::refreshWaitEnd() {
+  if (phase == POWER_PHASE_REFRESH) {
+    setPhase(phaseBeforeRefresh);
+  }
+}
+
+float PowerManager::wakeMah() {
+  account();
+  float maMs = 0;
+  for (int i = 0; i < POWER_PHASE_COUNT; i++) {
+    maMs += phaseMaMs[i];
+  }
+  return maMs / 3600000.0f;
+}
+
+void PowerManager::logStats() {
+  float mah = wakeMah();
+  for (int i = 0; i < POWER_PHASE_COUNT; i++) {
+    logger.debug("PM: %s phase %lu ms, %.4f mAh", phaseNames[i], phaseMs[i], phaseMaMs[i] / 3600000.0f);
+  }
+  float baselineMah = baselineMaMs / 3600000.0f;
+  logger.debug("PM: wakeup estimated at %.4f mAh, %.4f mAh at %lu MHz with the default power save (%.0f%% saved)", mah, baselineMah, maxMhz,
+               baselineMah > 0 ? 100.0f * (baselineMah - mah) / baselineMah : 0.0f);
+}
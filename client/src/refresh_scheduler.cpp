@@ -0,0 +1,44 @@
+#include "refresh_scheduler.h"
+
+#include "logger.h"
+#include "sleep_timer.h"
+
+RefreshScheduler::RefreshScheduler(Logger& logger, RefreshSchedulerState& state, SleepTimer& sleepTimer)
+    : logger(logger), state(state), sleepTimer(sleepTimer) {}
+
+// maxFastRefreshes < 0 = not configured on the server, cleanRefreshAt 0 = not requested
+void RefreshScheduler::configure(int maxFastRefreshes, uint32_t cleanRefreshAt) {
+  state.maxFastRefreshes = maxFastRefreshes < 0 ? REFRESH_MAX_FAST_REFRESHES : maxFastRefreshes;
+
+  // A time which has already passed stays until the clean refresh is done, the server only sends the upcoming one
+  if (state.cleanRefreshAt == 0 || state.cleanRefreshAt > sleepTimer.now()) {
+    state.cleanRefreshAt = cleanRefreshAt;
+  }
+  logger.trace("Refresh scheduler: %d of %d fast refreshes, clean refresh at %lu", state.fastRefreshes, state.maxFastRefreshes, state.cleanRefreshAt);
+}
+
+bool RefreshScheduler::cleanRefreshDue() {
+  if (!state.valid) {
+    logger.debug("Refresh scheduler: panel history unknown, clean refresh");
+    return true;
+  }
+  if (state.fastRefreshes >= state.maxFastRefreshes) {
+    logger.debug("Refresh scheduler: %d fast refreshes done, clean refresh", state.fastRefreshes);
+    return true;
+  }
+  if (state.cleanRefreshAt != 0 && sleepTimer.clockValid() && sleepTimer.now() >= state.cleanRefreshAt) {
+    logger.debug("Refresh scheduler: clean refresh requested at %lu", state.cleanRefreshAt);
+    return true;
+  }
+  return false;
+}
+
+void RefreshScheduler::fastRefreshDone() { state.fastRefreshes++; }
+
+void RefreshScheduler::cleanRefreshDone() {
+  state.valid = true;
+  state.fastRefreshes = 0;
+  if (state.cleanRefreshAt != 0 && sleepTimer.clockValid() && sleepTimer.now() >= state.cleanRefreshAt) {
+    state.cleanRefreshAt = 0;
+  }
+}
@@ -0,0 +1,17 @@
+#include "service_ticker.h"
+
+#include "logger.h"
+#include "ota_manager.h"
+#include "wdt_manager.h"
+
+ServiceTicker::ServiceTicker(Logger& logger, WDTManager& wdtManager, OTAManager& otaManager)
+    : logger(logger), wdtManager(wdtManager), otaManager(otaManager), lastRun(0), runCount(0) {}
+
+void ServiceTicker::run() {
+  lastRun = millis();
+  runCount++;
+  wdtManager.ping();
+  otaManager.loop();
+}
+
+void ServiceTicker::logStats() { logger.debug("Service ticks: %lu in %lu ms", runCount, millis()); }
@@ -0,0 +1,80 @@
+#include "sleep_timer.h"
+
+#include <esp_sleep.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "logger.h"
+#include "main.h"
+
+// Anything before this means the clock hasn't been set since the last reset
+#define SLEEP_TIMER_MIN_VALID_TIME 1700000000
+
+// Shorter intervals are dominated by the 1 s resolution of the clocks
+#define SLEEP_TIMER_MIN_CALIBRATION_TIME (SECONDS_PER_MINUTE * 30)
+
+// Anything larger is a clock jump (e.g. a changed server time), not a drift
+#define SLEEP_TIMER_MAX_DRIFT_PPM 100000
+
+SleepTimer::SleepTimer(Logger& logger, SleepTimerState& state) : logger(logger), state(state) {}
+
+bool SleepTimer::clockValid() { return time(nullptr) >= SLEEP_TIMER_MIN_VALID_TIME; }
+
+void SleepTimer::syncClock(uint32_t serverTime) {
+  if (state.sleepStartedAt != 0 && clockValid()) {
+    // Both the RTC timer and the system clock run from the same slow clock during deep sleep, only the server clock can
+    // tell how long the sleep really was. The time spent awake since the wakeup doesn't count.
+    int32_t awake = millis() / 1000;
+    int32_t slept = (int32_t)(serverTime - state.sleepStartedAt) - awake;
+    int32_t local = (int32_t)(time(nullptr) - state.sleepStartedAt) - awake;
+    logger.debug("Last sleep: %ld s by the server clock, %ld s by the local one, %lu s planned", slept, local, state.plannedSleep);
+  }
+
+  if (state.clockSyncedAt != 0 && clockValid()) {
+    // The system clock was set to the server time at the last sync, since then it has been running on its own
+    int32_t elapsedServer = (int32_t)(serverTime - state.clockSyncedAt);
+    int32_t elapsedLocal = (int32_t)(time(nullptr) - state.clockSyncedAt);
+    if (elapsedServer >= SLEEP_TIMER_MIN_CALIBRATION_TIME && elapsedLocal > 0) {
+      int32_t measured = (int32_t)((int64_t)(elapsedServer - elapsedLocal) * 1000000 / elapsedLocal);
+      if (abs(measured) <= SLEEP_TIMER_MAX_DRIFT_PPM) {
+        // Smooth out the rounding and the temperature swings, the first measurement is taken as is
+        state.driftPpm = state.calibrations == 0 ? measured : (state.driftPpm * 3 + measured) / 4;
+        state.calibrations++;
+        logger.debug("RTC drift: %ld ppm measured over %ld s, using %ld ppm", measured, elapsedServer, state.driftPpm);
+      } else {
+        logger.debug("RTC drift: ignoring implausible %ld ppm over %ld s", measured, elapsedServer);
+      }
+    }
+  }
+
+  struct timeval tv = {(time_t)serverTime, 0};
+  settimeofday(&tv, nullptr);
+  state.clockSyncedAt = serverTime;
+  logger.trace("Clock set to %lu", serverTime);
+}
+
+// Server time estimate, the local clock corrected by the measured drift
+uint32_t SleepTimer::now() {
+  uint32_t local = time(nullptr);
+  if (state.clockSyncedAt == 0 || local < state.clockSyncedAt) {
+    return local;
+  }
+
+  int64_t elapsed = local - state.clockSyncedAt;
+  return state.clockSyncedAt + elapsed + elapsed * state.driftPpm / 1000000;
+}
+
+void SleepTimer::deepSleep(uint32_t seconds) {
+  state.sleepStartedAt = clockValid() ? (uint32_t)time(nullptr) : 0;
+  state.plannedSleep = seconds;
+
+  // The timer counts local (drifting) time, ask for as much of it as corresponds to the requested server time
+  uint64_t sleepUs = (uint64_t)seconds * uS_PER_S;
+  if (state.driftPpm != 0) {
+    sleepUs = sleepUs * 1000000 / (1000000 + state.driftPpm);
+    logger.trace("Sleep corrected by %ld ppm to %llu us", state.driftPpm, sleepUs);
+  }
+
+  esp_sleep_enable_timer_wakeup(sleepUs);
+  esp_deep_sleep_start();
+}
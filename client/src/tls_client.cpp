@@ -0,0 +1,417 @@
+#include "tls_client.h"
+
+#include "logger.h"
+#include "power_manager.h"
+#include "wifi_client.h"
+
+#ifdef USE_HTTPS
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/sha256.h>
+#include <mbedtls/ssl.h>
+#include <mbedtls/version.h>
+#include <mbedtls/x509_crt.h>
+
+// Fields which mbedTLS 3 made private
+#ifndef MBEDTLS_PRIVATE
+#define MBEDTLS_PRIVATE(member) member
+#endif
+
+struct TlsConnection {
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config config;
+  mbedtls_entropy_context entropy;
+  mbedtls_ctr_drbg_context drbg;
+#ifdef CALENDAR_SERVER_CA_CERT
+  mbedtls_x509_crt ca;
+#endif
+};
+
+static void freeConnection(TlsConnection* tls) {
+  mbedtls_ssl_free(&tls->ssl);
+  mbedtls_ssl_config_free(&tls->config);
+  mbedtls_ctr_drbg_free(&tls->drbg);
+  mbedtls_entropy_free(&tls->entropy);
+#ifdef CALENDAR_SERVER_CA_CERT
+  mbedtls_x509_crt_free(&tls->ca);
+#endif
+  free(tls);
+}
+
+#ifdef CALENDAR_SERVER_CERT_SHA256
+// Hex digits with optional separators (as printed by openssl x509 -fingerprint -sha256)
+static bool parseFingerprint(const char* hex, uint8_t* fingerprint) {
+  int digits = 0;
+  for (const char* p = hex; *p != '\0'; p++) {
+    int value;
+    if (*p >= '0' && *p <= '9') {
+      value = *p - '0';
+    } else if (*p >= 'a' && *p <= 'f') {
+      value = *p - 'a' + 10;
+    } else if (*p >= 'A' && *p <= 'F') {
+      value = *p - 'A' + 10;
+    } else {
+      continue;
+    }
+    if (digits >= 64) {
+      return false;
+    }
+    fingerprint[digits / 2] = digits % 2 == 0 ? value << 4 : fingerprint[digits / 2] | value;
+    digits++;
+  }
+  return digits == 64;
+}
+#endif
+#else
+struct TlsConnection {};
+#endif
+
+TlsClient::TlsClient(Logger& logger, TlsSessionState& state, PowerManager& powerManager)
+    : logger(logger), state(state), powerManager(powerManager), tls(nullptr), peeked(-1) {}
+
+TlsClient::~TlsClient() { stop(); }
+
+void TlsClient::beginWake() {
+#ifdef USE_HTTPS
+  state.lastHandshakes = state.handshakes;
+  state.lastResumed = state.resumed;
+  state.lastHandshakeMs = state.handshakeMs;
+  state.handshakes = 0;
+  state.resumed = 0;
+  state.handshakeMs = 0;
+#endif
+}
+
+bool TlsClient::lastWakeStats(uint8_t& handshakes, uint8_t& resumed, uint32_t& handshakeMs) {
+#ifdef USE_HTTPS
+  handshakes = state.lastHandshakes;
+  resumed = state.lastResumed;
+  handshakeMs = state.lastHandshakeMs;
+  return handshakes > 0;
+#else
+  return false;
+#endif
+}
+
+int TlsClient::sendCallback(void* context, const unsigned char* data, size_t size) {
+#ifdef USE_HTTPS
+  TlsClient* client = (TlsClient*)context;
+  size_t written = client->WiFiClient::write(data, size);
+  return written > 0 ? (int)written : MBEDTLS_ERR_NET_SEND_FAILED;
+#else
+  return -1;
+#endif
+}
+
+// Non-blocking like WiFiClient itself, the waiting is done by the callers
+int TlsClient::receiveCallback(void* context, unsigned char* buffer, size_t size) {
+#ifdef USE_HTTPS
+  TlsClient* client = (TlsClient*)context;
+  int available = client->WiFiClient::available();
+  if (available <= 0) {
+    return client->WiFiClient::connected() ? MBEDTLS_ERR_SSL_WANT_READ : 0;
+  }
+  int res = client->WiFiClient::read(buffer, min((size_t)available, size));
+  return res > 0 ? res : MBEDTLS_ERR_NET_RECV_FAILED;
+#else
+  return -1;
+#endif
+}
+
+int TlsClient::connect(IPAddress ip, uint16_t port) { return connect(ip.toString().c_str(), port, TLS_HANDSHAKE_TIMEOUT); }
+
+int TlsClient::connect(IPAddress ip, uint16_t port, int32_t timeout) { return connect(ip.toString().c_str(), port, timeout); }
+
+int TlsClient::connect(const char* host, uint16_t port) { return connect(host, port, TLS_HANDSHAKE_TIMEOUT); }
+
+int TlsClient::connect(const char* host, uint16_t port, int32_t timeout) {
+  stop();
+  if (!WiFiClient::connect(host, port, timeout)) {
+    return 0;
+  }
+  if (!handshake(host)) {
+    stop();
+    return 0;
+  }
+  return 1;
+}
+
+bool TlsClient::handshake(const char* host) {
+#ifdef USE_HTTPS
+  uint32_t start = millis();
+
+  tls = (TlsConnection*)malloc(sizeof(TlsConnection));
+  if (tls == nullptr) {
+    logger.debug("TLS: can't allocate %d bytes", sizeof(TlsConnection));
+    return false;
+  }
+  mbedtls_ssl_init(&tls->ssl);
+  mbedtls_ssl_config_init(&tls->config);
+  mbedtls_entropy_init(&tls->entropy);
+  mbedtls_ctr_drbg_init(&tls->drbg);
+#ifdef CALENDAR_SERVER_CA_CERT
+  mbedtls_x509_crt_init(&tls->ca);
+#endif
+
+  int ret = mbedtls_ctr_drbg_seed(&tls->drbg, mbedtls_entropy_func, &tls->entropy, nullptr, 0);
+  if (ret == 0) {
+    ret = mbedtls_ssl_config_defaults(&tls->config, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+  }
+  if (ret != 0) {
+    logger.debug("TLS: setup failed with -0x%04x", -ret);
+    return false;
+  }
+  mbedtls_ssl_conf_rng(&tls->config, mbedtls_ctr_drbg_random, &tls->drbg);
+  mbedtls_ssl_conf_session_tickets(&tls->config, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#ifdef CALENDAR_SERVER_CA_CERT
+  ret = mbedtls_x509_crt_parse(&tls->ca, (const unsigned char*)CALENDAR_SERVER_CA_CERT, strlen(CALENDAR_SERVER_CA_CERT) + 1);
+  if (ret != 0) {
+    logger.debug("TLS: invalid CALENDAR_SERVER_CA_CERT (-0x%04x)", -ret);
+    return false;
+  }
+  mbedtls_ssl_conf_ca_chain(&tls->config, &tls->ca, nullptr);
+  mbedtls_ssl_conf_authmode(&tls->config, MBEDTLS_SSL_VERIFY_REQUIRED);
+#else
+  // Checked against the fingerprint in verifyServerCertificate() instead
+  mbedtls_ssl_conf_authmode(&tls->config, MBEDTLS_SSL_VERIFY_NONE);
+#endif
+
+  if (mbedtls_ssl_setup(&tls->ssl, &tls->config) != 0 || mbedtls_ssl_set_hostname(&tls->ssl, host) != 0) {
+    logger.debug("TLS: setup failed");
+    return false;
+  }
+  mbedtls_ssl_set_bio(&tls->ssl, this, sendCallback, receiveCallback, nullptr);
+
+  bool resuming = false;
+  if (state.sessionSize > 0) {
+    mbedtls_ssl_session session;
+    mbedtls_ssl_session_init(&session);
+    resuming = mbedtls_ssl_session_load(&session, state.session, state.sessionSize) == 0 && mbedtls_ssl_set_session(&tls->ssl, &session) == 0;
+    mbedtls_ssl_session_free(&session);
+    if (!resuming) {
+      logger.debug("TLS: cached session is not usable");
+      state.sessionSize = 0;
+    }
+  }
+
+  // Step by step, a server which resumes the session goes from its hello straight to the change cipher spec message
+  // without sending its certificate
+  bool fullHandshake = false;
+  while (tls->ssl.MBEDTLS_PRIVATE(state) != MBEDTLS_SSL_HANDSHAKE_OVER) {
+    ret = mbedtls_ssl_handshake_step(&tls->ssl);
+    if (tls->ssl.MBEDTLS_PRIVATE(state) == MBEDTLS_SSL_SERVER_CERTIFICATE) {
+      fullHandshake = true;
+    }
+    if (ret == 0) {
+      continue;
+    }
+    uint32_t elapsed = millis() - start;
+    if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) || elapsed >= TLS_HANDSHAKE_TIMEOUT) {
+      logger.debug("TLS: handshake with %s failed with -0x%04x after %lu ms", host, -ret, elapsed);
+      if (resuming) {
+        state.sessionSize = 0;  // start from scratch next time
+      }
+      return false;
+    }
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+      waitForSocketData(*this, TLS_HANDSHAKE_TIMEOUT - elapsed, &powerManager);
+    }
+  }
+
+  if (!verifyServerCertificate(fullHandshake)) {
+    state.sessionSize = 0;
+    return false;
+  }
+  saveSession();
+
+  uint32_t handshakeMs = millis() - start;
+  state.handshakes++;
+  state.handshakeMs += handshakeMs;
+  if (!fullHandshake) {
+    state.resumed++;
+  }
+  logger.debug("TLS: %s handshake with %s in %lu ms (%s)", fullHandshake ? "full" : "resumed", host, handshakeMs,
+               mbedtls_ssl_get_ciphersuite(&tls->ssl));
+  return true;
+#else
+  return false;
+#endif
+}
+
+// The certificate of a resumed session comes from the session itself (with MBEDTLS_SSL_KEEP_PEER_CERTIFICATE), checking it
+// again costs just a hash
+bool TlsClient::verifyServerCertificate(bool fullHandshake) {
+#ifdef USE_HTTPS
+  const mbedtls_x509_crt* certificate = mbedtls_ssl_get_peer_cert(&tls->ssl);
+  if (certificate == nullptr) {
+    if (!fullHandshake) {
+      // Resumed without the certificate, the session is only cached after a verified handshake
+      return true;
+    }
+#if defined(CALENDAR_SERVER_CA_CERT) && !defined(CALENDAR_SERVER_CERT_SHA256)
+    // Already verified against the CA by mbedTLS (MBEDTLS_SSL_VERIFY_REQUIRED)
+    return true;
+#else
+    // Nothing to compare with the pin or the trusted fingerprint, the handshake itself didn't check anything
+    logger.debug("TLS: no server certificate after a full handshake (is MBEDTLS_SSL_KEEP_PEER_CERTIFICATE off?), refusing it");
+    return false;
+#endif
+  }
+
+  uint8_t fingerprint[32];
+#if MBEDTLS_VERSION_MAJOR >= 3
+  mbedtls_sha256(certificate->raw.p, certificate->raw.len, fingerprint, 0);
+#else
+  mbedtls_sha256_ret(certificate->raw.p, certificate->raw.len, fingerprint, 0);
+#endif
+
+#ifdef CALENDAR_SERVER_CERT_SHA256
+  uint8_t pinned[32];
+  if (!parseFingerprint(CALENDAR_SERVER_CERT_SHA256, pinned) || memcmp(fingerprint, pinned, sizeof(pinned)) != 0) {
+    logger.debug("TLS: server certificate doesn't match CALENDAR_SERVER_CERT_SHA256");
+    return false;
+  }
+#elif !defined(CALENDAR_SERVER_CA_CERT)
+  if (state.fingerprintValid && memcmp(fingerprint, state.fingerprint, sizeof(fingerprint)) != 0) {
+    logger.debug("TLS: server certificate has changed since the last reset, refusing it");
+    return false;
+  }
+  if (!state.fingerprintValid) {
+    logger.debug("TLS: WARNING: trusting the server certificate on first use, define CALENDAR_SERVER_CERT_SHA256 in board.h to pin it");
+  }
+#endif
+
+  memcpy(state.fingerprint, fingerprint, sizeof(fingerprint));
+  state.fingerprintValid = true;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Every handshake may bring a new session ticket, the last one is kept for the next connection (in this wakeup or after
+// the deep sleep)
+void TlsClient::saveSession() {
+#ifdef USE_HTTPS
+  mbedtls_ssl_session session;
+  mbedtls_ssl_session_init(&session);
+  if (mbedtls_ssl_get_session(&tls->ssl, &session) == 0) {
+    size_t size = 0;
+    if (mbedtls_ssl_session_save(&session, state.session, sizeof(state.session), &size) == 0) {
+      state.sessionSize = size;
+    } else {
+      logger.debug("TLS: session doesn't fit into %d bytes of TLS_SESSION_CACHE_SIZE, not cached", sizeof(state.session));
+      state.sessionSize = 0;
+    }
+  }
+  mbedtls_ssl_session_free(&session);
+#endif
+}
+
+size_t TlsClient::write(uint8_t data) { return write(&data, 1); }
+
+size_t TlsClient::write(const uint8_t* buffer, size_t size) {
+#ifdef USE_HTTPS
+  if (tls == nullptr) {
+    return 0;
+  }
+  size_t done = 0;
+  while (done < size) {
+    int ret = mbedtls_ssl_write(&tls->ssl, buffer + done, size - done);
+    if (ret > 0) {
+      done += ret;
+    } else if (ret != MBEDTLS_ERR_SSL_WANT_WRITE && ret != MBEDTLS_ERR_SSL_WANT_READ) {
+      logger.debug("TLS: write failed with -0x%04x", -ret);
+      break;
+    }
+  }
+  return done;
+#else
+  return 0;
+#endif
+}
+
+// Decrypted bytes ready to be read. Encrypted data waiting in the socket is decrypted first (one byte of it is kept aside
+// in `peeked`), so that the callers which wait for the socket with select() don't spin on a half-read record.
+int TlsClient::available() {
+#ifdef USE_HTTPS
+  if (tls == nullptr) {
+    return 0;
+  }
+  int pending = mbedtls_ssl_get_bytes_avail(&tls->ssl);
+  if (peeked < 0 && pending == 0 && WiFiClient::available() > 0) {
+    uint8_t data;
+    int ret = mbedtls_ssl_read(&tls->ssl, &data, 1);
+    if (ret == 1) {
+      peeked = data;
+    } else if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      // Closed by the server (close notify or EOF) or a broken record
+      WiFiClient::stop();
+      return 0;
+    }
+    pending = mbedtls_ssl_get_bytes_avail(&tls->ssl);
+  }
+  return pending + (peeked >= 0 ? 1 : 0);
+#else
+  return 0;
+#endif
+}
+
+int TlsClient::read() {
+  uint8_t data;
+  return read(&data, 1) == 1 ? data : -1;
+}
+
+int TlsClient::read(uint8_t* buffer, size_t size) {
+#ifdef USE_HTTPS
+  if (tls == nullptr || size == 0) {
+    return -1;
+  }
+  size_t done = 0;
+  if (peeked >= 0) {
+    buffer[done++] = peeked;
+    peeked = -1;
+  }
+  if (done < size && (mbedtls_ssl_get_bytes_avail(&tls->ssl) > 0 || WiFiClient::available() > 0)) {
+    int ret = mbedtls_ssl_read(&tls->ssl, buffer + done, size - done);
+    if (ret > 0) {
+      done += ret;
+    }
+  }
+  return done > 0 ? (int)done : -1;
+#else
+  return -1;
+#endif
+}
+
+int TlsClient::peek() {
+  // available() may read the byte ahead itself
+  if (available() > 0 && peeked < 0) {
+    uint8_t data;
+    if (read(&data, 1) == 1) {
+      peeked = data;
+    }
+  }
+  return peeked;
+}
+
+void TlsClient::flush() {
+  // Records are sent as soon as they are written
+}
+
+void TlsClient::stop() {
+#ifdef USE_HTTPS
+  if (tls != nullptr) {
+    if (WiFiClient::connected()) {
+      mbedtls_ssl_close_notify(&tls->ssl);
+    }
+    freeConnection(tls);
+    tls = nullptr;
+  }
+#endif
+  peeked = -1;
+  WiFiClient::stop();
+}
+
+uint8_t TlsClient::connected() { return tls != nullptr && (available() > 0 || WiFiClient::connected()); }
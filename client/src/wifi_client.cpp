@@ -2,10 +2,12 @@
 
 #include <Arduino.h>
 #include <ArduinoOTA.h>
+#include <lwip/sockets.h>
 
 #include "hw_config.h"
 #include "logger.h"
-#include "ota_manager.h"
+#include "power_manager.h"
+#include "service_ticker.h"
 #include "version.h"
 #include "wdt_manager.h"
 
@@ -14,33 +16,94 @@
 extern WiFiManager wifiManager;
 #endif
 
+bool waitForSocketData(WiFiClient& client, uint32_t timeoutMs, PowerManager* powerManager) {
+  int fd = client.fd();
+  if (fd < 0) {
+    return false;
+  }
+
+  fd_set readSet;
+  FD_ZERO(&readSet);
+  FD_SET(fd, &readSet);
+
+  struct timeval tv;
+  tv.tv_sec = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+
+  if (powerManager) {
+    powerManager->idleWaitBegin();
+  }
+  int res = select(fd + 1, &readSet, NULL, NULL, &tv);
+  if (powerManager) {
+    powerManager->idleWaitEnd();
+  }
+
+  return res > 0;
+}
+
+int readWithDeadline(WiFiClient& client, uint8_t* buffer, size_t size, uint32_t timeoutMs, PowerManager* powerManager) {
+  size_t done = 0;
+  uint32_t start = millis();
+
+  while (done < size) {
+    int available = client.available();
+    if (available > 0) {
+      // Take whatever is buffered, partial chunks included, so that select() below only runs on an empty socket
+      size_t chunk = min((size_t)available, size - done);
+      int res = client.read(buffer + done, chunk);
+      if (res <= 0) {
+        break;
+      }
+      done += res;
+      continue;
+    }
+
+    if (!client.connected()) {
+      break;
+    }
+
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= timeoutMs || !waitForSocketData(client, timeoutMs - elapsed, powerManager)) {
+      break;
+    }
+  }
+
+  return done;
+}
+
 // WiFiClientWithBlockingReads implementation
-void WiFiClientWithBlockingReads::setOTAManager(OTAManager* manager) { otaManager = manager; }
+void WiFiClientWithBlockingReads::setServiceTicker(ServiceTicker* ticker) { serviceTicker = ticker; }
+
+void WiFiClientWithBlockingReads::setPowerManager(PowerManager* manager) { powerManager = manager; }
 
 int WiFiClientWithBlockingReads::blocking_read(uint8_t* buffer, size_t bytes) {
-  int remain = bytes;
+  size_t remain = bytes;
   uint32_t start = millis();
 
   while ((WiFiClient::connected() || WiFiClient::available()) && (remain > 0)) {
-    if (otaManager) {
-      otaManager->loop();
+    if (serviceTicker) {
+      serviceTicker->tick();
     }
-    if (WiFiClient::available()) {
+    int available = WiFiClient::available();
+    if (available > 0) {
       uint8_t data = 0;
-      int res = WiFiClient::read(&data, 1);
+      size_t chunk = buffer ? min((size_t)available, remain) : 1;
+      int res = WiFiClient::read(buffer ? buffer : &data, chunk);
       if (res <= 0) {
         return res;
       }
       if (buffer) {
-        *buffer++ = data;
+        buffer += res;
       }
-      remain--;
-    } else {
-      delay(1);
+      remain -= res;
+      continue;
     }
-    if (millis() - start > blockingReadTimeout) {
+
+    uint32_t elapsed = millis() - start;
+    if (elapsed > blockingReadTimeout) {
       return -1;
     }
+    waitForSocketData(*this, blockingReadTimeout - elapsed, powerManager);
   }
 
   return bytes - remain;
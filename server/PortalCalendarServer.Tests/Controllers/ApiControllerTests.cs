@@ -17,11 +17,13 @@ public class ApiControllerTests : IntegrationServiceTestBase
 {
     private readonly Mock<IDisplayService> _mockDisplayService;
     private readonly Mock<IMqttService> _mockMqttService;
+    private readonly Mock<IFirmwareService> _mockFirmwareService;
 
     public ApiControllerTests()
     {
         _mockDisplayService = new Mock<IDisplayService>();
         _mockMqttService = new Mock<IMqttService>();
+        _mockFirmwareService = new Mock<IFirmwareService>();
 
         // Default MQTT setup — most tests don't care about MQTT internals
         _mockMqttService
@@ -32,13 +34,9 @@ public class ApiControllerTests : IntegrationServiceTestBase
             .Returns(Task.CompletedTask);
     }
 
-    private ApiController CreateController()
+    private Mock<PageGeneratorService> CreatePageGeneratorServiceMock()
     {
-        var logger = Mock.Of<ILogger<ApiController>>();
-        var themeService = new ThemeService(Context);
-
-        // PageGeneratorService is only needed for the Bitmap endpoint; supply a stub
-        var pageGenService = new Mock<PageGeneratorService>(
+        return new Mock<PageGeneratorService>(
             Mock.Of<ILogger<PageGeneratorService>>(),
             Mock.Of<Microsoft.Extensions.Configuration.IConfiguration>(),
             Mock.Of<Microsoft.AspNetCore.Hosting.IWebHostEnvironment>(),
@@ -47,7 +45,16 @@ public class ApiControllerTests : IntegrationServiceTestBase
             new InternalTokenService(),
             Mock.Of<Microsoft.AspNetCore.Routing.LinkGenerator>(),
             new Modules.ModuleRegistry(),
-            Mock.Of<IServiceProvider>()).Object;
+            Mock.Of<IServiceProvider>());
+    }
+
+    private ApiController CreateController(PageGeneratorService? pageGenService = null)
+    {
+        var logger = Mock.Of<ILogger<ApiController>>();
+        var themeService = new ThemeService(Context);
+
+        // PageGeneratorService is only needed for the Bitmap endpoints; supply a stub
+        pageGenService ??= CreatePageGeneratorServiceMock().Object;
 
         var controller = new ApiController(
             Context,
@@ -56,7 +63,8 @@ public class ApiControllerTests : IntegrationServiceTestBase
             pageGenService,
             themeService,
             Mock.Of<IWeb2PngService>(),
-            _mockMqttService.Object);
+            _mockMqttService.Object,
+            _mockFirmwareService.Object);
 
         controller.ControllerContext = new ControllerContext
         {
@@ -128,7 +136,8 @@ public class ApiControllerTests : IntegrationServiceTestBase
             stubPageGenService,
             new ThemeService(emptyContext),
             Mock.Of<IWeb2PngService>(),
-            _mockMqttService.Object);
+            _mockMqttService.Object,
+            _mockFirmwareService.Object);
 
         var result = controller.Health();
 
@@ -319,6 +328,105 @@ public class ApiControllerTests : IntegrationServiceTestBase
         Assert.Contains("ota_mode", propNames);
     }
 
+    [Fact]
+    public async Task Config_WithKnownMac_ReturnsAbsoluteWakeupTime()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:11:23");
+        var nextWakeup = DateTime.UtcNow.AddHours(5);
+
+        _mockDisplayService.Setup(s => s.GetMissedConnects(It.IsAny<Display>())).Returns(0);
+        _mockDisplayService.Setup(s => s.GetNextWakeupTime(It.IsAny<Display>(), It.IsAny<DateTime?>()))
+            .Returns(new WakeUpInfo { NextWakeup = nextWakeup, SleepInSeconds = 5 * 3600, Schedule = "0 * * * *", NextContentChange = nextWakeup });
+        _mockDisplayService.Setup(s => s.GetConfigBool(It.IsAny<Display>(), It.IsAny<string>(), It.IsAny<bool>())).Returns(false);
+        _mockDisplayService.Setup(s => s.GetConfig(It.IsAny<Display>(), It.IsAny<string>())).Returns((string?)null);
+
+        var controller = CreateController();
+        var before = DateTimeOffset.UtcNow.ToUnixTimeSeconds();
+        var result = await controller.Config(
+            mac: display.Mac, fw: null, w: null, h: null, c: null, rotation: null,
+            voltage_raw: null, v: null, vmin: null, vmax: null,
+            vlmin: null, vlmax: null, reset: null, wakeup: null);
+
+        var ok = Assert.IsType<OkObjectResult>(result);
+        var type = ok.Value!.GetType();
+        var now = (long)type.GetProperty("now")!.GetValue(ok.Value)!;
+        var nextChange = (long)type.GetProperty("next_change")!.GetValue(ok.Value)!;
+        Assert.InRange(now, before, DateTimeOffset.UtcNow.ToUnixTimeSeconds());
+        Assert.Equal(new DateTimeOffset(nextWakeup).ToUnixTimeSeconds(), nextChange);
+    }
+
+    [Fact]
+    public async Task Config_ReturnsRefreshModeSchedule()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:11:26");
+        var cleanRefresh = DateTime.UtcNow.Date.AddDays(1).AddHours(3);
+
+        _mockDisplayService.Setup(s => s.GetMissedConnects(It.IsAny<Display>())).Returns(0);
+        _mockDisplayService.Setup(s => s.GetNextWakeupTime(It.IsAny<Display>(), It.IsAny<DateTime?>())).Returns(MakeWakeUpInfo());
+        _mockDisplayService.Setup(s => s.GetConfigBool(It.IsAny<Display>(), It.IsAny<string>(), It.IsAny<bool>())).Returns(false);
+        _mockDisplayService.Setup(s => s.GetConfig(It.IsAny<Display>(), It.IsAny<string>())).Returns((string?)null);
+        _mockDisplayService.Setup(s => s.GetConfigInt(It.IsAny<Display>(), "max_fast_refreshes")).Returns(5);
+        _mockDisplayService.Setup(s => s.GetNextCleanRefreshTime(It.IsAny<Display>(), It.IsAny<DateTime?>())).Returns(cleanRefresh);
+
+        var controller = CreateController();
+        var result = await controller.Config(
+            mac: display.Mac, fw: null, w: null, h: null, c: null, rotation: null,
+            voltage_raw: null, v: null, vmin: null, vmax: null,
+            vlmin: null, vlmax: null, reset: null, wakeup: null);
+
+        var ok = Assert.IsType<OkObjectResult>(result);
+        var type = ok.Value!.GetType();
+        Assert.Equal(5, type.GetProperty("max_fast_refreshes")!.GetValue(ok.Value));
+        Assert.Equal(new DateTimeOffset(cleanRefresh).ToUnixTimeSeconds(), type.GetProperty("clean_refresh_at")!.GetValue(ok.Value));
+    }
+
+    [Fact]
+    public async Task Config_WithPendingFirmwareUpdate_AdvertisesIt()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:11:24");
+
+        _mockDisplayService.Setup(s => s.GetMissedConnects(It.IsAny<Display>())).Returns(0);
+        _mockDisplayService.Setup(s => s.GetNextWakeupTime(It.IsAny<Display>(), It.IsAny<DateTime?>())).Returns(MakeWakeUpInfo());
+        _mockDisplayService.Setup(s => s.GetConfigBool(It.IsAny<Display>(), It.IsAny<string>(), It.IsAny<bool>())).Returns(false);
+        _mockDisplayService.Setup(s => s.GetConfig(It.IsAny<Display>(), It.IsAny<string>())).Returns((string?)null);
+        _mockFirmwareService.Setup(s => s.GetPendingUpdate(It.IsAny<Display>()))
+            .Returns(new FirmwareImage { Version = "2.3.0", ImagePath = "firmware.bin", Size = 1234, Sha256 = "abcd" });
+
+        var controller = CreateController();
+        var result = await controller.Config(
+            mac: display.Mac, fw: "2.2.3", w: null, h: null, c: null, rotation: null,
+            voltage_raw: null, v: null, vmin: null, vmax: null,
+            vlmin: null, vlmax: null, reset: null, wakeup: null);
+
+        var ok = Assert.IsType<OkObjectResult>(result);
+        var firmware = ok.Value!.GetType().GetProperty("firmware")!.GetValue(ok.Value);
+        Assert.NotNull(firmware);
+        var type = firmware!.GetType();
+        Assert.Equal("2.3.0", type.GetProperty("version")!.GetValue(firmware));
+        Assert.Equal(1234L, type.GetProperty("size")!.GetValue(firmware));
+        Assert.Equal("abcd", type.GetProperty("sha256")!.GetValue(firmware));
+    }
+
+    [Fact]
+    public async Task Config_WithoutFirmwareUpdate_ReturnsNullFirmware()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:11:25");
+
+        _mockDisplayService.Setup(s => s.GetMissedConnects(It.IsAny<Display>())).Returns(0);
+        _mockDisplayService.Setup(s => s.GetNextWakeupTime(It.IsAny<Display>(), It.IsAny<DateTime?>())).Returns(MakeWakeUpInfo());
+        _mockDisplayService.Setup(s => s.GetConfigBool(It.IsAny<Display>(), It.IsAny<string>(), It.IsAny<bool>())).Returns(false);
+        _mockDisplayService.Setup(s => s.GetConfig(It.IsAny<Display>(), It.IsAny<string>())).Returns((string?)null);
+
+        var controller = CreateController();
+        var result = await controller.Config(
+            mac: display.Mac, fw: null, w: null, h: null, c: null, rotation: null,
+            voltage_raw: null, v: null, vmin: null, vmax: null,
+            vlmin: null, vlmax: null, reset: null, wakeup: null);
+
+        var ok = Assert.IsType<OkObjectResult>(result);
+        Assert.Null(ok.Value!.GetType().GetProperty("firmware")!.GetValue(ok.Value));
+    }
+
     [Fact]
     public async Task Config_MacIsCaseInsensitive_MatchesExistingDisplay()
     {
@@ -378,7 +486,8 @@ public class ApiControllerTests : IntegrationServiceTestBase
             .Setup(b => b.ConvertExistingRawBitmap(
                 display.Id,
                 It.IsAny<OutputFormat>(),
-                It.IsAny<DisplayRotation?>(), It.IsAny<string?>()
+                It.IsAny<DisplayRotation?>(), It.IsAny<string?>(),
+                It.IsAny<int>(), It.IsAny<BitmapDecoderCapabilities>()
                 ))
             .Returns(new BitmapResult { ErrorMessage = errMsg });
 
@@ -388,5 +497,359 @@ public class ApiControllerTests : IntegrationServiceTestBase
         Assert.IsType<NotFoundObjectResult>(result);
     }
 
+    [Fact]
+    public async Task BitmapEpaper_WithRowOffset_PassesItToDisplayService()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:bd");
+
+        _mockDisplayService
+            .Setup(b => b.ConvertExistingRawBitmap(
+                display.Id,
+                OutputFormat.EpaperSpecificV2,
+                It.IsAny<DisplayRotation?>(), It.IsAny<string?>(),
+                120, It.IsAny<BitmapDecoderCapabilities>()
+                ))
+            .Returns(new BitmapResult { Data = [1, 2, 3], ContentType = "application/octet-stream" });
+
+        var controller = CreateController();
+        var result = await controller.BitmapEpaper(mac: display.Mac, fmt: 2, row: 120);
+
+        Assert.IsType<FileContentResult>(result);
+        _mockDisplayService.Verify(b => b.ConvertExistingRawBitmap(
+            display.Id, OutputFormat.EpaperSpecificV2, It.IsAny<DisplayRotation?>(), It.IsAny<string?>(), 120, It.IsAny<BitmapDecoderCapabilities>()), Times.Once);
+    }
+
+    [Fact]
+    public async Task BitmapEpaper_V3_PassesRowOffsetAndCapabilitiesToDisplayService()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:bf");
+
+        _mockDisplayService
+            .Setup(b => b.ConvertExistingRawBitmap(
+                display.Id,
+                OutputFormat.EpaperSpecificV3,
+                It.IsAny<DisplayRotation?>(), It.IsAny<string?>(),
+                40, BitmapDecoderCapabilities.PackBitsRows
+                ))
+            .Returns(new BitmapResult { Data = [1, 2, 3], ContentType = "application/octet-stream" });
+
+        var controller = CreateController();
+        var result = await controller.BitmapEpaper(mac: display.Mac, fmt: 3, row: 40, caps: 1);
+
+        Assert.IsType<FileContentResult>(result);
+        _mockDisplayService.Verify(b => b.ConvertExistingRawBitmap(
+            display.Id, OutputFormat.EpaperSpecificV3, It.IsAny<DisplayRotation?>(), It.IsAny<string?>(), 40, BitmapDecoderCapabilities.PackBitsRows), Times.Once);
+    }
+
+    [Theory]
+    [InlineData(1, 10)]
+    [InlineData(2, -1)]
+    public async Task BitmapEpaper_WithInvalidRowOffset_ReturnsBadRequest(int fmt, int row)
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:be");
+
+        var controller = CreateController();
+        var result = await controller.BitmapEpaper(mac: display.Mac, fmt: fmt, row: row);
+
+        Assert.IsType<BadRequestObjectResult>(result);
+    }
+
+    [Fact]
+    public async Task BitmapEpaper_WithRowOffsetBeyondBitmap_ReturnsBadRequest()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:c0");
+
+        _mockDisplayService
+            .Setup(b => b.ConvertExistingRawBitmap(
+                display.Id,
+                OutputFormat.EpaperSpecificV3,
+                It.IsAny<DisplayRotation?>(), It.IsAny<string?>(),
+                480, It.IsAny<BitmapDecoderCapabilities>()
+                ))
+            .Throws(new ArgumentOutOfRangeException("firstRow", "First row 480 is outside of the bitmap (0..479)"));
+
+        var controller = CreateController();
+        var result = await controller.BitmapEpaper(mac: display.Mac, fmt: 3, row: 480);
+
+        Assert.IsType<BadRequestObjectResult>(result);
+    }
+
+    #endregion
+
+    #region Config — binary telemetry
+
+    // Encodes a flat MessagePack map the way ArduinoJson does for the values used by the firmware
+    private static byte[] MessagePackMap(params (string Key, object Value)[] entries)
+    {
+        var bytes = new List<byte> { (byte)(0x80 | entries.Length) };
+        void AddString(string value)
+        {
+            var utf8 = System.Text.Encoding.UTF8.GetBytes(value);
+            bytes.Add((byte)(0xa0 | utf8.Length));
+            bytes.AddRange(utf8);
+        }
+        foreach (var (key, value) in entries)
+        {
+            AddString(key);
+            switch (value)
+            {
+                case string str:
+                    AddString(str);
+                    break;
+                case int i:
+                    bytes.Add(0xd2);
+                    bytes.AddRange(BitConverter.GetBytes(i).Reverse());
+                    break;
+                case float f:
+                    bytes.Add(0xca);
+                    bytes.AddRange(BitConverter.GetBytes(f).Reverse());
+                    break;
+            }
+        }
+        return bytes.ToArray();
+    }
+
+    private ApiController CreateControllerWithBody(byte[] body)
+    {
+        var controller = CreateController();
+        controller.ControllerContext.HttpContext.Request.Body = new MemoryStream(body);
+        return controller;
+    }
+
+    private void SetupConfigDefaults()
+    {
+        _mockDisplayService.Setup(s => s.GetMissedConnects(It.IsAny<Display>())).Returns(0);
+        _mockDisplayService.Setup(s => s.GetNextWakeupTime(It.IsAny<Display>(), It.IsAny<DateTime?>())).Returns(MakeWakeUpInfo());
+        _mockDisplayService.Setup(s => s.GetConfigBool(It.IsAny<Display>(), It.IsAny<string>(), It.IsAny<bool>())).Returns(false);
+        _mockDisplayService.Setup(s => s.GetConfig(It.IsAny<Display>(), It.IsAny<string>())).Returns((string?)null);
+    }
+
+    [Fact]
+    public async Task ConfigBinary_WithoutStaticFields_KeepsStoredVoltageCurve()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:22:01");
+        SetupConfigDefaults();
+
+        var controller = CreateControllerWithBody(MessagePackMap(
+            ("ver", 1), ("mac", display.Mac), ("fw", "2.3.0"), ("c", "BW"),
+            ("adc", 2300), ("v", 3.85f), ("reset", "DEEPSLEEP"), ("wakeup", "TIMER"),
+            ("rssi", -67), ("heap", 123456), ("wifi", 850)));
+
+        var result = await controller.ConfigBinary();
+
+        var ok = Assert.IsType<OkObjectResult>(result);
+        Assert.Equal(false, ok.Value!.GetType().GetProperty("resend_static")!.GetValue(ok.Value));
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_last_voltage", "3.85"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_last_rssi", "-67"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_wifi_connect_ms", "850"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_min_voltage", It.IsAny<string>()), Times.Never);
+        var updated = await Context.Displays.FindAsync(display.Id);
+        Assert.Equal("2.3.0", updated!.Firmware);
+    }
+
+    [Fact]
+    public async Task ConfigBinary_WithStaticFields_StoresThem()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:22:02");
+        SetupConfigDefaults();
+
+        var controller = CreateControllerWithBody(MessagePackMap(
+            ("ver", 1), ("mac", display.Mac), ("fw", "2.3.0"), ("c", "BW"),
+            ("w", 480), ("h", 800), ("vmin", 3.2f), ("vmax", 4.2f), ("vlmin", 3.5f), ("vlmax", 4.1f)));
+
+        var result = await controller.ConfigBinary();
+
+        Assert.IsType<OkObjectResult>(result);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_min_voltage", "3.2"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_max_linear_voltage", "4.1"), Times.Once);
+        var updated = await Context.Displays.FindAsync(display.Id);
+        Assert.Equal(480, updated!.Width);
+        Assert.Equal(800, updated.Height);
+    }
+
+    [Fact]
+    public async Task ConfigBinary_WithBatteryModel_StoresAndPublishesIt()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:22:04");
+        SetupConfigDefaults();
+
+        var controller = CreateControllerWithBody(MessagePackMap(
+            ("ver", 1), ("mac", display.Mac), ("fw", "2.3.0"), ("c", "BW"),
+            ("bpol", 1), ("bsf", 2), ("bdays", 41.26f)));
+
+        var result = await controller.ConfigBinary();
+
+        Assert.IsType<OkObjectResult>(result);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_battery_days_remaining", "41.3"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_battery_policy", "1"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_sleep_factor", "2"), Times.Once);
+        _mockMqttService.Verify(s => s.PublishSensorAsync(It.IsAny<Display>(), "battery_days_remaining", 41.3, true), Times.Once);
+    }
+
+    [Fact]
+    public async Task ConfigBinary_WithMemoryMinima_StoresThem()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:22:05");
+        SetupConfigDefaults();
+
+        var controller = CreateControllerWithBody(MessagePackMap(
+            ("ver", 1), ("mac", display.Mac), ("fw", "2.3.0"), ("c", "BW"),
+            ("mheap", 81234), ("mblk", 45044), ("mstk", 3120), ("mstkip", 1288)));
+
+        var result = await controller.ConfigBinary();
+
+        Assert.IsType<OkObjectResult>(result);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_wake_min_free_heap", "81234"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_wake_min_largest_block", "45044"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_wake_min_free_psram", string.Empty), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_wake_min_loop_stack", "3120"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_wake_min_tcpip_stack", "1288"), Times.Once);
+    }
+
+    [Fact]
+    public async Task ConfigBinary_WithTlsStats_StoresThem()
+    {
+        var display = CreateTestDisplay(mac: "dd:ee:ff:00:22:06");
+        SetupConfigDefaults();
+
+        var controller = CreateControllerWithBody(MessagePackMap(
+            ("ver", 1), ("mac", display.Mac), ("fw", "2.3.0"), ("c", "BW"),
+            ("tlsn", 3), ("tlsr", 2), ("tlsms", 1875)));
+
+        var result = await controller.ConfigBinary();
+
+        Assert.IsType<OkObjectResult>(result);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_tls_handshakes", "3"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_tls_resumed", "2"), Times.Once);
+        _mockDisplayService.Verify(s => s.SetConfig(It.IsAny<Display>(), "_tls_handshake_ms", "1875"), Times.Once);
+    }
+
+    [Fact]
+    public async Task ConfigBinary_WithInvalidPayload_ReturnsBadRequest()
+    {
+        var controller = CreateControllerWithBody(new byte[] { 0x81, 0xa3, (byte)'m' });
+
+        var result = await controller.ConfigBinary();
+
+        Assert.IsType<BadRequestObjectResult>(result);
+    }
+
+    [Fact]
+    public async Task ConfigBinary_WithoutVersion_ReturnsBadRequest()
+    {
+        var controller = CreateControllerWithBody(MessagePackMap(("mac", "dd:ee:ff:00:22:03")));
+
+        var result = await controller.ConfigBinary();
+
+        Assert.IsType<BadRequestObjectResult>(result);
+    }
+
+    #endregion
+
+    #region Firmware
+
+    [Fact]
+    public async Task Firmware_WithUnknownMac_ReturnsNotFound()
+    {
+        var controller = CreateController();
+        var result = await controller.Firmware(mac: "00:00:00:00:00:01");
+
+        Assert.IsType<NotFoundObjectResult>(result);
+    }
+
+    [Fact]
+    public async Task Firmware_WithoutPendingUpdate_ReturnsNotFound()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:d0");
+
+        var controller = CreateController();
+        var result = await controller.Firmware(mac: display.Mac);
+
+        Assert.IsType<NotFoundObjectResult>(result);
+    }
+
+    [Fact]
+    public async Task Firmware_WithPendingUpdate_ReturnsCompressedImage()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:d1");
+        var image = new FirmwareImage { Version = "2.3.0", ImagePath = "/firmware/calendar.bin", Size = 1234, Sha256 = "abcd" };
+
+        _mockFirmwareService.Setup(s => s.GetPendingUpdate(It.IsAny<Display>())).Returns(image);
+        _mockFirmwareService.Setup(s => s.GetCompressedImagePath(image)).Returns("/firmware/calendar.bin.zlib");
+
+        var controller = CreateController();
+        var result = await controller.Firmware(mac: display.Mac);
+
+        var file = Assert.IsType<PhysicalFileResult>(result);
+        Assert.Equal("/firmware/calendar.bin.zlib", file.FileName);
+        Assert.Equal("application/zlib", file.ContentType);
+    }
+
+    #endregion
+
+    #region BitmapSchedule
+
+    [Fact]
+    public async Task BitmapSchedule_WhenDisabled_ReturnsEmptyBundle()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:c0");
+        var nextWakeup = new DateTime(2026, 1, 2, 3, 0, 0, DateTimeKind.Utc);
+
+        _mockDisplayService.Setup(s => s.GetConfigInt(It.IsAny<Display>(), "frame_schedule_count")).Returns((int?)null);
+        _mockDisplayService.Setup(s => s.GetNextWakeupTime(It.IsAny<Display>(), It.IsAny<DateTime?>()))
+            .Returns(new WakeUpInfo { NextWakeup = nextWakeup, SleepInSeconds = 3600, Schedule = "0 * * * *" });
+
+        var controller = CreateController();
+        var result = await controller.BitmapSchedule(mac: display.Mac, count: 4);
+
+        var file = Assert.IsType<FileContentResult>(result);
+        var expected = $"MS\n0 {new DateTimeOffset(nextWakeup).ToUnixTimeSeconds()}\n";
+        Assert.Equal(expected, System.Text.Encoding.ASCII.GetString(file.FileContents));
+    }
+
+    [Fact]
+    public async Task BitmapSchedule_ReturnsFramesForFollowingWakeups()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:c1");
+        var first = new DateTime(2026, 1, 2, 3, 0, 0, DateTimeKind.Utc);
+
+        _mockDisplayService.Setup(s => s.GetConfigInt(It.IsAny<Display>(), "frame_schedule_count")).Returns(2);
+        _mockDisplayService.Setup(s => s.GetNextWakeupTime(It.IsAny<Display>(), It.IsAny<DateTime?>()))
+            .Returns((Display _, DateTime? after) =>
+            {
+                var next = after.HasValue ? after.Value.AddHours(1) : first;
+                return new WakeUpInfo { NextWakeup = next, SleepInSeconds = 3600, Schedule = "0 * * * *" };
+            });
+        _mockDisplayService.Setup(s => s.ConvertScheduledWebSnapshot(display.Id, It.IsAny<string>()))
+            .Returns(new BitmapResult { Data = System.Text.Encoding.ASCII.GetBytes("MM\nabc\n\x01") });
+
+        var pageGenService = CreatePageGeneratorServiceMock();
+        pageGenService.Setup(p => p.GenerateScheduledImageAsync(It.IsAny<Display>(), It.IsAny<DateTime>()))
+            .ReturnsAsync("snapshot.png");
+
+        var controller = CreateController(pageGenService.Object);
+        // The device asks for more than the server allows
+        var result = await controller.BitmapSchedule(mac: display.Mac, count: 5);
+
+        var file = Assert.IsType<FileContentResult>(result);
+        long Epoch(DateTime dt) => new DateTimeOffset(dt).ToUnixTimeSeconds();
+        var expected = $"MS\n2 {Epoch(first.AddHours(2))}\n" +
+                       $"{Epoch(first)}\nMM\nabc\n\x01" +
+                       $"{Epoch(first.AddHours(1))}\nMM\nabc\n\x01";
+        Assert.Equal(expected, System.Text.Encoding.ASCII.GetString(file.FileContents));
+        pageGenService.Verify(p => p.GenerateScheduledImageAsync(It.IsAny<Display>(), It.IsAny<DateTime>()), Times.Exactly(2));
+    }
+
+    [Fact]
+    public async Task BitmapSchedule_WithNegativeCount_ReturnsBadRequest()
+    {
+        var display = CreateTestDisplay(mac: "12:34:56:78:9a:c2");
+
+        var controller = CreateController();
+        var result = await controller.BitmapSchedule(mac: display.Mac, count: -1);
+
+        Assert.IsType<BadRequestObjectResult>(result);
+    }
+
     #endregion
 }
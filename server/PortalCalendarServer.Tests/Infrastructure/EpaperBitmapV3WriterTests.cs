@@ -0,0 +1,139 @@
+using System.Buffers.Binary;
+using System.Security.Cryptography;
+using PortalCalendarServer.Infrastructure;
+using PortalCalendarServer.Models.POCOs.Bitmap;
+
+namespace PortalCalendarServer.Tests.Infrastructure;
+
+/// <summary>
+/// Unit tests for the v3 e-paper bitmap sent to the devices
+/// </summary>
+public class EpaperBitmapV3WriterTests
+{
+    // 4 rows of 8 bytes (64 px at 1 bpp): white, a stripe, noise, white
+    private static byte[] SampleRows() =>
+    [
+        0, 0, 0, 0, 0, 0, 0, 0,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        1, 2, 3, 4, 5, 6, 7, 8,
+        0, 0, 0, 0, 0, 0, 0, 0,
+    ];
+
+    // Same as packbitsDecode() of the firmware
+    private static byte[] UnpackBits(ReadOnlySpan<byte> data)
+    {
+        var output = new List<byte>();
+        var position = 0;
+        while (position < data.Length)
+        {
+            var n = (sbyte)data[position++];
+            if (n >= 0)
+            {
+                output.AddRange(data.Slice(position, n + 1).ToArray());
+                position += n + 1;
+            }
+            else if (n != -128)
+            {
+                output.AddRange(Enumerable.Repeat(data[position++], 1 - n));
+            }
+        }
+        return output.ToArray();
+    }
+
+    [Fact]
+    public void Write_Header()
+    {
+        var rows = SampleRows();
+
+        var output = EpaperBitmapV3Writer.Write(rows, 64, 4, 1, 0, BitmapDecoderCapabilities.None);
+
+        Assert.Equal((byte)'M', output[0]);
+        Assert.Equal((byte)'M', output[1]);
+        Assert.Equal(3, output[2]);
+        Assert.Equal(EpaperBitmapV3Writer.HeaderSize, output[3]);
+        Assert.Equal(64, BinaryPrimitives.ReadUInt16LittleEndian(output.AsSpan(4)));
+        Assert.Equal(4, BinaryPrimitives.ReadUInt16LittleEndian(output.AsSpan(6)));
+        Assert.Equal(1, output[8]);
+        Assert.Equal(EpaperBitmapV3Writer.EncodingRaw, output[9]);
+        Assert.Equal(0, BinaryPrimitives.ReadUInt16LittleEndian(output.AsSpan(12)));
+        Assert.Equal(4, BinaryPrimitives.ReadUInt16LittleEndian(output.AsSpan(14)));
+        Assert.Equal((uint)rows.Length, BinaryPrimitives.ReadUInt32LittleEndian(output.AsSpan(16)));
+        Assert.Equal(EpaperBitmapV3Writer.FrameHash(rows, 8), BinaryPrimitives.ReadUInt64LittleEndian(output.AsSpan(20)));
+        Assert.Equal(SHA1.HashData(rows), output.AsSpan(28, 20).ToArray());
+        Assert.Equal(rows, output.AsSpan(EpaperBitmapV3Writer.HeaderSize).ToArray());
+    }
+
+    [Fact]
+    public void Write_WithRowOffset_SendsOnlyTheRemainingRows()
+    {
+        var rows = SampleRows();
+        var full = EpaperBitmapV3Writer.Write(rows, 64, 4, 1, 0, BitmapDecoderCapabilities.None);
+
+        var output = EpaperBitmapV3Writer.Write(rows, 64, 4, 1, 2, BitmapDecoderCapabilities.None);
+
+        Assert.Equal(2, BinaryPrimitives.ReadUInt16LittleEndian(output.AsSpan(12)));
+        Assert.Equal(2, BinaryPrimitives.ReadUInt16LittleEndian(output.AsSpan(14)));
+        Assert.Equal(16u, BinaryPrimitives.ReadUInt32LittleEndian(output.AsSpan(16)));
+        Assert.Equal(rows.AsSpan(16).ToArray(), output.AsSpan(EpaperBitmapV3Writer.HeaderSize).ToArray());
+        // Hash and checksum describe the whole frame
+        Assert.Equal(full.AsSpan(20, 28).ToArray(), output.AsSpan(20, 28).ToArray());
+    }
+
+    [Fact]
+    public void Write_WithPackBitsCapability_EncodesEveryRowSeparately()
+    {
+        var rows = SampleRows();
+
+        var output = EpaperBitmapV3Writer.Write(rows, 64, 4, 1, 0, BitmapDecoderCapabilities.PackBitsRows);
+
+        Assert.Equal(EpaperBitmapV3Writer.EncodingPackBitsRows, output[9]);
+        var payload = output.AsSpan(EpaperBitmapV3Writer.HeaderSize);
+        Assert.Equal((uint)payload.Length, BinaryPrimitives.ReadUInt32LittleEndian(output.AsSpan(16)));
+        Assert.True(payload.Length < rows.Length);
+
+        var decoded = new List<byte>();
+        while (payload.Length > 0)
+        {
+            var length = BinaryPrimitives.ReadUInt16LittleEndian(payload);
+            var row = UnpackBits(payload.Slice(2, length));
+            Assert.Equal(8, row.Length);
+            decoded.AddRange(row);
+            payload = payload[(2 + length)..];
+        }
+        Assert.Equal(rows, decoded.ToArray());
+    }
+
+    [Fact]
+    public void Write_WhenPackBitsDoesNotHelp_SendsRawRows()
+    {
+        var rows = Enumerable.Range(0, 32).Select(i => (byte)i).ToArray();
+
+        var output = EpaperBitmapV3Writer.Write(rows, 64, 4, 1, 0, BitmapDecoderCapabilities.PackBitsRows);
+
+        Assert.Equal(EpaperBitmapV3Writer.EncodingRaw, output[9]);
+        Assert.Equal(rows, output.AsSpan(EpaperBitmapV3Writer.HeaderSize).ToArray());
+    }
+
+    [Fact]
+    public void Write_WithInvalidRowOffset_Throws()
+    {
+        Assert.Throws<ArgumentOutOfRangeException>(() => EpaperBitmapV3Writer.Write(SampleRows(), 64, 4, 1, 4, BitmapDecoderCapabilities.None));
+    }
+
+    [Fact]
+    public void FrameHash_IsFnv1a()
+    {
+        // Known FNV-1a 64 values of "" and "a"
+        Assert.Equal(0xcbf29ce484222325UL, EpaperBitmapV3Writer.FrameHash([], 1));
+        Assert.Equal(0xaf63dc4c8601ec8cUL, EpaperBitmapV3Writer.FrameHash([(byte)'a'], 1));
+    }
+
+    [Theory]
+    [InlineData(new byte[] { 0, 0, 0, 0 }, new byte[] { 0xfd, 0 })]
+    [InlineData(new byte[] { 1, 2, 3 }, new byte[] { 2, 1, 2, 3 })]
+    [InlineData(new byte[] { 1, 2, 2, 2, 2 }, new byte[] { 0, 1, 0xfd, 2 })]
+    public void PackBits_Chunks(byte[] data, byte[] expected)
+    {
+        Assert.Equal(expected, EpaperBitmapV3Writer.PackBits(data));
+    }
+}
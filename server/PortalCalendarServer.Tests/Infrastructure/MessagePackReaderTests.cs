@@ -0,0 +1,76 @@
+using PortalCalendarServer.Infrastructure;
+
+namespace PortalCalendarServer.Tests.Infrastructure;
+
+/// <summary>
+/// Unit tests for the MessagePack decoder used for the device telemetry
+/// </summary>
+public class MessagePackReaderTests
+{
+    [Theory]
+    [InlineData(new byte[] { 0x05 }, 5L)]
+    [InlineData(new byte[] { 0xff }, -1L)]
+    [InlineData(new byte[] { 0xcc, 0xc8 }, 200L)]
+    [InlineData(new byte[] { 0xcd, 0x01, 0x00 }, 256L)]
+    [InlineData(new byte[] { 0xce, 0x00, 0x01, 0x00, 0x00 }, 65536L)]
+    [InlineData(new byte[] { 0xd0, 0xb5 }, -75L)]
+    [InlineData(new byte[] { 0xd1, 0xff, 0x00 }, -256L)]
+    [InlineData(new byte[] { 0xd2, 0xff, 0xff, 0x00, 0x00 }, -65536L)]
+    public void Read_Integers(byte[] data, long expected)
+    {
+        Assert.Equal(expected, MessagePackReader.Read(data));
+    }
+
+    [Fact]
+    public void Read_Floats()
+    {
+        // 3.85f as float32 and 2.5 as float64
+        Assert.Equal(3.85, (double)MessagePackReader.Read(new byte[] { 0xca, 0x40, 0x76, 0x66, 0x66 })!, 5);
+        Assert.Equal(2.5, MessagePackReader.Read(new byte[] { 0xcb, 0x40, 0x04, 0, 0, 0, 0, 0, 0 }));
+    }
+
+    [Fact]
+    public void Read_NilAndBooleans()
+    {
+        Assert.Null(MessagePackReader.Read(new byte[] { 0xc0 }));
+        Assert.Equal(false, MessagePackReader.Read(new byte[] { 0xc2 }));
+        Assert.Equal(true, MessagePackReader.Read(new byte[] { 0xc3 }));
+    }
+
+    [Fact]
+    public void ReadMap_WithNestedValues()
+    {
+        // {"fw": "2.3", "list": [1, "x"], "n": {"a": nil}}
+        var data = new byte[]
+        {
+            0x83,
+            0xa2, (byte)'f', (byte)'w', 0xa3, (byte)'2', (byte)'.', (byte)'3',
+            0xa4, (byte)'l', (byte)'i', (byte)'s', (byte)'t', 0x92, 0x01, 0xa1, (byte)'x',
+            0xa1, (byte)'n', 0x81, 0xa1, (byte)'a', 0xc0
+        };
+
+        var map = MessagePackReader.ReadMap(data);
+
+        Assert.Equal("2.3", map["fw"]);
+        Assert.Equal(new List<object?> { 1L, "x" }, map["list"]);
+        var nested = Assert.IsType<Dictionary<string, object?>>(map["n"]);
+        Assert.Null(nested["a"]);
+    }
+
+    [Theory]
+    [InlineData(new byte[] { })]                       // empty
+    [InlineData(new byte[] { 0xa3, (byte)'a' })]       // truncated string
+    [InlineData(new byte[] { 0x81, 0x01, 0x02 })]      // non-string key
+    [InlineData(new byte[] { 0x01, 0x02 })]            // trailing data
+    [InlineData(new byte[] { 0xc1 })]                  // reserved type
+    public void Read_InvalidData_Throws(byte[] data)
+    {
+        Assert.Throws<FormatException>(() => MessagePackReader.Read(data));
+    }
+
+    [Fact]
+    public void ReadMap_WhenNotAMap_Throws()
+    {
+        Assert.Throws<FormatException>(() => MessagePackReader.ReadMap(new byte[] { 0x90 }));
+    }
+}
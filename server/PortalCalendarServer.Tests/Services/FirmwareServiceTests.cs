@@ -0,0 +1,137 @@
+using Microsoft.Extensions.Caching.Memory;
+using Microsoft.Extensions.Configuration;
+using Microsoft.Extensions.Logging;
+using PortalCalendarServer.Services;
+using System.Buffers.Binary;
+using System.Text;
+
+namespace PortalCalendarServer.Tests.Services;
+
+/// <summary>
+/// Unit tests for FirmwareService
+/// </summary>
+public class FirmwareServiceTests : IDisposable
+{
+    private readonly string _firmwareDirectory;
+    private readonly Mock<IDisplayService> _mockDisplayService = new();
+    private readonly MemoryCache _memoryCache = new(new MemoryCacheOptions { SizeLimit = 1024 * 1024 });
+    private readonly FirmwareService _service;
+
+    public FirmwareServiceTests()
+    {
+        _firmwareDirectory = Path.Combine(Path.GetTempPath(), "firmware-tests-" + Guid.NewGuid().ToString("N"));
+        Directory.CreateDirectory(_firmwareDirectory);
+
+        var configuration = new ConfigurationBuilder()
+            .AddInMemoryCollection(new Dictionary<string, string?> { ["Paths:Firmware"] = _firmwareDirectory })
+            .Build();
+
+        _service = new FirmwareService(
+            new Mock<ILogger<FirmwareService>>().Object,
+            configuration,
+            _mockDisplayService.Object,
+            _memoryCache);
+    }
+
+    public void Dispose()
+    {
+        _memoryCache.Dispose();
+        Directory.Delete(_firmwareDirectory, recursive: true);
+    }
+
+    private static byte[] BuildImage(string version, int size = 256)
+    {
+        var image = new byte[size];
+        image[0] = 0xE9; // esp_image_header_t magic
+        BinaryPrimitives.WriteUInt32LittleEndian(image.AsSpan(32), 0xABCD5432);
+        Encoding.ASCII.GetBytes(version).CopyTo(image, 48);
+        return image;
+    }
+
+    private Display SetupDisplay(string firmware, string? fileName)
+    {
+        var display = new Display { Id = 1, DisplayTypeCode = "BW", ColorVariantCode = "BW", Firmware = firmware };
+        _mockDisplayService.Setup(s => s.GetConfig(display, "firmware_update_file")).Returns(fileName);
+        return display;
+    }
+
+    [Fact]
+    public void ReadAppVersion_WithAppDescriptor_ReturnsVersion()
+    {
+        using var stream = new MemoryStream(BuildImage("2.3.0"));
+        Assert.Equal("2.3.0", FirmwareService.ReadAppVersion(stream));
+    }
+
+    [Fact]
+    public void ReadAppVersion_WithoutAppDescriptor_ReturnsNull()
+    {
+        using var stream = new MemoryStream(new byte[256]);
+        Assert.Null(FirmwareService.ReadAppVersion(stream));
+    }
+
+    [Fact]
+    public void ReadAppVersion_WithTruncatedImage_ReturnsNull()
+    {
+        using var stream = new MemoryStream(BuildImage("2.3.0").Take(40).ToArray());
+        Assert.Null(FirmwareService.ReadAppVersion(stream));
+    }
+
+    [Fact]
+    public void GetPendingUpdate_WithDifferentVersion_ReturnsVersionFromImage()
+    {
+        File.WriteAllBytes(Path.Combine(_firmwareDirectory, "firmware.bin"), BuildImage("2.3.0"));
+        var display = SetupDisplay("2.2.3", "firmware.bin");
+
+        var image = _service.GetPendingUpdate(display);
+
+        Assert.NotNull(image);
+        Assert.Equal("2.3.0", image.Version);
+        Assert.Equal(256, image.Size);
+        Assert.Equal(64, image.Sha256.Length);
+    }
+
+    [Fact]
+    public void GetPendingUpdate_WithSameVersionAsImage_ReturnsNull()
+    {
+        File.WriteAllBytes(Path.Combine(_firmwareDirectory, "firmware.bin"), BuildImage("2.3.0"));
+        var display = SetupDisplay("2.3.0", "firmware.bin");
+
+        Assert.Null(_service.GetPendingUpdate(display));
+    }
+
+    [Fact]
+    public void GetPendingUpdate_WithImageWithoutAppDescriptor_ReturnsNull()
+    {
+        File.WriteAllBytes(Path.Combine(_firmwareDirectory, "firmware.bin"), new byte[256]);
+        var display = SetupDisplay("2.2.3", "firmware.bin");
+
+        Assert.Null(_service.GetPendingUpdate(display));
+    }
+
+    [Fact]
+    public void GetPendingUpdate_WhenImageIsReplaced_HashesTheNewImage()
+    {
+        var imagePath = Path.Combine(_firmwareDirectory, "firmware.bin");
+        File.WriteAllBytes(imagePath, BuildImage("2.3.0"));
+        var display = SetupDisplay("2.2.3", "firmware.bin");
+        var first = _service.GetPendingUpdate(display);
+
+        File.WriteAllBytes(imagePath, BuildImage("2.4.0", size: 512));
+        File.SetLastWriteTimeUtc(imagePath, File.GetLastWriteTimeUtc(imagePath).AddSeconds(1));
+        var second = _service.GetPendingUpdate(display);
+
+        Assert.NotNull(first);
+        Assert.NotNull(second);
+        Assert.Equal("2.4.0", second.Version);
+        Assert.Equal(512, second.Size);
+        Assert.NotEqual(first.Sha256, second.Sha256);
+    }
+
+    [Fact]
+    public void GetPendingUpdate_WithoutConfiguredFile_ReturnsNull()
+    {
+        var display = SetupDisplay("2.2.3", null);
+
+        Assert.Null(_service.GetPendingUpdate(display));
+    }
+}
@@ -1,11 +1,14 @@
 using Microsoft.AspNetCore.Mvc;
 using Microsoft.EntityFrameworkCore;
 using PortalCalendarServer.Data;
+using PortalCalendarServer.Infrastructure;
 using PortalCalendarServer.Models.DatabaseEntities;
 using PortalCalendarServer.Models.POCOs;
 using PortalCalendarServer.Models.POCOs.Bitmap;
 using PortalCalendarServer.Services;
 using PortalCalendarServer.Services.Integrations;
+using System.Globalization;
+using System.Text;
 
 namespace PortalCalendarServer.Controllers;
 
@@ -22,6 +25,7 @@ public class ApiController : ControllerBase
     private readonly PageGeneratorService _pageGeneratorService;
     private readonly ThemeService _themeService;
     private readonly IMqttService _mqttService;
+    private readonly IFirmwareService _firmwareService;
 
     public ApiController(
         CalendarContext context,
@@ -30,7 +34,8 @@ public class ApiController : ControllerBase
         PageGeneratorService pageGeneratorService,
         ThemeService themeService,
         IWeb2PngService web2PngService,
-        IMqttService mqttService)
+        IMqttService mqttService,
+        IFirmwareService firmwareService)
     {
         _context = context;
         _logger = logger;
@@ -38,6 +43,7 @@ public class ApiController : ControllerBase
         _pageGeneratorService = pageGeneratorService;
         _themeService = themeService;
         _mqttService = mqttService;
+        _firmwareService = firmwareService;
     }
 
     // Helper to get display by MAC address
@@ -62,6 +68,12 @@ public class ApiController : ControllerBase
         return display;
     }
 
+    // Wakeup times are in UTC even if the kind is not set
+    private static long ToUnixTime(DateTime utc)
+    {
+        return new DateTimeOffset(DateTime.SpecifyKind(utc, DateTimeKind.Utc)).ToUnixTimeSeconds();
+    }
+
     // GET /api/ping
     [HttpGet("ping")]
     [Tags("Health Checks")]
@@ -113,12 +125,79 @@ public class ApiController : ControllerBase
     [FromQuery] string? reset,
     [FromQuery] string? wakeup)
     {
+        return await HandleConfigAsync(new DeviceTelemetry
+        {
+            Mac = mac,
+            Firmware = fw,
+            Width = w,
+            Height = h,
+            ColorType = c,
+            Rotation = rotation,
+            VoltageRaw = voltage_raw,
+            Voltage = v,
+            MinVoltage = vmin,
+            MaxVoltage = vmax,
+            MinLinearVoltage = vlmin,
+            MaxLinearVoltage = vlmax,
+            ResetReason = reset,
+            WakeupReason = wakeup
+        });
+    }
+
+    // Devices send ~200 bytes, anything much larger is not a telemetry payload
+    private const int MaxTelemetrySize = 4096;
+
+    // POST /api/device/config
+    //
+    // Same as the GET variant, but the telemetry is a MessagePack map in the request body (see DeviceTelemetry for the keys).
+    // The static fields are only included after a reset of the device or when the previous response asked for them.
+    [HttpPost("device/config")]
+    [Tags("Device API")]
+    public async Task<IActionResult> ConfigBinary()
+    {
+        using var body = new MemoryStream();
+        var buffer = new byte[1024];
+        int read;
+        while ((read = await Request.Body.ReadAsync(buffer)) > 0)
+        {
+            if (body.Length + read > MaxTelemetrySize)
+            {
+                return BadRequest(new { error = "Telemetry payload too large" });
+            }
+            body.Write(buffer, 0, read);
+        }
+
+        DeviceTelemetry telemetry;
+        try
+        {
+            telemetry = DeviceTelemetry.FromMap(MessagePackReader.ReadMap(body.ToArray()));
+        }
+        catch (FormatException ex)
+        {
+            _logger.LogWarning("Invalid telemetry payload: {Message}", ex.Message);
+            return BadRequest(new { error = $"Invalid telemetry payload: {ex.Message}" });
+        }
+
+        if (telemetry.Version < 1)
+        {
+            return BadRequest(new { error = $"Unsupported telemetry version {telemetry.Version}" });
+        }
+
+        return await HandleConfigAsync(telemetry);
+    }
+
+    private async Task<IActionResult> HandleConfigAsync(DeviceTelemetry telemetry)
+    {
+        var mac = telemetry.Mac;
+        var fw = telemetry.Firmware;
+        var c = telemetry.ColorType;
         if (string.IsNullOrWhiteSpace(mac))
         {
             return BadRequest(new { error = "MAC address is required" });
         }
 
         var display = await GetDisplayByMacAsync(mac);
+        var resendStatic = false;
 
         if (display == null)
         {
@@ -138,12 +217,12 @@ public class ApiController : ControllerBase
             {
                 Mac = mac.ToLowerInvariant(),
                 Name = $"New display with MAC {mac.ToUpperInvariant()}",
-                Width = w ?? 800,
-                Height = h ?? 480,
+                Width = telemetry.Width ?? 800,
+                Height = telemetry.Height ?? 480,
                 DisplayTypeCode = displayType.Code,
                 ColorVariantCode = defaultColorVariant.Code,
                 Firmware = fw ?? string.Empty,
-                Rotation = (DisplayRotation)(rotation ?? (int)DisplayRotation.None),
+                Rotation = (DisplayRotation)(telemetry.Rotation ?? (int)DisplayRotation.None),
                 Gamma = 2.2,
                 BorderTop = 0,
                 BorderRight = 0,
@@ -157,6 +236,9 @@ public class ApiController : ControllerBase
 
             _logger.LogInformation("New display created with MAC {Mac}, ID: {Id}", mac, display.Id);
 
+            // Created with default dimensions, the device has to send the real ones next time
+            resendStatic = !telemetry.HasStaticFields;
+
             // Generate the bitmap NOW so that it's available immediately on the first config request.
             try
             {
@@ -178,6 +260,11 @@ public class ApiController : ControllerBase
             {
                 display.DisplayTypeCode = c;
             }
+            if (telemetry.HasStaticFields)
+            {
+                display.Width = telemetry.Width!.Value;
+                display.Height = telemetry.Height!.Value;
+            }
             _context.Update(display);
             await _context.SaveChangesAsync();
         }
@@ -238,14 +325,38 @@ public class ApiController : ControllerBase
         }
 
         // Store voltage and diagnostic data
-        _displayService.SetConfig(display, "_last_voltage_raw", voltage_raw ?? string.Empty);
-        _displayService.SetConfig(display, "_last_voltage", v ?? string.Empty);
-        _displayService.SetConfig(display, "_min_voltage", vmin ?? string.Empty);
-        _displayService.SetConfig(display, "_max_voltage", vmax ?? string.Empty);
-        _displayService.SetConfig(display, "_min_linear_voltage", vlmin ?? string.Empty);
-        _displayService.SetConfig(display, "_max_linear_voltage", vlmax ?? string.Empty);
-        _displayService.SetConfig(display, "_reset_reason", reset ?? string.Empty);
-        _displayService.SetConfig(display, "_wakeup_reason", wakeup ?? string.Empty);
+        _displayService.SetConfig(display, "_last_voltage_raw", telemetry.VoltageRaw ?? string.Empty);
+        _displayService.SetConfig(display, "_last_voltage", telemetry.Voltage ?? string.Empty);
+        // The binary payload skips the voltage curve unless it has changed, keep the stored one then
+        if (telemetry.Version == 0 || telemetry.HasStaticFields)
+        {
+            _displayService.SetConfig(display, "_min_voltage", telemetry.MinVoltage ?? string.Empty);
+            _displayService.SetConfig(display, "_max_voltage", telemetry.MaxVoltage ?? string.Empty);
+            _displayService.SetConfig(display, "_min_linear_voltage", telemetry.MinLinearVoltage ?? string.Empty);
+            _displayService.SetConfig(display, "_max_linear_voltage", telemetry.MaxLinearVoltage ?? string.Empty);
+        }
+        _displayService.SetConfig(display, "_reset_reason", telemetry.ResetReason ?? string.Empty);
+        _displayService.SetConfig(display, "_wakeup_reason", telemetry.WakeupReason ?? string.Empty);
+        if (telemetry.Version > 0)
+        {
+            _displayService.SetConfig(display, "_last_rssi", telemetry.WifiRssi?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_free_heap", telemetry.FreeHeap?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_min_free_heap", telemetry.MinFreeHeap?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_wifi_connect_ms", telemetry.WifiConnectMs?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_awake_ms", telemetry.AwakeMs?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_battery_days_remaining",
+                telemetry.BatteryDaysRemaining.HasValue ? Math.Round(telemetry.BatteryDaysRemaining.Value, 1).ToString(CultureInfo.InvariantCulture) : string.Empty);
+            _displayService.SetConfig(display, "_battery_policy", telemetry.BatteryPolicy?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_sleep_factor", telemetry.SleepFactor?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_wake_min_free_heap", telemetry.WakeMinFreeHeap?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_wake_min_largest_block", telemetry.WakeMinLargestBlock?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_wake_min_free_psram", telemetry.WakeMinFreePsram?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_wake_min_loop_stack", telemetry.WakeMinLoopStack?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_wake_min_tcpip_stack", telemetry.WakeMinTcpipStack?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_tls_handshakes", telemetry.TlsHandshakes?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_tls_resumed", telemetry.TlsResumed?.ToString() ?? string.Empty);
+            _displayService.SetConfig(display, "_tls_handshake_ms", telemetry.TlsHandshakeMs?.ToString() ?? string.Empty);
+        }
         await _context.SaveChangesAsync();
 
         // Calculate next wakeup time
@@ -266,27 +377,62 @@ public class ApiController : ControllerBase
         await _mqttService.PublishSensorAsync(display, "sleep_time", wakeupInfo.SleepInSeconds, true);
         await _mqttService.PublishSensorAsync(display, "reset_reason", _displayService.GetConfig(display, "_reset_reason"), true);
         await _mqttService.PublishSensorAsync(display, "wakeup_reason", _displayService.GetConfig(display, "_wakeup_reason"), true);
+        if (telemetry.WifiRssi.HasValue)
+        {
+            await _mqttService.PublishSensorAsync(display, "wifi_rssi", telemetry.WifiRssi.Value, true);
+        }
+        if (telemetry.BatteryDaysRemaining.HasValue)
+        {
+            await _mqttService.PublishSensorAsync(display, "battery_days_remaining", Math.Round(telemetry.BatteryDaysRemaining.Value, 1), true);
+        }
 
         // Final message (workaround for wakeup_reason not being updated)
         await _mqttService.PublishSensorAsync(display, "last_visit", DateTime.UtcNow.ToString("O"));
         await _mqttService.DisconnectAsync();
 
+        // Pull OTA: the device downloads the image during this wakeup if the version differs from its own
+        var firmwareUpdate = _firmwareService.GetPendingUpdate(display);
+        if (firmwareUpdate != null)
+        {
+            _logger.LogInformation("Offering firmware {Version} to display {DisplayId} (running {Firmware})",
+                firmwareUpdate.Version, display.Id, display.Firmware);
+        }
+
         var response = new
         {
             sleep = wakeupInfo.SleepInSeconds,
             battery_percent = _displayService.GetBatteryPercent(display),
-            ota_mode = _displayService.GetConfigBool(display, "ota_mode")
+            ota_mode = _displayService.GetConfigBool(display, "ota_mode"),
+            now = DateTimeOffset.UtcNow.ToUnixTimeSeconds(),
+            // Absolute wakeup time (aligned to the next content change if known), the device computes its sleep from it and "now"
+            next_change = ToUnixTime(wakeupInfo.NextWakeup),
+            schedule = Math.Max(0, _displayService.GetConfigInt(display, "frame_schedule_count") ?? 0),
+            resend_static = resendStatic,
+            // Refresh mode scheduling: fast refreshes in a row (null = firmware default) and when to clean the ghosting
+            max_fast_refreshes = _displayService.GetConfigInt(display, "max_fast_refreshes"),
+            clean_refresh_at = ToUnixTime(_displayService.GetNextCleanRefreshTime(display)),
+            firmware = firmwareUpdate == null ? null : new
+            {
+                version = firmwareUpdate.Version,
+                size = firmwareUpdate.Size,
+                sha256 = firmwareUpdate.Sha256
+            }
         };
 
         return Ok(response);
     }
 
-    // GET /api/device/bitmap/epaper?mac=XX:XX:XX:XX:XX:XX[&fmt=1]
+    // GET /api/device/bitmap/epaper?mac=XX:XX:XX:XX:XX:XX[&fmt=1][&row=N][&caps=N]
+    //
+    // fmt=3 starts with a binary header describing the frame, its rows are encoded with the smallest of the decoders
+    // announced in "caps" (see EpaperBitmapV3Writer).
     [HttpGet("device/bitmap/epaper")]
     [Tags("Device API")]
     public async Task<IActionResult> BitmapEpaper(
         [FromQuery] string? mac,
-        [FromQuery] int fmt = 1
+        [FromQuery] int fmt = 1,
+        [FromQuery] int row = 0,
+        [FromQuery] int caps = 0
         )
     {
         var display = await GetDisplayByMacAsync(mac);
@@ -295,6 +441,12 @@ public class ApiController : ControllerBase
             return NotFound(new { error = "Display not found" });
         }
 
+        // Row offset is used by the client to resume an interrupted download, only the v2 and v3 formats support it
+        if (row < 0 || (row > 0 && fmt != 2 && fmt != 3))
+        {
+            return BadRequest(new { error = $"Invalid row offset {row} for format {fmt}" });
+        }
+
         // UI:
         // FIXME 
         //var bitmap = _bitmapService.GetStoredBitmap(
@@ -307,12 +459,29 @@ public class ApiController : ControllerBase
         //}
 
         // API:
-        var bitmap = _displayService.ConvertExistingRawBitmap(
-            displayId: display.Id,
-            format: fmt == 2 ? OutputFormat.EpaperSpecificV2 : OutputFormat.EpaperSpecificV1,
-            rotate: null,
-            flip: null
-            );
+        BitmapResult bitmap;
+        try
+        {
+            bitmap = _displayService.ConvertExistingRawBitmap(
+                displayId: display.Id,
+                format: fmt switch
+                {
+                    3 => OutputFormat.EpaperSpecificV3,
+                    2 => OutputFormat.EpaperSpecificV2,
+                    _ => OutputFormat.EpaperSpecificV1
+                },
+                rotate: null,
+                flip: null,
+                firstRow: row,
+                capabilities: (BitmapDecoderCapabilities)caps
+                );
+        }
+        catch (ArgumentOutOfRangeException ex)
+        {
+            // Row offset beyond the last row, the bitmap height is only known once it's loaded
+            _logger.LogWarning("Invalid bitmap request: {Message}", ex.Message);
+            return BadRequest(new { error = $"Invalid row offset {row}: {ex.Message}" });
+        }
 
         if (bitmap.ErrorMessage != null)
         {
@@ -321,5 +490,108 @@ public class ApiController : ControllerBase
 
         return this.ReturnBitmap(bitmap);
     }
-}
 
+    // GET /api/device/firmware?mac=XX:XX:XX:XX:XX:XX
+    //
+    // zlib-compressed firmware image advertised in the "firmware" part of the config response. The device inflates it
+    // straight into its inactive OTA partition and checks the SHA-256 of the uncompressed image before switching to it.
+    [HttpGet("device/firmware")]
+    [Tags("Device API")]
+    public async Task<IActionResult> Firmware([FromQuery] string? mac)
+    {
+        var display = await GetDisplayByMacAsync(mac);
+        if (display == null)
+        {
+            return NotFound(new { error = "Display not found" });
+        }
+
+        var firmwareUpdate = _firmwareService.GetPendingUpdate(display);
+        if (firmwareUpdate == null)
+        {
+            return NotFound(new { error = "No firmware update available" });
+        }
+
+        _logger.LogInformation("Sending firmware {Version} to display {DisplayId}", firmwareUpdate.Version, display.Id);
+        return PhysicalFile(_firmwareService.GetCompressedImagePath(firmwareUpdate), "application/zlib");
+    }
+
+    // GET /api/device/bitmap/schedule?mac=XX:XX:XX:XX:XX:XX&count=N
+    //
+    // Bundle of frames for the next N scheduled wakeups, so that the device can show them without connecting to WiFi.
+    // Output format: "MS\n" + "<frame count> <valid until>\n" + for each frame: "<display at>\n" + a complete v2 bitmap
+    // ("MM\n" + checksum + "\n" + bitmap data). Timestamps are unix epoch seconds. After "valid until" the device must
+    // connect to the server again.
+    [HttpGet("device/bitmap/schedule")]
+    [Tags("Device API")]
+    public async Task<IActionResult> BitmapSchedule(
+        [FromQuery] string? mac,
+        [FromQuery] int count = 0
+        )
+    {
+        var display = await GetDisplayByMacAsync(mac);
+        if (display == null)
+        {
+            return NotFound(new { error = "Display not found" });
+        }
+
+        if (count < 0)
+        {
+            return BadRequest(new { error = $"Invalid frame count {count}" });
+        }
+
+        // The server decides how many frames it is willing to render, the device can only ask for less
+        count = Math.Min(count, Math.Max(0, _displayService.GetConfigInt(display, "frame_schedule_count") ?? 0));
+
+        var frames = new List<(DateTime DisplayAt, byte[] Data)>();
+        var wakeupInfo = _displayService.GetNextWakeupTime(display);
+        while (frames.Count < count)
+        {
+            var displayAt = wakeupInfo.NextWakeup;
+            try
+            {
+                var imagePath = await _pageGeneratorService.GenerateScheduledImageAsync(display, displayAt);
+                var bitmap = _displayService.ConvertScheduledWebSnapshot(display.Id, imagePath);
+                if (bitmap.ErrorMessage != null)
+                {
+                    _logger.LogWarning("Scheduled frame for {DisplayAt} of display {DisplayId} not available: {Error}",
+                        displayAt.ToString("O"), display.Id, bitmap.ErrorMessage);
+                    break;
+                }
+                frames.Add((displayAt, bitmap.Data));
+            }
+            catch (Exception ex)
+            {
+                // Send what we have, the device will fetch the rest on its next connection
+                _logger.LogError(ex, "Failed to generate scheduled frame for {DisplayAt} of display {DisplayId}",
+                    displayAt.ToString("O"), display.Id);
+                break;
+            }
+
+            wakeupInfo = _displayService.GetNextWakeupTime(display, displayAt);
+        }
+
+        // Either the wakeup following the last frame or the one whose frame failed to render
+        var validUntil = wakeupInfo.NextWakeup;
+
+        using var ms = new MemoryStream();
+        ms.Write(Encoding.ASCII.GetBytes($"MS\n{frames.Count} {ToUnixTime(validUntil)}\n"));
+        foreach (var frame in frames)
+        {
+            ms.Write(Encoding.ASCII.GetBytes($"{ToUnixTime(frame.DisplayAt)}\n"));
+            ms.Write(frame.Data);
+        }
+
+        _logger.LogInformation("Sending {Count} scheduled frames to display {DisplayId}, valid until {ValidUntil}",
+            frames.Count, display.Id, validUntil.ToString("O"));
+
+        return this.ReturnBitmap(new BitmapResult
+        {
+            Data = ms.ToArray(),
+            ContentType = "application/octet-stream",
+            Headers = new Dictionary<string, string>
+            {
+                ["Content-Transfer-Encoding"] = "binary"
+            }
+        });
+    }
+}
@@ -3,5 +3,6 @@ namespace PortalCalendarServer.Controllers
     public class Constants
     {
         public const string CalendarHtmlDefaultDate = "CalendarHtmlDefaultDate";
+        public const string CalendarHtmlSpecificDate = "CalendarHtmlSpecificDate";
     }
 }
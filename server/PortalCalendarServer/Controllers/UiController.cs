@@ -111,7 +111,7 @@ public class UiController(
     }
 
     // GET /calendar/{displayNumber:int}/html/{date}
-    [HttpGet("/calendar/{displayNumber:int}/html/{date}")]
+    [HttpGet("/calendar/{displayNumber:int}/html/{date}", Name = Constants.CalendarHtmlSpecificDate)]
     [Authorize("CookiesOrInternalToken")]
     [DisplayRenderErrorHandling]
     public IActionResult CalendarHtmlSpecificDate(int displayNumber, DateTime date, [FromQuery] bool preview_colors = false, [FromQuery] string? force_error = null)
@@ -229,7 +229,9 @@ public partial class CalendarContext : DbContext
                 new EpdColor { Code = "yellow", Name = "Yellow", HexValue = "FFFF00", EpdPreviewHexValue = "c0a010" },
                 new EpdColor { Code = "blue", Name = "Blue", HexValue = "0000FF", EpdPreviewHexValue = "5080b8" },
                 new EpdColor { Code = "green", Name = "Green", HexValue = "00FF00", EpdPreviewHexValue = "608050" },
-                new EpdColor { Code = "orange", Name = "Orange", HexValue = "FFA500", EpdPreviewHexValue = "cc8400" }
+                new EpdColor { Code = "orange", Name = "Orange", HexValue = "FFA500", EpdPreviewHexValue = "cc8400" },
+                new EpdColor { Code = "lightgrey", Name = "Light Grey", HexValue = "AAAAAA", EpdPreviewHexValue = "a0a0a0" },
+                new EpdColor { Code = "darkgrey", Name = "Dark Grey", HexValue = "555555", EpdPreviewHexValue = "505050" }
              );
         });
 
@@ -258,9 +260,11 @@ public partial class CalendarContext : DbContext
 
             entity.HasData(
                 new DisplayType { Code = "BW", Name = "Black and White", NumColors = 2, SortOrder = 100 },
+                new DisplayType { Code = "4G", Name = "4 Grayscale Levels", NumColors = 4, SortOrder = 150 },
                 new DisplayType { Code = "3C", Name = "3 Colors", NumColors = 3, SortOrder = 200 },
                 new DisplayType { Code = "4C", Name = "4 Colors", NumColors = 4, SortOrder = 300 },
-                new DisplayType { Code = "6C", Name = "6 Colors", NumColors = 6, SortOrder = 400 }
+                new DisplayType { Code = "6C", Name = "6 Colors", NumColors = 6, SortOrder = 400 },
+                new DisplayType { Code = "7C", Name = "7 Colors", NumColors = 7, SortOrder = 500 }
              );
         });
 
@@ -299,10 +303,12 @@ public partial class CalendarContext : DbContext
 
             entity.HasData(
                 new ColorVariant { Code = "BW", Name = "Black and White", DisplayTypeCode = "BW", SortOrder = 1000 },
+                new ColorVariant { Code = "Gray4", Name = "4 Grayscale Levels", DisplayTypeCode = "4G", SortOrder = 1500 },
                 new ColorVariant { Code = "BWY", Name = "Black, White, Yellow", DisplayTypeCode = "3C", SortOrder = 2000 },
                 new ColorVariant { Code = "BWR", Name = "Black, White, Red", DisplayTypeCode = "3C", SortOrder = 2010 },
                 new ColorVariant { Code = "BWRY", Name = "Black, White, Red, Yellow", DisplayTypeCode = "4C", SortOrder = 3000 },
-                new ColorVariant { Code = "SpectraE6", Name = "Spectra E6 (Black, White, Red, Yellow, Blue, Green)", DisplayTypeCode = "6C", SortOrder = 4000 }
+                new ColorVariant { Code = "SpectraE6", Name = "Spectra E6 (Black, White, Red, Yellow, Blue, Green)", DisplayTypeCode = "6C", SortOrder = 4000 },
+                new ColorVariant { Code = "ACeP7", Name = "ACeP (Black, White, Green, Blue, Red, Yellow, Orange)", DisplayTypeCode = "7C", SortOrder = 5000 }
              );
         });
 
@@ -344,7 +350,20 @@ public partial class CalendarContext : DbContext
                 new ColorPaletteLink { Id = 15, ColorVariantCode = "SpectraE6", EpdColorCode = "red" },
                 new ColorPaletteLink { Id = 16, ColorVariantCode = "SpectraE6", EpdColorCode = "yellow" },
                 new ColorPaletteLink { Id = 17, ColorVariantCode = "SpectraE6", EpdColorCode = "blue" },
-                new ColorPaletteLink { Id = 18, ColorVariantCode = "SpectraE6", EpdColorCode = "green" }
+                new ColorPaletteLink { Id = 18, ColorVariantCode = "SpectraE6", EpdColorCode = "green" },
+
+                new ColorPaletteLink { Id = 19, ColorVariantCode = "Gray4", EpdColorCode = "black" },
+                new ColorPaletteLink { Id = 20, ColorVariantCode = "Gray4", EpdColorCode = "white" },
+                new ColorPaletteLink { Id = 21, ColorVariantCode = "Gray4", EpdColorCode = "lightgrey" },
+                new ColorPaletteLink { Id = 22, ColorVariantCode = "Gray4", EpdColorCode = "darkgrey" },
+
+                new ColorPaletteLink { Id = 23, ColorVariantCode = "ACeP7", EpdColorCode = "black" },
+                new ColorPaletteLink { Id = 24, ColorVariantCode = "ACeP7", EpdColorCode = "white" },
+                new ColorPaletteLink { Id = 25, ColorVariantCode = "ACeP7", EpdColorCode = "green" },
+                new ColorPaletteLink { Id = 26, ColorVariantCode = "ACeP7", EpdColorCode = "blue" },
+                new ColorPaletteLink { Id = 27, ColorVariantCode = "ACeP7", EpdColorCode = "red" },
+                new ColorPaletteLink { Id = 28, ColorVariantCode = "ACeP7", EpdColorCode = "yellow" },
+                new ColorPaletteLink { Id = 29, ColorVariantCode = "ACeP7", EpdColorCode = "orange" }
             );
         });
 
@@ -0,0 +1,90 @@
+﻿using Microsoft.EntityFrameworkCore.Migrations;
+
+#nullable disable
+
+#pragma warning disable CA1814 // Prefer jagged arrays over multidimensional
+
+namespace PortalCalendarServer.Migrations
+{
+    /// <inheritdoc />
+    public partial class AddGrayscaleDisplayType : Migration
+    {
+        /// <inheritdoc />
+        protected override void Up(MigrationBuilder migrationBuilder)
+        {
+            migrationBuilder.InsertData(
+                table: "display_types",
+                columns: new[] { "code", "name", "num_colors", "sort_order" },
+                values: new object[] { "4G", "4 Grayscale Levels", 4, 150 });
+
+            migrationBuilder.InsertData(
+                table: "epd_colors",
+                columns: new[] { "code", "epd_preview_hex_value", "hex_value", "name" },
+                values: new object[,]
+                {
+                    { "darkgrey", "505050", "555555", "Dark Grey" },
+                    { "lightgrey", "a0a0a0", "AAAAAA", "Light Grey" }
+                });
+
+            migrationBuilder.InsertData(
+                table: "color_variants",
+                columns: new[] { "Code", "display_type_code", "name", "sort_order" },
+                values: new object[] { "Gray4", "4G", "4 Grayscale Levels", 1500 });
+
+            migrationBuilder.InsertData(
+                table: "color_palette_links",
+                columns: new[] { "id", "color_variant_code", "epd_color_code" },
+                values: new object[,]
+                {
+                    { 19, "Gray4", "black" },
+                    { 20, "Gray4", "white" },
+                    { 21, "Gray4", "lightgrey" },
+                    { 22, "Gray4", "darkgrey" }
+                });
+        }
+
+        /// <inheritdoc />
+        protected override void Down(MigrationBuilder migrationBuilder)
+        {
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 19);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 20);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 21);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 22);
+
+            migrationBuilder.DeleteData(
+                table: "color_variants",
+                keyColumn: "Code",
+                keyValue: "Gray4");
+
+            migrationBuilder.DeleteData(
+                table: "epd_colors",
+                keyColumn: "code",
+                keyValue: "darkgrey");
+
+            migrationBuilder.DeleteData(
+                table: "epd_colors",
+                keyColumn: "code",
+                keyValue: "lightgrey");
+
+            migrationBuilder.DeleteData(
+                table: "display_types",
+                keyColumn: "code",
+                keyValue: "4G");
+        }
+    }
+}
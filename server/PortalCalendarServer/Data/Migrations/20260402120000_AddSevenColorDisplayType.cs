@@ -0,0 +1,89 @@
+﻿using Microsoft.EntityFrameworkCore.Migrations;
+
+#nullable disable
+
+#pragma warning disable CA1814 // Prefer jagged arrays over multidimensional
+
+namespace PortalCalendarServer.Migrations
+{
+    /// <inheritdoc />
+    public partial class AddSevenColorDisplayType : Migration
+    {
+        /// <inheritdoc />
+        protected override void Up(MigrationBuilder migrationBuilder)
+        {
+            migrationBuilder.InsertData(
+                table: "display_types",
+                columns: new[] { "code", "name", "num_colors", "sort_order" },
+                values: new object[] { "7C", "7 Colors", 7, 500 });
+
+            migrationBuilder.InsertData(
+                table: "color_variants",
+                columns: new[] { "Code", "display_type_code", "name", "sort_order" },
+                values: new object[] { "ACeP7", "7C", "ACeP (Black, White, Green, Blue, Red, Yellow, Orange)", 5000 });
+
+            migrationBuilder.InsertData(
+                table: "color_palette_links",
+                columns: new[] { "id", "color_variant_code", "epd_color_code" },
+                values: new object[,]
+                {
+                    { 23, "ACeP7", "black" },
+                    { 24, "ACeP7", "white" },
+                    { 25, "ACeP7", "green" },
+                    { 26, "ACeP7", "blue" },
+                    { 27, "ACeP7", "red" },
+                    { 28, "ACeP7", "yellow" },
+                    { 29, "ACeP7", "orange" }
+                });
+        }
+
+        /// <inheritdoc />
+        protected override void Down(MigrationBuilder migrationBuilder)
+        {
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 23);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 24);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 25);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 26);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 27);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 28);
+
+            migrationBuilder.DeleteData(
+                table: "color_palette_links",
+                keyColumn: "id",
+                keyValue: 29);
+
+            migrationBuilder.DeleteData(
+                table: "color_variants",
+                keyColumn: "Code",
+                keyValue: "ACeP7");
+
+            migrationBuilder.DeleteData(
+                table: "display_types",
+                keyColumn: "code",
+                keyValue: "7C");
+        }
+    }
+}
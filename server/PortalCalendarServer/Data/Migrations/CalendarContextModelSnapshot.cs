@@ -219,6 +219,72 @@ namespace PortalCalendarServer.Migrations
                             Id = 18,
                             ColorVariantCode = "SpectraE6",
                             EpdColorCode = "green"
+                        },
+                        new
+                        {
+                            Id = 19,
+                            ColorVariantCode = "Gray4",
+                            EpdColorCode = "black"
+                        },
+                        new
+                        {
+                            Id = 20,
+                            ColorVariantCode = "Gray4",
+                            EpdColorCode = "white"
+                        },
+                        new
+                        {
+                            Id = 21,
+                            ColorVariantCode = "Gray4",
+                            EpdColorCode = "lightgrey"
+                        },
+                        new
+                        {
+                            Id = 22,
+                            ColorVariantCode = "Gray4",
+                            EpdColorCode = "darkgrey"
+                        },
+                        new
+                        {
+                            Id = 23,
+                            ColorVariantCode = "ACeP7",
+                            EpdColorCode = "black"
+                        },
+                        new
+                        {
+                            Id = 24,
+                            ColorVariantCode = "ACeP7",
+                            EpdColorCode = "white"
+                        },
+                        new
+                        {
+                            Id = 25,
+                            ColorVariantCode = "ACeP7",
+                            EpdColorCode = "green"
+                        },
+                        new
+                        {
+                            Id = 26,
+                            ColorVariantCode = "ACeP7",
+                            EpdColorCode = "blue"
+                        },
+                        new
+                        {
+                            Id = 27,
+                            ColorVariantCode = "ACeP7",
+                            EpdColorCode = "red"
+                        },
+                        new
+                        {
+                            Id = 28,
+                            ColorVariantCode = "ACeP7",
+                            EpdColorCode = "yellow"
+                        },
+                        new
+                        {
+                            Id = 29,
+                            ColorVariantCode = "ACeP7",
+                            EpdColorCode = "orange"
                         });
                 });
 
@@ -283,6 +349,20 @@ namespace PortalCalendarServer.Migrations
                             DisplayTypeCode = "6C",
                             Name = "Spectra E6 (Black, White, Red, Yellow, Blue, Green)",
                             SortOrder = 4000
+                        },
+                        new
+                        {
+                            Code = "Gray4",
+                            DisplayTypeCode = "4G",
+                            Name = "4 Grayscale Levels",
+                            SortOrder = 1500
+                        },
+                        new
+                        {
+                            Code = "ACeP7",
+                            DisplayTypeCode = "7C",
+                            Name = "ACeP (Black, White, Green, Blue, Red, Yellow, Orange)",
+                            SortOrder = 5000
                         });
                 });
 
@@ -466,6 +546,20 @@ namespace PortalCalendarServer.Migrations
                             Name = "6 Colors",
                             NumColors = 6,
                             SortOrder = 400
+                        },
+                        new
+                        {
+                            Code = "4G",
+                            Name = "4 Grayscale Levels",
+                            NumColors = 4,
+                            SortOrder = 150
+                        },
+                        new
+                        {
+                            Code = "7C",
+                            Name = "7 Colors",
+                            NumColors = 7,
+                            SortOrder = 500
                         });
                 });
 
@@ -598,6 +692,20 @@ namespace PortalCalendarServer.Migrations
                             EpdPreviewHexValue = "cc8400",
                             HexValue = "FFA500",
                             Name = "Orange"
+                        },
+                        new
+                        {
+                            Code = "lightgrey",
+                            EpdPreviewHexValue = "a0a0a0",
+                            HexValue = "AAAAAA",
+                            Name = "Light Grey"
+                        },
+                        new
+                        {
+                            Code = "darkgrey",
+                            EpdPreviewHexValue = "505050",
+                            HexValue = "555555",
+                            Name = "Dark Grey"
                         });
                 });
 
@@ -0,0 +1,150 @@
+using System.Buffers.Binary;
+using System.Security.Cryptography;
+using PortalCalendarServer.Models.POCOs.Bitmap;
+
+namespace PortalCalendarServer.Infrastructure;
+
+/// <summary>
+/// Builds the v3 ("fmt=3") e-paper bitmap: a fixed binary header which lets the device validate the frame before the
+/// first row arrives, followed by the rows in the smallest encoding the device can decode.
+/// The layout is shared with the firmware, see client/include/device_protocol.h.
+/// </summary>
+public static class EpaperBitmapV3Writer
+{
+    public const byte Version = 3;
+    public const int HeaderSize = 48;
+
+    public const byte EncodingRaw = 0;
+    /// <summary>
+    /// Every row as a little-endian uint16 length followed by the PackBits-encoded row.
+    /// </summary>
+    public const byte EncodingPackBitsRows = 1;
+
+    private const ulong FnvOffsetBasis = 0xcbf29ce484222325UL;
+    private const ulong FnvPrime = 0x100000001b3UL;
+
+    /// <summary>
+    /// Encodes <paramref name="rows"/> (the EpaperSpecificV2 row data of the whole frame) from <paramref name="firstRow"/> on.
+    /// The checksum and the frame hash always cover the whole frame.
+    /// </summary>
+    public static byte[] Write(byte[] rows, int width, int height, int bitsPerPixel, int firstRow, BitmapDecoderCapabilities capabilities)
+    {
+        if (height <= 0 || rows.Length % height != 0)
+        {
+            throw new ArgumentException($"Bitmap data of {rows.Length} bytes doesn't split into {height} rows");
+        }
+        if (firstRow < 0 || firstRow >= height)
+        {
+            throw new ArgumentOutOfRangeException(nameof(firstRow), $"First row {firstRow} is outside of the bitmap (0..{height - 1})");
+        }
+        var rowBytes = rows.Length / height;
+
+        var encoding = EncodingRaw;
+        var payload = rows.AsSpan(firstRow * rowBytes).ToArray();
+        if (capabilities.HasFlag(BitmapDecoderCapabilities.PackBitsRows))
+        {
+            var packed = PackRows(rows, rowBytes, firstRow, height);
+            if (packed.Length < payload.Length)
+            {
+                encoding = EncodingPackBitsRows;
+                payload = packed;
+            }
+        }
+
+        var output = new byte[HeaderSize + payload.Length];
+        var header = output.AsSpan(0, HeaderSize);
+        header[0] = (byte)'M';
+        header[1] = (byte)'M';
+        header[2] = Version;
+        header[3] = HeaderSize;
+        BinaryPrimitives.WriteUInt16LittleEndian(header[4..], (ushort)width);
+        BinaryPrimitives.WriteUInt16LittleEndian(header[6..], (ushort)height);
+        header[8] = (byte)bitsPerPixel;
+        header[9] = encoding;
+        BinaryPrimitives.WriteUInt16LittleEndian(header[12..], (ushort)firstRow);
+        BinaryPrimitives.WriteUInt16LittleEndian(header[14..], (ushort)(height - firstRow));
+        BinaryPrimitives.WriteUInt32LittleEndian(header[16..], (uint)payload.Length);
+        BinaryPrimitives.WriteUInt64LittleEndian(header[20..], FrameHash(rows, rowBytes));
+        SHA1.HashData(rows).CopyTo(header[28..]);
+        payload.CopyTo(output, HeaderSize);
+
+        return output;
+    }
+
+    /// <summary>
+    /// 64-bit FNV-1a of the rows, the same value as frameHashAddRow() of the firmware (which never lets it be 0 after a row,
+    /// 0 means an unknown panel content there).
+    /// </summary>
+    public static ulong FrameHash(byte[] rows, int rowBytes)
+    {
+        var hash = FnvOffsetBasis;
+        for (var start = 0; start < rows.Length; start += rowBytes)
+        {
+            for (var i = start; i < start + rowBytes; i++)
+            {
+                hash ^= rows[i];
+                hash *= FnvPrime;
+            }
+            if (hash == 0)
+            {
+                hash = FnvOffsetBasis;
+            }
+        }
+        return hash;
+    }
+
+    private static byte[] PackRows(byte[] rows, int rowBytes, int firstRow, int height)
+    {
+        using var ms = new MemoryStream();
+        Span<byte> length = stackalloc byte[2];
+        for (var y = firstRow; y < height; y++)
+        {
+            var packed = PackBits(rows.AsSpan(y * rowBytes, rowBytes));
+            BinaryPrimitives.WriteUInt16LittleEndian(length, (ushort)packed.Length);
+            ms.Write(length);
+            ms.Write(packed);
+        }
+        return ms.ToArray();
+    }
+
+    /// <summary>
+    /// PackBits run-length coding, the same chunks as packbitsEncode() of the firmware: a header byte n followed by n + 1
+    /// literal bytes (0..127) or by one byte repeated 1 - n times (-127..-1).
+    /// </summary>
+    public static byte[] PackBits(ReadOnlySpan<byte> data)
+    {
+        var output = new List<byte>(data.Length / 8 + 2);
+        var position = 0;
+        while (position < data.Length)
+        {
+            var run = 1;
+            while (position + run < data.Length && run < 128 && data[position + run] == data[position])
+            {
+                run++;
+            }
+            if (run >= 2)
+            {
+                output.Add((byte)(sbyte)(1 - run));
+                output.Add(data[position]);
+                position += run;
+                continue;
+            }
+
+            // Literal chunk, ends where a run of at least 3 equal bytes starts
+            var literal = 1;
+            while (position + literal < data.Length && literal < 128)
+            {
+                var next = position + literal;
+                if (next + 2 < data.Length && data[next] == data[next + 1] && data[next] == data[next + 2])
+                {
+                    break;
+                }
+                literal++;
+            }
+            output.Add((byte)(literal - 1));
+            output.AddRange(data.Slice(position, literal).ToArray());
+            position += literal;
+        }
+        return output.ToArray();
+    }
+}
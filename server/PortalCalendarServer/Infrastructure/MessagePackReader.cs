@@ -0,0 +1,133 @@
+using System.Buffers.Binary;
+using System.Text;
+
+namespace PortalCalendarServer.Infrastructure;
+
+/// <summary>
+/// Minimal MessagePack decoder for the small payloads sent by the devices (ArduinoJson's serializeMsgPack).
+/// Maps become <c>Dictionary&lt;string, object?&gt;</c>, arrays <c>List&lt;object?&gt;</c>, integers <c>long</c>
+/// (or <c>ulong</c> above long.MaxValue), floats <c>double</c>, strings <c>string</c> and binary data <c>byte[]</c>.
+/// Extension types are not supported.
+/// </summary>
+public static class MessagePackReader
+{
+    public static object? Read(byte[] data)
+    {
+        var position = 0;
+        var value = ReadValue(data, ref position, 0);
+        if (position != data.Length)
+        {
+            throw new FormatException($"Unexpected data after the MessagePack value at offset {position}");
+        }
+        return value;
+    }
+
+    /// <summary>
+    /// Decodes a payload whose top-level value must be a map with string keys.
+    /// </summary>
+    public static Dictionary<string, object?> ReadMap(byte[] data)
+    {
+        return Read(data) as Dictionary<string, object?>
+            ?? throw new FormatException("MessagePack payload is not a map");
+    }
+
+    // Devices never nest deeper than a few levels, the limit only protects against malicious input
+    private const int MaxDepth = 16;
+
+    private static object? ReadValue(byte[] data, ref int position, int depth)
+    {
+        if (depth > MaxDepth)
+        {
+            throw new FormatException("MessagePack payload is nested too deep");
+        }
+
+        var type = Take(data, ref position, 1)[0];
+
+        if (type <= 0x7f) return (long)type;                                                            // positive fixint
+        if (type >= 0xe0) return (long)(sbyte)type;                                                     // negative fixint
+        if (type >= 0x80 && type <= 0x8f) return ReadMapBody(data, ref position, type & 0x0f, depth);  // fixmap
+        if (type >= 0x90 && type <= 0x9f) return ReadArrayBody(data, ref position, type & 0x0f, depth); // fixarray
+        if (type >= 0xa0 && type <= 0xbf) return ReadString(data, ref position, type & 0x1f);           // fixstr
+
+        switch (type)
+        {
+            case 0xc0: return null;
+            case 0xc2: return false;
+            case 0xc3: return true;
+            case 0xc4: return Take(data, ref position, Take(data, ref position, 1)[0]).ToArray();
+            case 0xc5: return Take(data, ref position, BinaryPrimitives.ReadUInt16BigEndian(Take(data, ref position, 2))).ToArray();
+            case 0xc6: return Take(data, ref position, ReadLength32(data, ref position)).ToArray();
+            case 0xca: return (double)BinaryPrimitives.ReadSingleBigEndian(Take(data, ref position, 4));
+            case 0xcb: return BinaryPrimitives.ReadDoubleBigEndian(Take(data, ref position, 8));
+            case 0xcc: return (long)Take(data, ref position, 1)[0];
+            case 0xcd: return (long)BinaryPrimitives.ReadUInt16BigEndian(Take(data, ref position, 2));
+            case 0xce: return (long)BinaryPrimitives.ReadUInt32BigEndian(Take(data, ref position, 4));
+            case 0xcf:
+                var u64 = BinaryPrimitives.ReadUInt64BigEndian(Take(data, ref position, 8));
+                return u64 <= long.MaxValue ? (long)u64 : u64;
+            case 0xd0: return (long)(sbyte)Take(data, ref position, 1)[0];
+            case 0xd1: return (long)BinaryPrimitives.ReadInt16BigEndian(Take(data, ref position, 2));
+            case 0xd2: return (long)BinaryPrimitives.ReadInt32BigEndian(Take(data, ref position, 4));
+            case 0xd3: return BinaryPrimitives.ReadInt64BigEndian(Take(data, ref position, 8));
+            case 0xd9: return ReadString(data, ref position, Take(data, ref position, 1)[0]);
+            case 0xda: return ReadString(data, ref position, BinaryPrimitives.ReadUInt16BigEndian(Take(data, ref position, 2)));
+            case 0xdb: return ReadString(data, ref position, ReadLength32(data, ref position));
+            case 0xdc: return ReadArrayBody(data, ref position, BinaryPrimitives.ReadUInt16BigEndian(Take(data, ref position, 2)), depth);
+            case 0xdd: return ReadArrayBody(data, ref position, ReadLength32(data, ref position), depth);
+            case 0xde: return ReadMapBody(data, ref position, BinaryPrimitives.ReadUInt16BigEndian(Take(data, ref position, 2)), depth);
+            case 0xdf: return ReadMapBody(data, ref position, ReadLength32(data, ref position), depth);
+            default:
+                throw new FormatException($"Unsupported MessagePack type 0x{type:x2} at offset {position - 1}");
+        }
+    }
+
+    private static Dictionary<string, object?> ReadMapBody(byte[] data, ref int position, int count, int depth)
+    {
+        var map = new Dictionary<string, object?>();
+        for (var i = 0; i < count; i++)
+        {
+            if (ReadValue(data, ref position, depth + 1) is not string key)
+            {
+                throw new FormatException("MessagePack map keys must be strings");
+            }
+            map[key] = ReadValue(data, ref position, depth + 1);
+        }
+        return map;
+    }
+
+    private static List<object?> ReadArrayBody(byte[] data, ref int position, int count, int depth)
+    {
+        var list = new List<object?>();
+        for (var i = 0; i < count; i++)
+        {
+            list.Add(ReadValue(data, ref position, depth + 1));
+        }
+        return list;
+    }
+
+    private static string ReadString(byte[] data, ref int position, int length)
+    {
+        return Encoding.UTF8.GetString(Take(data, ref position, length));
+    }
+
+    private static int ReadLength32(byte[] data, ref int position)
+    {
+        var length = BinaryPrimitives.ReadUInt32BigEndian(Take(data, ref position, 4));
+        if (length > int.MaxValue)
+        {
+            throw new FormatException("MessagePack length out of range");
+        }
+        return (int)length;
+    }
+
+    private static ReadOnlySpan<byte> Take(byte[] data, ref int position, int length)
+    {
+        if (length < 0 || position + length > data.Length)
+        {
+            throw new FormatException("Truncated MessagePack payload");
+        }
+        var span = new ReadOnlySpan<byte>(data, position, length);
+        position += length;
+        return span;
+    }
+}
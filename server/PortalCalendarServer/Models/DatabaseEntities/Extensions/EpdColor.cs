@@ -12,6 +12,8 @@ namespace PortalCalendarServer.Models.DatabaseEntities
         public bool IsBlue { get { return Code == "blue"; } }
         public bool IsGreen { get { return Code == "green"; } }
         public bool IsOrange { get { return Code == "orange"; } }
+        public bool IsLightGrey { get { return Code == "lightgrey"; } }
+        public bool IsDarkGrey { get { return Code == "darkgrey"; } }
 
         private Rgba32? _epdPreviewRgba32;
         // Parsed RGBA32 representation of HexValue for fast pixel comparison.
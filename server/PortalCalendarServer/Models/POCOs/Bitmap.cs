@@ -7,7 +7,21 @@ namespace PortalCalendarServer.Models.POCOs.Bitmap
     {
         Png,
         EpaperSpecificV1,
-        EpaperSpecificV2
+        EpaperSpecificV2,
+        /// <summary>
+        /// Rows of <see cref="EpaperSpecificV2"/> after a binary header, see <see cref="Infrastructure.EpaperBitmapV3Writer"/>.
+        /// </summary>
+        EpaperSpecificV3
+    }
+
+    /// <summary>
+    /// Row decoders a device has, sent as the "caps" bitmask of the bitmap request (DEVICE_CAPS_* in the firmware).
+    /// </summary>
+    [Flags]
+    public enum BitmapDecoderCapabilities
+    {
+        None = 0,
+        PackBitsRows = 1
     }
 
     public class BitmapOptions
@@ -23,6 +37,19 @@ namespace PortalCalendarServer.Models.POCOs.Bitmap
         public OutputFormat Format { get; set; } = OutputFormat.Png;
         public required DisplayType DisplayType { get; set; }
         public string? DitheringType { get; set; } = null;
+        /// <summary>
+        /// First row of the bitmap data to return (EpaperSpecificV2 and V3 only). Lets a client resume an interrupted download.
+        /// The checksum is always computed over the full bitmap.
+        /// </summary>
+        public int FirstRow { get; set; } = 0;
+        /// <summary>
+        /// Decoders of the device, EpaperSpecificV3 uses the smallest encoding among them.
+        /// </summary>
+        public BitmapDecoderCapabilities Capabilities { get; set; } = BitmapDecoderCapabilities.None;
+        /// <summary>
+        /// Snapshot to convert. Defaults to the regular web snapshot of the display.
+        /// </summary>
+        public string? SourceImagePath { get; set; } = null;
     }
 
     public class BitmapResult
@@ -5,5 +5,9 @@
         public required DateTime NextWakeup;
         public required int SleepInSeconds;
         public required string Schedule;
+        /// <summary>
+        /// Next expected change of the displayed content (from the "content_change_schedule" crontab), null if not configured.
+        /// </summary>
+        public DateTime? NextContentChange;
     }
 }
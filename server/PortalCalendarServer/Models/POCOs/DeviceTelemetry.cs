@@ -0,0 +1,156 @@
+using System.Globalization;
+
+namespace PortalCalendarServer.Models.POCOs;
+
+/// <summary>
+/// Telemetry sent by a display with its config request. Older firmware sends it as a query string, newer firmware as a
+/// MessagePack map in the request body. The static fields (dimensions, rotation, voltage curve) are only sent after a reset
+/// or when the server asks for them, so any field may be missing.
+/// Voltages are kept as strings because they are stored as such in the display config.
+/// </summary>
+public record DeviceTelemetry
+{
+    /// <summary>
+    /// Version of the binary payload, 0 for the query string
+    /// </summary>
+    public int Version { get; init; }
+
+    public string? Mac { get; init; }
+    public string? Firmware { get; init; }
+    public string? ColorType { get; init; }
+    public int? Width { get; init; }
+    public int? Height { get; init; }
+    public int? Rotation { get; init; }
+
+    public string? VoltageRaw { get; init; }
+    public string? Voltage { get; init; }
+    public string? MinVoltage { get; init; }
+    public string? MaxVoltage { get; init; }
+    public string? MinLinearVoltage { get; init; }
+    public string? MaxLinearVoltage { get; init; }
+
+    public string? ResetReason { get; init; }
+    public string? WakeupReason { get; init; }
+
+    // Counters appended by the binary payload
+    public int? WifiRssi { get; init; }
+    public long? FreeHeap { get; init; }
+    public long? MinFreeHeap { get; init; }
+    public long? WifiConnectMs { get; init; }
+    public long? AwakeMs { get; init; }
+
+    // Battery model of the device: projected days until the battery is empty, the power policy derived from it
+    // (0 = normal, 1 = saving, 2 = critical) and how many times the device stretches the sleep requested by the server
+    public double? BatteryDaysRemaining { get; init; }
+    public int? BatteryPolicy { get; init; }
+    public int? SleepFactor { get; init; }
+
+    // Memory minima of the wakeups since the last telemetry (bytes): free internal heap, its largest free block, free PSRAM
+    // and the unused stack of the main loop and of the lwIP task
+    public long? WakeMinFreeHeap { get; init; }
+    public long? WakeMinLargestBlock { get; init; }
+    public long? WakeMinFreePsram { get; init; }
+    public long? WakeMinLoopStack { get; init; }
+    public long? WakeMinTcpipStack { get; init; }
+
+    // HTTPS handshakes of the previous wakeup: how many, how many of them resumed a cached session and their total time
+    public int? TlsHandshakes { get; init; }
+    public int? TlsResumed { get; init; }
+    public long? TlsHandshakeMs { get; init; }
+
+    /// <summary>
+    /// True if the static fields are included
+    /// </summary>
+    public bool HasStaticFields => Width.HasValue && Height.HasValue;
+
+    /// <summary>
+    /// Builds the telemetry from a decoded MessagePack map (see MessagePackReader). Unknown keys are ignored so that the
+    /// firmware can add fields before the server knows about them.
+    /// </summary>
+    public static DeviceTelemetry FromMap(Dictionary<string, object?> map)
+    {
+        return new DeviceTelemetry
+        {
+            Version = (int)(GetLong(map, "ver") ?? 0),
+            Mac = GetString(map, "mac"),
+            Firmware = GetString(map, "fw"),
+            ColorType = GetString(map, "c"),
+            Width = (int?)GetLong(map, "w"),
+            Height = (int?)GetLong(map, "h"),
+            Rotation = (int?)GetLong(map, "rot"),
+            VoltageRaw = GetNumberAsString(map, "adc"),
+            Voltage = GetNumberAsString(map, "v"),
+            MinVoltage = GetNumberAsString(map, "vmin"),
+            MaxVoltage = GetNumberAsString(map, "vmax"),
+            MinLinearVoltage = GetNumberAsString(map, "vlmin"),
+            MaxLinearVoltage = GetNumberAsString(map, "vlmax"),
+            ResetReason = GetString(map, "reset"),
+            WakeupReason = GetString(map, "wakeup"),
+            WifiRssi = (int?)GetLong(map, "rssi"),
+            FreeHeap = GetLong(map, "heap"),
+            MinFreeHeap = GetLong(map, "minheap"),
+            WifiConnectMs = GetLong(map, "wifi"),
+            AwakeMs = GetLong(map, "up"),
+            BatteryDaysRemaining = GetDouble(map, "bdays"),
+            BatteryPolicy = (int?)GetLong(map, "bpol"),
+            SleepFactor = (int?)GetLong(map, "bsf"),
+            WakeMinFreeHeap = GetLong(map, "mheap"),
+            WakeMinLargestBlock = GetLong(map, "mblk"),
+            WakeMinFreePsram = GetLong(map, "mpsram"),
+            WakeMinLoopStack = GetLong(map, "mstk"),
+            WakeMinTcpipStack = GetLong(map, "mstkip"),
+            TlsHandshakes = (int?)GetLong(map, "tlsn"),
+            TlsResumed = (int?)GetLong(map, "tlsr"),
+            TlsHandshakeMs = GetLong(map, "tlsms"),
+        };
+    }
+
+    private static string? GetString(Dictionary<string, object?> map, string key)
+    {
+        return map.TryGetValue(key, out var value) ? value as string : null;
+    }
+
+    private static long? GetLong(Dictionary<string, object?> map, string key)
+    {
+        if (!map.TryGetValue(key, out var value))
+        {
+            return null;
+        }
+        return value switch
+        {
+            long l => l,
+            double d => (long)Math.Round(d),
+            _ => null
+        };
+    }
+
+    private static double? GetDouble(Dictionary<string, object?> map, string key)
+    {
+        if (!map.TryGetValue(key, out var value))
+        {
+            return null;
+        }
+        return value switch
+        {
+            long l => l,
+            double d => d,
+            _ => null
+        };
+    }
+
+    private static string? GetNumberAsString(Dictionary<string, object?> map, string key)
+    {
+        if (!map.TryGetValue(key, out var value))
+        {
+            return null;
+        }
+        return value switch
+        {
+            long l => l.ToString(CultureInfo.InvariantCulture),
+            // Floats from the device are single precision, don't let 3.85 turn into 3.8499999046325684
+            double d => Math.Round(d, 3).ToString(CultureInfo.InvariantCulture),
+            string s => s,
+            _ => null
+        };
+    }
+}
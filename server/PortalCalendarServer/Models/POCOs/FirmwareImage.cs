@@ -0,0 +1,24 @@
+namespace PortalCalendarServer.Models.POCOs;
+
+/// <summary>
+/// Firmware image offered to a display for a pull OTA update
+/// </summary>
+public record FirmwareImage
+{
+    public required string Version { get; init; }
+
+    /// <summary>
+    /// Path to the uncompressed firmware binary (as built by PlatformIO)
+    /// </summary>
+    public required string ImagePath { get; init; }
+
+    /// <summary>
+    /// Size of the uncompressed image in bytes
+    /// </summary>
+    public long Size { get; init; }
+
+    /// <summary>
+    /// SHA-256 of the uncompressed image, lowercase hex
+    /// </summary>
+    public required string Sha256 { get; init; }
+}
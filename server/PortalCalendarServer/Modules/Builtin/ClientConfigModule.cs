@@ -4,7 +4,7 @@ namespace PortalCalendarServer.Modules.Builtin;
 
 /// <summary>
 /// Module backing the "ePaper display (client)" config tab.
-/// Contains scheduling, alive-check, and OTA settings.
+/// Contains scheduling, alive-check, refresh mode and OTA settings.
 /// </summary>
 public class ClientConfigModule : IPortalModule
 {
@@ -14,8 +14,10 @@ public class ClientConfigModule : IPortalModule
 
     public IReadOnlyList<string> OwnedConfigKeys =>
     [
-        "ota_mode", "wakeup_schedule",
-        "alive_check_safety_lag_minutes", "alive_check_minimal_failure_count"
+        "ota_mode", "wakeup_schedule", "content_change_schedule", "maximal_sleep_time_minutes", "frame_schedule_count",
+        "alive_check_safety_lag_minutes", "alive_check_minimal_failure_count",
+        "max_fast_refreshes", "clean_refresh_schedule",
+        "firmware_update_file"
     ];
 
     public IReadOnlyList<string> CheckboxConfigKeys => ["ota_mode"];
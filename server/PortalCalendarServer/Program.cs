@@ -113,6 +113,7 @@ builder.Services.AddHttpClient(Options.DefaultName, client =>
 builder.Services.AddSingleton<IWeb2PngService, Web2PngService>();
 builder.Services.AddScoped<IDisplayService, DisplayService>();
 builder.Services.AddScoped<PageGeneratorService>();
+builder.Services.AddScoped<IFirmwareService, FirmwareService>();
 builder.Services.AddScoped<CacheManagementService>();
 builder.Services.AddScoped<ThemeService>();
 builder.Services.AddScoped<IDatabaseCacheServiceFactory, DatabaseCacheServiceFactory>();
@@ -71,6 +71,13 @@ public class MissedConnectionsCheckService : PeriodicBackgroundService
                 var wakeupInfo = displayService.GetNextWakeupTime(display, lastVisit.Value);
                 var nextExpectedTime = wakeupInfo.NextWakeup;
 
+                // A display low on battery sleeps several times longer than asked, don't report it as frozen for that
+                var sleepFactor = displayService.GetConfigInt(display, "_sleep_factor") ?? 1;
+                if (sleepFactor > 1)
+                {
+                    nextExpectedTime = lastVisit.Value + (nextExpectedTime - lastVisit.Value) * sleepFactor;
+                }
+
                 // Default to 2× the interval (if not configured at all) so a display has a full extra cycle to connect.
                 var defaultSafetyLagMinutes = (int)_interval.TotalMinutes * 2;
                 var safetyLagMinutes = displayService.GetConfigInt(display, "alive_check_safety_lag_minutes") ?? defaultSafetyLagMinutes;
@@ -1,5 +1,6 @@
 using Microsoft.EntityFrameworkCore;
 using PortalCalendarServer.Data;
+using PortalCalendarServer.Infrastructure;
 using PortalCalendarServer.Models.DatabaseEntities;
 using PortalCalendarServer.Models.POCOs;
 using PortalCalendarServer.Models.POCOs.Bitmap;
@@ -345,16 +346,49 @@ public class DisplayService(
             nextWakeup = GetNextWakeupTimeForDateTime(schedule, nextWakeup.AddSeconds(1), timeZone);
         }
 
+        // If we know when the content is going to change, the wakeups before that would only find the same image.
+        // Skip them and wake up at the first scheduled time after the change instead.
+        DateTime? nextContentChange = null;
+        var contentChangeSchedule = GetConfig(display, "content_change_schedule");
+        if (!string.IsNullOrWhiteSpace(contentChangeSchedule))
+        {
+            nextContentChange = GetNextWakeupTimeForDateTime(contentChangeSchedule, now, timeZone);
+            if (nextWakeup < nextContentChange.Value)
+            {
+                nextWakeup = GetNextWakeupTimeForDateTime(schedule, nextContentChange.Value.AddSeconds(-1), timeZone);
+            }
+
+            // Don't stay offline forever if the content changes rarely
+            var maxSleepMinutes = GetConfigInt(display, "maximal_sleep_time_minutes") ?? 24 * 60;
+            if (nextWakeup > now.AddMinutes(maxSleepMinutes))
+            {
+                nextWakeup = now.AddMinutes(maxSleepMinutes);
+            }
+        }
+
         var sleepInSeconds = (int)(nextWakeup - now).TotalSeconds;
 
         return new WakeUpInfo
         {
             NextWakeup = nextWakeup,
             SleepInSeconds = sleepInSeconds,
-            Schedule = schedule
+            Schedule = schedule,
+            NextContentChange = nextContentChange
         };
     }
 
+    public DateTime GetNextCleanRefreshTime(Display display, DateTime? optionalNow = null)
+    {
+        var now = optionalNow ?? DateTime.UtcNow;
+        // A field cleared in the UI is stored as an empty string
+        var schedule = GetConfig(display, "clean_refresh_schedule");
+        if (string.IsNullOrWhiteSpace(schedule))
+        {
+            schedule = "0 3 * * *";
+        }
+        return GetNextWakeupTimeForDateTime(schedule, now, GetTimeZoneInfo(display));
+    }
+
     public void ResetMissedConnectsCount(Display display)
     {
         SetConfig(display, "_missed_connects", "0");
@@ -407,7 +441,7 @@ public class DisplayService(
     {
         logger.LogDebug("Converting pre-generated bitmap");
 
-        var imagePath = RawWebSnapshotFileName(display);
+        var imagePath = options.SourceImagePath ?? RawWebSnapshotFileName(display);
         if (!File.Exists(imagePath))
         {
             throw new FileNotFoundException($"Image file not found: {imagePath}");
@@ -542,10 +576,16 @@ public class DisplayService(
             var bitmap = _convertToEpaperFormatV2(img, colorVariant);
             var checksum = ComputeSHA1(bitmap);
 
-            // Output format: "MM\n" + checksum + "\n" + bitmap data
+            if (options.FirstRow < 0 || options.FirstRow >= img.Height)
+            {
+                throw new ArgumentOutOfRangeException(nameof(options), $"First row {options.FirstRow} is outside of the bitmap (0..{img.Height - 1})");
+            }
+            var rowBytes = bitmap.Length / img.Height;
+
+            // Output format: "MM\n" + checksum + "\n" + bitmap data (starting at the requested row)
             var output = Encoding.ASCII.GetBytes("MM\n")
                 .Concat(Encoding.ASCII.GetBytes(checksum + "\n"))
-                .Concat(bitmap)
+                .Concat(bitmap.Skip(options.FirstRow * rowBytes))
                 .ToArray();
 
             return new BitmapResult
@@ -558,6 +598,23 @@ public class DisplayService(
                 }
             };
         }
+        else if (options.Format == OutputFormat.EpaperSpecificV3)
+        {
+            var colorVariant = display.ColorVariant;
+            var bitmap = _convertToEpaperFormatV2(img, colorVariant);
+            var output = EpaperBitmapV3Writer.Write(bitmap, img.Width, img.Height, TransferBitsPerPixel(colorVariant.DisplayType),
+                options.FirstRow, options.Capabilities);
+
+            return new BitmapResult
+            {
+                Data = output,
+                ContentType = "application/octet-stream",
+                Headers = new Dictionary<string, string>
+                {
+                    ["Content-Transfer-Encoding"] = "binary"
+                }
+            };
+        }
         else
         {
             throw new ArgumentException($"Unknown format requested: {options.Format}");
@@ -736,33 +793,39 @@ public class DisplayService(
         return ms.ToArray();
     }
 
-    private byte[] _convertToEpaperFormatV2(Image<Rgba32> img, ColorVariant colorVariant)
+    /// <summary>
+    /// Bits per pixel of the EpaperSpecificV2 (and V3) row data, based on NumColors.
+    /// </summary>
+    private static int TransferBitsPerPixel(DisplayType displayType)
     {
-        var displayType = colorVariant.DisplayType;
-
-        // Pre-compute bits per pixel and mask based on NumColors (invariant for the whole image)
-        int bitsPerPixel;
-        byte mask;
         if (displayType.NumColors <= 2)
         {
-            bitsPerPixel = 1;
-            mask = 0x01;
+            return 1;
         }
         else if (displayType.NumColors <= 4)
         {
-            bitsPerPixel = 2;
-            mask = 0x03;
+            return 2;
         }
         else if (displayType.NumColors <= 8)
         {
-            bitsPerPixel = 4;
-            mask = 0x07;
+            return 4;
         }
-        else
+        return 8;
+    }
+
+    private byte[] _convertToEpaperFormatV2(Image<Rgba32> img, ColorVariant colorVariant)
+    {
+        var displayType = colorVariant.DisplayType;
+
+        // Pre-compute bits per pixel and mask (invariant for the whole image)
+        int bitsPerPixel = TransferBitsPerPixel(displayType);
+        byte mask = bitsPerPixel switch
         {
-            bitsPerPixel = 8;
-            mask = 0xFF;
-        }
+            1 => 0x01,
+            2 => 0x03,
+            4 => 0x07,
+            _ => 0xFF
+        };
 
         // Build a RGB → transfer byte lookup table upfront to avoid per-pixel ClassifyPixelColor + EpdColorToTransferFormat
         var epdColors = colorVariant.EpdColors.ToArray();
@@ -845,12 +908,15 @@ public class DisplayService(
     //GxEPD_GREEN,   // 5 = green
     //GxEPD_ORANGE,  // 6 = orange
     //GxEPD_WHITE    // 7 = white (fallback)
+    // 2-bit grayscale ("4G") reuses the codes of the colors it never shares a palette with:
+    //GxEPD_LIGHTGREY, // 2 = light grey
+    //GxEPD_DARKGREY,  // 3 = dark grey
     private static byte EpdColorToTransferFormat(EpdColor color)
     {
         if (color.IsWhite) return 0;
         if (color.IsBlack) return 1;
-        if (color.IsRed) return 2;
-        if (color.IsYellow) return 3;
+        if (color.IsRed || color.IsLightGrey) return 2;
+        if (color.IsYellow || color.IsDarkGrey) return 3;
         if (color.IsBlue) return 4;
         if (color.IsGreen) return 5;
         if (color.IsOrange) return 6;
@@ -874,6 +940,16 @@ public class DisplayService(
         return ret;
     }
 
+    public string ScheduledWebSnapshotFileName(Display display, DateTime displayAt)
+    {
+        var imagePath = _configuration["Paths:GeneratedImages"]
+            ?? throw new InvalidOperationException("GeneratedImages path is not configured");
+
+        var ret = Path.Combine(imagePath, $"display-{display.Id}-scheduled-{displayAt:yyyyMMddHHmm}.png");
+
+        return ret;
+    }
+
     private string DisplayIntermediateImageName(Display display)
     {
         var imagePath = _configuration["Paths:GeneratedImages"]
@@ -888,7 +964,9 @@ public class DisplayService(
             int displayId,
             OutputFormat format,
             DisplayRotation? rotate = null,
-            string? flip = null)
+            string? flip = null,
+            int firstRow = 0,
+            BitmapDecoderCapabilities capabilities = BitmapDecoderCapabilities.None)
     {
         var ret = new BitmapResult();
 
@@ -904,6 +982,30 @@ public class DisplayService(
             return ret;
         }
 
+        var bitmapOptions = DefaultBitmapOptions(display, format, rotate, flip);
+        bitmapOptions.FirstRow = firstRow;
+        bitmapOptions.Capabilities = capabilities;
+
+        ret = ConvertExistingWebSnapshot(display, bitmapOptions);
+        return ret;
+    }
+
+    public BitmapResult ConvertScheduledWebSnapshot(int displayId, string imagePath)
+    {
+        var display = GetDisplayById(displayId);
+        if (display == null)
+        {
+            return new BitmapResult { ErrorMessage = "Display not found" };
+        }
+
+        var bitmapOptions = DefaultBitmapOptions(display, OutputFormat.EpaperSpecificV2);
+        bitmapOptions.SourceImagePath = imagePath;
+
+        return ConvertExistingWebSnapshot(display, bitmapOptions);
+    }
+
+    private BitmapOptions DefaultBitmapOptions(Display display, OutputFormat format, DisplayRotation? rotate = null, string? flip = null)
+    {
         rotate ??= display.Rotation;
         flip ??= "";
 
@@ -913,7 +1015,7 @@ public class DisplayService(
             throw new InvalidOperationException($"No colors defined for display {display.Id}");
         }
 
-        var bitmapOptions = new BitmapOptions
+        return new BitmapOptions
         {
             Rotate = rotate!.Value,
             Flip = flip,
@@ -924,8 +1026,5 @@ public class DisplayService(
             DisplayType = display.DisplayType,
             DitheringType = display.DitheringTypeCode
         };
-
-        ret = ConvertExistingWebSnapshot(display, bitmapOptions);
-        return ret;
     }
 }
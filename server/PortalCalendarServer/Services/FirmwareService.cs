@@ -0,0 +1,154 @@
+using Microsoft.Extensions.Caching.Memory;
+using PortalCalendarServer.Models.DatabaseEntities;
+using PortalCalendarServer.Models.POCOs;
+using System.Buffers.Binary;
+using System.IO.Compression;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace PortalCalendarServer.Services;
+
+/// <summary>
+/// Firmware images for pull OTA updates. The binaries built by PlatformIO (firmware.bin) are copied into the
+/// "Paths:Firmware" directory, each display is then told which file it should run. The version is read from the
+/// image itself, so the display is never offered an image again just because a typed version doesn't match.
+/// </summary>
+public class FirmwareService : IFirmwareService
+{
+    // esp_app_desc_t follows the image header (24 bytes) and the header of the first segment (8 bytes)
+    private const int AppDescOffset = 24 + 8;
+    private const uint AppDescMagic = 0xABCD5432;
+    private const int AppDescVersionOffset = AppDescOffset + 16;
+    private const int AppDescVersionLength = 32;
+
+    private readonly ILogger<FirmwareService> _logger;
+    private readonly IConfiguration _configuration;
+    private readonly IDisplayService _displayService;
+    private readonly IMemoryCache _memoryCache;
+
+    public FirmwareService(
+        ILogger<FirmwareService> logger,
+        IConfiguration configuration,
+        IDisplayService displayService,
+        IMemoryCache memoryCache)
+    {
+        _logger = logger;
+        _configuration = configuration;
+        _displayService = displayService;
+        _memoryCache = memoryCache;
+    }
+
+    public FirmwareImage? GetPendingUpdate(Display display)
+    {
+        var fileName = _displayService.GetConfig(display, "firmware_update_file");
+        if (string.IsNullOrWhiteSpace(fileName))
+        {
+            return null;
+        }
+
+        // Only plain file names, the config must not point anywhere outside the firmware directory
+        if (Path.GetFileName(fileName) != fileName)
+        {
+            _logger.LogWarning("Invalid firmware file name '{FileName}' for display {DisplayId}", fileName, display.Id);
+            return null;
+        }
+
+        var imagePath = Path.Combine(FirmwareDirectory(), fileName);
+        if (!File.Exists(imagePath))
+        {
+            _logger.LogWarning("Firmware file {ImagePath} for display {DisplayId} not found", imagePath, display.Id);
+            return null;
+        }
+
+        var image = GetImage(imagePath);
+        if (image == null || image.Version == display.Firmware)
+        {
+            return null;
+        }
+        return image;
+    }
+
+    public string GetCompressedImagePath(FirmwareImage image)
+    {
+        var compressedPath = image.ImagePath + ".zlib";
+        if (File.Exists(compressedPath) && File.GetLastWriteTimeUtc(compressedPath) >= File.GetLastWriteTimeUtc(image.ImagePath))
+        {
+            return compressedPath;
+        }
+
+        // Written into a temporary file first, a concurrent request must never see a half-written image
+        var tmpPath = compressedPath + "." + Guid.NewGuid().ToString("N") + ".tmp";
+        using (var input = File.OpenRead(image.ImagePath))
+        using (var output = File.Create(tmpPath))
+        using (var zlib = new ZLibStream(output, CompressionLevel.SmallestSize))
+        {
+            input.CopyTo(zlib);
+        }
+        File.Move(tmpPath, compressedPath, overwrite: true);
+
+        _logger.LogInformation("Compressed firmware {ImagePath}: {Size} -> {CompressedSize} bytes",
+            image.ImagePath, image.Size, new FileInfo(compressedPath).Length);
+
+        return compressedPath;
+    }
+
+    /// <summary>
+    /// Hash and version of the image, cached per file and modification time (every config request of a display with
+    /// a pending update needs them, the image only changes when a new build is copied over it).
+    /// </summary>
+    private FirmwareImage? GetImage(string imagePath)
+    {
+        var cacheKey = $"firmware:{imagePath}:{File.GetLastWriteTimeUtc(imagePath).Ticks}";
+        if (_memoryCache.TryGetValue<FirmwareImage>(cacheKey, out var cached) && cached != null)
+        {
+            return cached;
+        }
+
+        using var stream = File.OpenRead(imagePath);
+        var version = ReadAppVersion(stream);
+        if (version == null)
+        {
+            _logger.LogWarning("Firmware file {ImagePath} has no application descriptor, not an ESP32 image", imagePath);
+            return null;
+        }
+
+        stream.Position = 0;
+        var image = new FirmwareImage
+        {
+            Version = version,
+            ImagePath = imagePath,
+            Size = stream.Length,
+            Sha256 = Convert.ToHexString(SHA256.HashData(stream)).ToLowerInvariant()
+        };
+
+        _memoryCache.Set(cacheKey, image, new MemoryCacheEntryOptions
+        {
+            SlidingExpiration = TimeSpan.FromDays(1),
+            Size = 1024 // Rough estimate in bytes
+        });
+        return image;
+    }
+
+    /// <summary>
+    /// Version from the esp_app_desc_t of the image (PROJECT_VER of the build), null if the descriptor is missing.
+    /// </summary>
+    public static string? ReadAppVersion(Stream stream)
+    {
+        var header = new byte[AppDescVersionOffset + AppDescVersionLength];
+        if (stream.ReadAtLeast(header, header.Length, throwOnEndOfStream: false) < header.Length
+            || BinaryPrimitives.ReadUInt32LittleEndian(header.AsSpan(AppDescOffset)) != AppDescMagic)
+        {
+            return null;
+        }
+
+        var version = header.AsSpan(AppDescVersionOffset, AppDescVersionLength);
+        var length = version.IndexOf((byte)0);
+        return Encoding.ASCII.GetString(length >= 0 ? version[..length] : version);
+    }
+
+    private string FirmwareDirectory()
+    {
+        return _configuration["Paths:Firmware"]
+            ?? throw new InvalidOperationException("Firmware path is not configured");
+    }
+}
@@ -278,6 +278,24 @@ public class MqttService(
                 ["entity_category"] = "diagnostic",
                 ["device_class"] = "enum",
                 ["icon"] = "mdi:sleep-off"
+            },
+            ["wifi_rssi"] = new()
+            {
+                ["component"] = "sensor",
+                ["entity_category"] = "diagnostic",
+                ["device_class"] = "signal_strength",
+                ["state_class"] = "measurement",
+                ["unit_of_measurement"] = "dBm",
+                ["icon"] = "mdi:wifi"
+            },
+            ["battery_days_remaining"] = new()
+            {
+                ["component"] = "sensor",
+                ["entity_category"] = "diagnostic",
+                ["device_class"] = "duration",
+                ["state_class"] = "measurement",
+                ["unit_of_measurement"] = "d",
+                ["icon"] = "mdi:battery-clock"
             }
         };
 
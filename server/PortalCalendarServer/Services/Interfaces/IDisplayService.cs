@@ -107,6 +107,12 @@ public interface IDisplayService
     /// </summary>
     WakeUpInfo GetNextWakeupTime(Display display, DateTime? optionalNow = null);
 
+    /// <summary>
+    /// Next time (UTC) when the display should do a clean full refresh of the panel instead of the fast one,
+    /// from the "clean_refresh_schedule" crontab (3 am in the display time zone by default)
+    /// </summary>
+    DateTime GetNextCleanRefreshTime(Display display, DateTime? optionalNow = null);
+
     /// <summary>
     /// Reset the missed connections count for a display to zero
     /// </summary>
@@ -149,16 +155,31 @@ public interface IDisplayService
 
     string RawWebSnapshotFileName(Display display);
 
+    /// <summary>
+    /// File name of a snapshot rendered ahead of time for the frame schedule.
+    /// </summary>
+    string ScheduledWebSnapshotFileName(Display display, DateTime displayAt);
+
     /// <summary>
     /// Builds a <see cref="BitmapResult"/> for the given display using the supplied rendering options.
     /// Returns <c>null</c> when the display, its rendered bitmap, or its display-type information cannot be found;
     /// the <paramref name="errorMessage"/> out-parameter will contain a human-readable reason in that case.
+    /// For <see cref="OutputFormat.EpaperSpecificV2"/> and V3 the bitmap data can start at <paramref name="firstRow"/>,
+    /// V3 picks its row encoding from the device's <paramref name="capabilities"/>.
     /// </summary>
     BitmapResult ConvertExistingRawBitmap(
         int displayId,
         OutputFormat format,
         DisplayRotation? rotate = null,
-        string? flip = null);
+        string? flip = null,
+        int firstRow = 0,
+        BitmapDecoderCapabilities capabilities = BitmapDecoderCapabilities.None);
+
+    /// <summary>
+    /// Convert a snapshot rendered by <see cref="PageGeneratorService.GenerateScheduledImageAsync"/>
+    /// into a complete <see cref="OutputFormat.EpaperSpecificV2"/> frame.
+    /// </summary>
+    BitmapResult ConvertScheduledWebSnapshot(int displayId, string imagePath);
 }
 
 // FIXME ConvertExistingRawBitmap vs  ConvertExistingWebSnapshot ???
@@ -0,0 +1,20 @@
+using PortalCalendarServer.Models.DatabaseEntities;
+using PortalCalendarServer.Models.POCOs;
+
+namespace PortalCalendarServer.Services;
+
+/// <summary>
+/// Service interface for the firmware images offered to the displays (pull OTA)
+/// </summary>
+public interface IFirmwareService
+{
+    /// <summary>
+    /// Firmware the display should update to, or null if it already runs the version built into the configured image or none is configured.
+    /// </summary>
+    FirmwareImage? GetPendingUpdate(Display display);
+
+    /// <summary>
+    /// Path to the zlib-compressed copy of the image, created on the first request.
+    /// </summary>
+    string GetCompressedImagePath(FirmwareImage image);
+}
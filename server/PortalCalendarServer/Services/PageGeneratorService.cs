@@ -140,6 +140,44 @@ public class PageGeneratorService
         }
     }
 
+    /// <summary>
+    /// Render the page as it should look at <paramref name="displayAt"/> (UTC) into a separate snapshot file.
+    /// Used for the pre-fetched frame schedule, so unlike <see cref="GenerateImageFromWebAsync"/> it
+    /// doesn't touch the render info and doesn't fall back to an error page; failures are thrown to the caller.
+    /// </summary>
+    public virtual async Task<string> GenerateScheduledImageAsync(Display display, DateTime displayAt)
+    {
+        var baseUrl = _configuration["URLs:BaseURL"];
+        if (baseUrl == null)
+        {
+            throw new InvalidOperationException("BaseURL is not configured");
+        }
+
+        var url = _linkGenerator.GetUriByName(
+                Controllers.Constants.CalendarHtmlSpecificDate,
+                new { displayNumber = display.Id, date = displayAt.ToString("yyyy-MM-ddTHH:mm:ss"), preview_colors = false },
+                scheme: new Uri(baseUrl).Scheme,
+                host: new HostString(new Uri(baseUrl).Authority))
+            ?? throw new InvalidOperationException("Could not generate URL for CalendarHtmlSpecificDate");
+
+        var outputPath = _displayService.ScheduledWebSnapshotFileName(display, displayAt);
+        _logger.LogInformation("Generating scheduled calendar image from URL {Url} to {OutputPath}", url, outputPath);
+
+        var headers = new Dictionary<string, string>
+        {
+            [InternalTokenAuthenticationHandler.HeaderName] = _internalTokenService.Token
+        };
+
+        await _web2PngService.ConvertUrlAsync(
+            url,
+            display.VirtualWidth(),
+            display.VirtualHeight(),
+            outputPath,
+            extraHeaders: headers);
+
+        return outputPath;
+    }
+
 }
 
 // Supporting classes
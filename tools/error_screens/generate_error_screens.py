@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+"""Pre-renders the fixed error screens of the firmware (see client/include/error_screens.h).
+
+Every screen is laid out exactly like DisplayManager::displayText() does it on the device (same fonts, margins and word
+wrapping), for every display size found in client/include/epaper/ and every rotation, with ERROR_SCREEN_BAND_LINES empty
+lines left below the text for the variable details. The result goes to client/include/generated/error_screens_data.h as
+PackBits-compressed 1 bpp rows in the native orientation of the panel; the firmware compiles in only the block matching its
+DISPLAY_WIDTH, DISPLAY_HEIGHT and DISPLAY_ROTATION.
+
+Runs as a PlatformIO pre-build script (see platformio.ini) or standalone: python3 tools/error_screens/generate_error_screens.py
+"""
+
+import os
+import re
+
+
+def repo_root():
+    try:
+        return os.path.abspath(os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", ".."))
+    except NameError:  # SCons runs the script without __file__
+        return os.getcwd()
+
+
+INCLUDE = "client/include"
+OUTPUT = "client/include/generated/error_screens_data.h"
+
+# Same as DisplayManager::displayText()
+MARGIN = 10
+LINE_SPACING = 4
+TITLE_GAP = 36
+TITLE_TEXT = "Error"
+TITLE_FONT = "fonts/Open_Sans_Regular_24.h"
+BODY_FONT = "fonts/DejaVu_Sans_Mono_16.h"
+
+
+class Font:
+    """Adafruit GFX font parsed from its header file."""
+
+    def __init__(self, path):
+        with open(path, encoding="utf-8") as f:
+            source = f.read()
+        bitmaps = re.search(r"Bitmaps\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S).group(1)
+        self.bitmap = [int(v, 16) for v in re.findall(r"0x[0-9A-Fa-f]{2}", re.sub(r"//.*", "", bitmaps))]
+        glyphs = re.search(r"Glyphs\[\]\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S).group(1)
+        self.glyphs = [tuple(int(v) for v in g.split(",")) for g in re.findall(r"\{([-\d,\s]+)\}", re.sub(r"//.*", "", glyphs))]
+        header = re.search(r"GFXfont\s+\w+\s*PROGMEM\s*=\s*\{(.*?)\};", source, re.S).group(1)
+        first, last, self.y_advance = [int(v, 0) for v in header.split(",")[2:5]]
+        self.first, self.last = first, last
+
+    def glyph(self, c):
+        code = ord(c)
+        if self.first <= code <= self.last:
+            return self.glyphs[code - self.first]
+        return None
+
+
+class Canvas:
+    """Adafruit_GFX text drawing (custom fonts, text size 1, wrap on) on a GxEPD2-style rotated 1 bpp buffer."""
+
+    def __init__(self, width, height, rotation):
+        self.native_width, self.native_height = width, height
+        self.rotation = rotation
+        self.width, self.height = (height, width) if rotation & 1 else (width, height)
+        self.pixels = [bytearray(width // 8) for _ in range(height)]
+        self.font = None
+
+    def draw_pixel(self, x, y):
+        if x < 0 or y < 0 or x >= self.width or y >= self.height:
+            return
+        if self.rotation == 1:
+            x, y = self.native_width - y - 1, x
+        elif self.rotation == 2:
+            x, y = self.native_width - x - 1, self.native_height - y - 1
+        elif self.rotation == 3:
+            x, y = y, self.native_height - x - 1
+        self.pixels[y][x // 8] |= 0x80 >> (x % 8)
+
+    def text_bounds(self, text):
+        """getTextBounds(text, 0, 0, ...) -> (x1, y1, w, h)"""
+        x = y = 0
+        minx, miny, maxx, maxy = self.width, self.height, -1, -1
+        for c in text:
+            if c == "\n":
+                x = 0
+                y += self.font.y_advance
+                continue
+            g = self.font.glyph(c)
+            if g is None:
+                continue
+            _, gw, gh, xa, xo, yo = g
+            if x + xo + gw > self.width:
+                x = 0
+                y += self.font.y_advance
+            x1, y1 = x + xo, y + yo
+            x2, y2 = x1 + gw - 1, y1 + gh - 1
+            minx, miny, maxx, maxy = min(minx, x1), min(miny, y1), max(maxx, x2), max(maxy, y2)
+            x += xa
+        bx = by = w = h = 0
+        if maxx >= minx:
+            bx, w = minx, maxx - minx + 1
+        if maxy >= miny:
+            by, h = miny, maxy - miny + 1
+        return bx, by, w, h
+
+    def print(self, text, x, y):
+        for c in text:
+            if c == "\n":
+                x = 0
+                y += self.font.y_advance
+                continue
+            g = self.font.glyph(c)
+            if g is None:
+                continue
+            offset, gw, gh, xa, xo, yo = g
+            if gw > 0 and gh > 0:
+                if x + xo + gw > self.width:
+                    x = 0
+                    y += self.font.y_advance
+                bit = 0
+                for yy in range(gh):
+                    for xx in range(gw):
+                        if self.font.bitmap[offset + bit // 8] & (0x80 >> (bit % 8)):
+                            self.draw_pixel(x + xo + xx, y + yo + yy)
+                        bit += 1
+            x += xa
+
+
+def wrap_text(canvas, message, max_lines):
+    """DisplayManager::wrapText()"""
+    max_width = canvas.width - 2 * MARGIN
+    wrapped = []
+    for line in message.split("\n"):
+        if len(wrapped) >= max_lines:
+            break
+        if line == "":
+            wrapped.append("")
+            continue
+        if canvas.text_bounds(line)[2] <= max_width:
+            wrapped.append(line)
+            continue
+        remaining = line
+        while remaining and len(wrapped) < max_lines:
+            candidate = ""
+            pos = 0
+            last_space = -1
+            while pos < len(remaining):
+                test = candidate + remaining[pos]
+                if canvas.text_bounds(test)[2] > max_width and candidate:
+                    break
+                candidate = test
+                if remaining[pos] == " ":
+                    last_space = pos
+                pos += 1
+            if pos < len(remaining) and last_space > 0:
+                wrapped.append(remaining[:last_space])
+                remaining = remaining[last_space + 1:]
+            else:
+                wrapped.append(candidate)
+                remaining = remaining[pos:]
+    return wrapped
+
+
+def render(width, height, rotation, text, title_font, body_font, band_lines):
+    """Returns the rows and the baseline of the first band line."""
+    canvas = Canvas(width, height, rotation)
+
+    canvas.font = title_font
+    tbx, tby, tbw, tbh = canvas.text_bounds(TITLE_TEXT)
+    title_height, title_baseline_offset = tbh, -tby
+
+    canvas.font = body_font
+    lines = wrap_text(canvas, text, 40)
+    _, tby, _, tbh = canvas.text_bounds("Ag")
+    body_line_height, body_baseline_offset = tbh + LINE_SPACING, -tby
+
+    # The fixed text, an empty line and the band
+    total_height = title_height + TITLE_GAP + (len(lines) + 1 + band_lines) * body_line_height
+    start_y = max((canvas.height - total_height) // 2, MARGIN)
+
+    canvas.font = title_font
+    canvas.print(TITLE_TEXT, (canvas.width - tbw) // 2 - tbx, start_y + title_baseline_offset)
+
+    canvas.font = body_font
+    y = start_y + title_height + TITLE_GAP + body_baseline_offset
+    for line in lines:
+        if line:
+            lbx, _, lbw, _ = canvas.text_bounds(line)
+            canvas.print(line, max((canvas.width - lbw) // 2 - lbx, MARGIN), y)
+        y += body_line_height
+
+    return canvas.pixels, y + body_line_height
+
+
+def packbits(data):
+    """packbitsEncode() of the firmware"""
+    out = bytearray()
+    pos = 0
+    while pos < len(data):
+        run = 1
+        while pos + run < len(data) and run < 128 and data[pos + run] == data[pos]:
+            run += 1
+        if run >= 2:
+            out += bytes([(1 - run) & 0xFF, data[pos]])
+            pos += run
+            continue
+        literal = 1
+        while pos + literal < len(data) and literal < 128:
+            nxt = pos + literal
+            if nxt + 2 < len(data) and data[nxt] == data[nxt + 1] == data[nxt + 2]:
+                break
+            literal += 1
+        out.append(literal - 1)
+        out += data[pos:pos + literal]
+        pos += literal
+    return out
+
+
+def c_string(source):
+    return bytes(source, "utf-8").decode("unicode_escape")
+
+
+def generate(root):
+    include = os.path.join(root, INCLUDE)
+    with open(os.path.join(include, "error_screens.h"), encoding="utf-8") as f:
+        screens = re.findall(r'^\s*X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', f.read(), re.M)
+        f.seek(0)
+        band_lines = int(re.search(r"#define ERROR_SCREEN_BAND_LINES (\d+)", f.read()).group(1))
+
+    sizes = set()
+    epaper = os.path.join(include, "epaper")
+    for name in sorted(os.listdir(epaper)):
+        with open(os.path.join(epaper, name), encoding="utf-8") as f:
+            source = f.read()
+        w = re.search(r"#define DISPLAY_WIDTH (\d+)", source)
+        h = re.search(r"#define DISPLAY_HEIGHT (\d+)", source)
+        if w and h:
+            sizes.add((int(w.group(1)), int(h.group(1))))
+
+    title_font = Font(os.path.join(include, TITLE_FONT))
+    body_font = Font(os.path.join(include, BODY_FONT))
+
+    out = [
+        "// Generated by tools/error_screens/generate_error_screens.py from error_screens.h, do not edit",
+        "#pragma once",
+        "",
+        '#include "error_screens.h"',
+        "",
+    ]
+    total = 0
+    for width, height in sorted(sizes):
+        for rotation in range(4):
+            out.append(f"#if DISPLAY_WIDTH == {width} && DISPLAY_HEIGHT == {height} && DISPLAY_ROTATION == {rotation}")
+            out.append("#define HAVE_PRERENDERED_ERROR_SCREENS")
+            entries = []
+            for screen_id, text in screens:
+                rows, band_baseline = render(width, height, rotation, c_string(text), title_font, body_font, band_lines)
+                data = bytearray()
+                for row in rows:
+                    packed = packbits(row) if any(row) else b""  # white rows are just a zero length
+                    data += len(packed).to_bytes(2, "little") + packed
+                total += len(data)
+                name = screen_id.lower()
+                out.append(f"static const uint8_t {name}_rows[] = {{")
+                for i in range(0, len(data), 24):
+                    out.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 24]) + ",")
+                out.append("};")
+                entries.append(f"    {{{name}_rows, sizeof({name}_rows), {band_baseline}}},")
+            out.append("static const PrerenderedErrorScreen prerenderedErrorScreens[ERROR_SCREEN_COUNT] = {")
+            out += entries
+            out.append("};")
+            out.append("#endif")
+            out.append("")
+
+    output = os.path.join(root, OUTPUT)
+    os.makedirs(os.path.dirname(output), exist_ok=True)
+    content = "\n".join(out)
+    if os.path.exists(output):
+        with open(output, encoding="utf-8") as f:
+            if f.read() == content:
+                return
+    with open(output, "w", encoding="utf-8") as f:
+        f.write(content)
+    print(f"Error screens: {len(screens)} screens x {len(sizes)} sizes x 4 rotations, {total} bytes written to {OUTPUT}")
+
+
+try:
+    Import("env")  # noqa: F821 - PlatformIO pre-build script
+    generate(env.subst("$PROJECT_DIR"))  # noqa: F821
+except NameError:
+    if __name__ == "__main__":
+        generate(repo_root())
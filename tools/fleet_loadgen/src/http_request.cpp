@@ -0,0 +1,280 @@
+#include "http_request.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace {
+
+// Incremental decoder of the response body, the data may come in pieces of any size
+class BodyDecoder {
+ private:
+  enum State { IDENTITY, CHUNK_SIZE, CHUNK_DATA, CHUNK_DATA_END, CHUNK_TRAILER, DONE };
+
+  State state;
+  long remaining;  // identity: bytes left (-1 = until the connection closes), chunked: bytes left of the current chunk
+  std::string line;
+
+ public:
+  BodyDecoder(bool chunked, long contentLength) : state(chunked ? CHUNK_SIZE : IDENTITY), remaining(chunked ? 0 : contentLength) {
+    if (state == IDENTITY && remaining == 0) {
+      state = DONE;
+    }
+  }
+
+  bool done() const { return state == DONE; }
+  bool endsWithConnection() const { return state == IDENTITY && remaining < 0; }
+
+  // Returns false if the body is malformed or the consumer doesn't want more of it (`stopped` tells which)
+  bool feed(const char* data, size_t size, const BodyConsumer& consumer, bool& stopped) {
+    size_t i = 0;
+    while (i < size && state != DONE) {
+      switch (state) {
+        case IDENTITY: {
+          size_t n = remaining < 0 ? size - i : std::min(size - i, (size_t)remaining);
+          if (!consumer(data + i, n)) {
+            stopped = true;
+            return false;
+          }
+          i += n;
+          if (remaining >= 0) {
+            remaining -= n;
+            if (remaining == 0) {
+              state = DONE;
+            }
+          }
+          break;
+        }
+        case CHUNK_SIZE:
+          if (data[i] == '\n') {
+            char* end = nullptr;
+            remaining = strtol(line.c_str(), &end, 16);
+            if (end == line.c_str() || remaining < 0) {
+              return false;
+            }
+            line.clear();
+            state = remaining == 0 ? CHUNK_TRAILER : CHUNK_DATA;
+          } else {
+            line += data[i];
+          }
+          i++;
+          break;
+        case CHUNK_DATA: {
+          size_t n = std::min(size - i, (size_t)remaining);
+          if (!consumer(data + i, n)) {
+            stopped = true;
+            return false;
+          }
+          i += n;
+          remaining -= n;
+          if (remaining == 0) {
+            state = CHUNK_DATA_END;
+          }
+          break;
+        }
+        case CHUNK_DATA_END:
+          if (data[i++] == '\n') {
+            state = CHUNK_SIZE;
+          }
+          break;
+        case CHUNK_TRAILER:
+          if (data[i] == '\n') {
+            // An empty line ends the trailer (which is usually empty itself)
+            if (line.empty() || line == "\r") {
+              state = DONE;
+            }
+            line.clear();
+          } else {
+            line += data[i];
+          }
+          i++;
+          break;
+        case DONE:
+          break;
+      }
+    }
+    return true;
+  }
+};
+
+bool headerIs(const std::string& header, const char* name, std::string& value) {
+  size_t nameLength = strlen(name);
+  if (header.size() <= nameLength || header[nameLength] != ':' || strncasecmp(header.c_str(), name, nameLength) != 0) {
+    return false;
+  }
+  size_t start = header.find_first_not_of(" \t", nameLength + 1);
+  value = start == std::string::npos ? "" : header.substr(start);
+  return true;
+}
+
+}  // namespace
+
+HttpRequest::HttpRequest(const sockaddr_in& address, const std::string& hostHeader, int timeoutMs)
+    : address(address), hostHeader(hostHeader), timeoutMs(timeoutMs) {}
+
+bool HttpRequest::parseServerUrl(const std::string& url, sockaddr_in& address, std::string& hostHeader, std::string& error) {
+  const std::string scheme = "http://";
+  if (url.compare(0, scheme.size(), scheme) != 0) {
+    error = "only http:// server URLs are supported";
+    return false;
+  }
+
+  std::string hostPort = url.substr(scheme.size());
+  hostPort = hostPort.substr(0, hostPort.find('/'));
+  std::string host = hostPort;
+  std::string port = "80";
+  size_t colon = hostPort.rfind(':');
+  if (colon != std::string::npos) {
+    host = hostPort.substr(0, colon);
+    port = hostPort.substr(colon + 1);
+  }
+
+  addrinfo hints = {};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* resolved = nullptr;
+  int rc = getaddrinfo(host.c_str(), port.c_str(), &hints, &resolved);
+  if (rc != 0 || resolved == nullptr) {
+    error = "can't resolve " + hostPort + ": " + gai_strerror(rc);
+    return false;
+  }
+  memcpy(&address, resolved->ai_addr, sizeof(address));
+  freeaddrinfo(resolved);
+  hostHeader = hostPort;
+  return true;
+}
+
+int HttpRequest::connectSocket(std::string& error) const {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    error = std::string("socket: ") + strerror(errno);
+    return -1;
+  }
+
+  timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if (connect(fd, (const sockaddr*)&address, sizeof(address)) != 0) {
+    error = std::string("connect: ") + strerror(errno);
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+HttpResult HttpRequest::get(const std::string& path, const BodyConsumer& consumer) const { return send("GET", path, "", "", consumer); }
+
+HttpResult HttpRequest::post(const std::string& path, const std::string& contentType, const std::string& body, const BodyConsumer& consumer) const {
+  return send("POST", path, contentType, body, consumer);
+}
+
+HttpResult HttpRequest::send(const char* method, const std::string& path, const std::string& contentType, const std::string& body,
+                             const BodyConsumer& consumer) const {
+  HttpResult result;
+  int fd = connectSocket(result.error);
+  if (fd < 0) {
+    return result;
+  }
+
+  std::string request = std::string(method) + " " + path + " HTTP/1.1\r\n" +  //
+                        "Host: " + hostHeader + "\r\n" +                       //
+                        "User-Agent: ESP32HTTPClient\r\n" +                    //
+                        "Connection: close\r\n";
+  if (!contentType.empty()) {
+    request += "Content-Type: " + contentType + "\r\n";
+  }
+  if (!body.empty() || strcmp(method, "POST") == 0) {
+    request += "Content-Length: " + std::to_string(body.size()) + "\r\n";
+  }
+  request += "\r\n" + body;
+
+  for (size_t sent = 0; sent < request.size();) {
+    ssize_t n = ::send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) {
+      result.error = std::string("send: ") + (n == 0 ? "connection closed" : strerror(errno));
+      close(fd);
+      return result;
+    }
+    sent += n;
+  }
+
+  std::string head;
+  std::unique_ptr<BodyDecoder> decoder;
+  bool stopped = false;
+  char buffer[16 * 1024];
+
+  while (true) {
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n < 0) {
+      result.error = errno == EAGAIN || errno == EWOULDBLOCK ? "timeout" : std::string("recv: ") + strerror(errno);
+      break;
+    }
+    if (n == 0) {
+      if (decoder == nullptr) {
+        result.error = "connection closed before the response headers";
+      } else if (!decoder->done() && !decoder->endsWithConnection()) {
+        result.error = "truncated response body";
+      }
+      break;
+    }
+    result.bytesReceived += n;
+
+    const char* data = buffer;
+    size_t size = n;
+    if (decoder == nullptr) {
+      head.append(buffer, n);
+      size_t end = head.find("\r\n\r\n");
+      if (end == std::string::npos) {
+        continue;
+      }
+
+      // Status line and the headers the body framing depends on
+      if (sscanf(head.c_str(), "HTTP/%*d.%*d %d", &result.status) != 1) {
+        result.error = "malformed status line";
+        break;
+      }
+      bool chunked = false;
+      long contentLength = -1;
+      size_t lineStart = head.find("\r\n") + 2;
+      while (lineStart < end) {
+        size_t lineEnd = head.find("\r\n", lineStart);
+        std::string header = head.substr(lineStart, lineEnd - lineStart);
+        std::string value;
+        if (headerIs(header, "Content-Length", value)) {
+          contentLength = strtol(value.c_str(), nullptr, 10);
+        } else if (headerIs(header, "Transfer-Encoding", value)) {
+          chunked = strcasestr(value.c_str(), "chunked") != nullptr;
+        }
+        lineStart = lineEnd + 2;
+      }
+
+      decoder.reset(new BodyDecoder(chunked, contentLength));
+      data = buffer + n - (head.size() - end - 4);
+      size = head.size() - end - 4;
+    }
+
+    if (!decoder->feed(data, size, consumer, stopped)) {
+      if (!stopped) {
+        result.error = "malformed chunked encoding";
+      }
+      break;
+    }
+    if (decoder->done()) {
+      break;
+    }
+  }
+
+  close(fd);
+  return result;
+}
@@ -0,0 +1,40 @@
+#ifndef HTTP_REQUEST_H
+#define HTTP_REQUEST_H
+
+#include <netinet/in.h>
+
+#include <functional>
+#include <string>
+
+// Receives the response body as it arrives (chunked encoding already removed). Returning false drops the connection, the
+// same as the device does once it sees an unchanged checksum.
+typedef std::function<bool(const char* data, size_t size)> BodyConsumer;
+
+struct HttpResult {
+  int status = 0;
+  size_t bytesReceived = 0;  // headers included
+  std::string error;         // empty = the exchange completed (whatever the status code)
+};
+
+// Minimal blocking HTTP/1.1 client, one connection per request ("Connection: close"), like a device waking up
+class HttpRequest {
+ private:
+  sockaddr_in address;
+  std::string hostHeader;
+  int timeoutMs;
+
+  int connectSocket(std::string& error) const;
+
+ public:
+  HttpRequest(const sockaddr_in& address, const std::string& hostHeader, int timeoutMs);
+
+  // Resolves "http://host[:port]" (IPv4 only), returns false with an error message if it's not usable
+  static bool parseServerUrl(const std::string& url, sockaddr_in& address, std::string& hostHeader, std::string& error);
+
+  HttpResult get(const std::string& path, const BodyConsumer& consumer) const;
+  HttpResult post(const std::string& path, const std::string& contentType, const std::string& body, const BodyConsumer& consumer) const;
+  HttpResult send(const char* method, const std::string& path, const std::string& contentType, const std::string& body,
+                  const BodyConsumer& consumer) const;
+};
+
+#endif  // HTTP_REQUEST_H
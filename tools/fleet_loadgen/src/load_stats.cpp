@@ -0,0 +1,62 @@
+#include "load_stats.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LoadStats::record(const std::string& endpoint, double latencyMs, uint64_t bytes, const std::string& error) {
+  std::lock_guard<std::mutex> lock(mutex);
+  Endpoint& stats = endpoints[endpoint];
+  stats.requests++;
+  stats.bytes += bytes;
+  if (error.empty()) {
+    stats.latenciesMs.push_back(latencyMs);
+  } else {
+    stats.errors++;
+    stats.errorKinds[error]++;
+  }
+}
+
+double LoadStats::errorRate(const std::string& endpoint) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto found = endpoints.find(endpoint);
+  if (found == endpoints.end() || found->second.requests == 0) {
+    return 0;
+  }
+  return 100.0 * found->second.errors / found->second.requests;
+}
+
+// Nearest-rank percentile
+double LoadStats::percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+  return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+}
+
+void LoadStats::print(FILE* out, double elapsedSeconds) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  fprintf(out, "%-18s %8s %8s %7s %9s %9s %9s %9s %9s %10s\n", "endpoint", "requests", "req/s", "errors", "p50 ms", "p90 ms", "p99 ms",
+          "max ms", "avg ms", "MB/s");
+  for (auto& entry : endpoints) {
+    Endpoint& stats = entry.second;
+    std::vector<double> sorted = stats.latenciesMs;
+    std::sort(sorted.begin(), sorted.end());
+    double sum = 0;
+    for (double latency : sorted) {
+      sum += latency;
+    }
+
+    fprintf(out, "%-18s %8llu %8.2f %6.2f%% %9.1f %9.1f %9.1f %9.1f %9.1f %10.3f\n", entry.first.c_str(), (unsigned long long)stats.requests,
+            stats.requests / elapsedSeconds, stats.requests == 0 ? 0 : 100.0 * stats.errors / stats.requests, percentile(sorted, 50),
+            percentile(sorted, 90), percentile(sorted, 99), sorted.empty() ? 0 : sorted.back(), sorted.empty() ? 0 : sum / sorted.size(),
+            stats.bytes / elapsedSeconds / 1e6);
+  }
+
+  for (const auto& entry : endpoints) {
+    for (const auto& kind : entry.second.errorKinds) {
+      fprintf(out, "  %s: %llu x %s\n", entry.first.c_str(), (unsigned long long)kind.second, kind.first.c_str());
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#ifndef LOAD_STATS_H
+#define LOAD_STATS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Latencies, byte counts and errors per endpoint, shared by all the simulated devices
+class LoadStats {
+ private:
+  struct Endpoint {
+    std::vector<double> latenciesMs;  // successful requests only, errors would skew them towards the timeout
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t bytes = 0;
+    std::map<std::string, uint64_t> errorKinds;
+  };
+
+  std::mutex mutex;
+  std::map<std::string, Endpoint> endpoints;
+
+  static double percentile(const std::vector<double>& sorted, double p);
+
+ public:
+  // An empty error means the request succeeded
+  void record(const std::string& endpoint, double latencyMs, uint64_t bytes, const std::string& error);
+
+  // Failed requests of the endpoint in percent
+  double errorRate(const std::string& endpoint);
+
+  void print(FILE* out, double elapsedSeconds);
+};
+
+#endif  // LOAD_STATS_H
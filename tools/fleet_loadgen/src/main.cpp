@@ -0,0 +1,258 @@
+// Fleet load generator: simulates many displays waking up against one server and reports how the server copes.
+// See README.md next to this file.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "device_protocol.h"
+#include "http_request.h"
+#include "load_stats.h"
+#include "simulated_device.h"
+#include "stand_in_server.h"
+
+// Sleep after a failed config request, same as SLEEP_TIME_TEMPORARY_ERROR in the firmware (but in seconds of this run)
+#define FAILED_WAKEUP_SLEEP_SECONDS 300
+
+typedef std::chrono::steady_clock Clock;
+
+struct FleetOptions {
+  std::string serverUrl = "http://localhost:5000";
+  int devices = 100;
+  double durationSeconds = 60;
+  int intervalSeconds = 0;    // 0 = sleep as long as the server says
+  double spreadSeconds = 0;   // first wakeups are spread over this time, 0 = all at once (e.g. after a power cut)
+  int concurrency = 0;        // 0 = one connection per device
+  int timeoutMs = 30000;
+  std::string macPrefix = "02:4C:47";  // locally administered, won't clash with a real ESP32
+  unsigned int seed = 1;
+  double maxErrorRate = 100;  // failed wakeups in percent, above this the exit code is 1
+  bool standIn = false;
+  int standInPort = 0;
+};
+
+struct Wakeup {
+  Clock::time_point at;
+  size_t device;
+
+  bool operator>(const Wakeup& other) const { return at > other.at; }
+};
+
+static void usage(const char* program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "\n"
+          "  --server URL            server to load (default http://localhost:5000)\n"
+          "  --devices N             number of simulated displays (default 100)\n"
+          "  --duration S            no new wakeups are started after S seconds (default 60)\n"
+          "  --interval S            sleep between wakeups, 0 = as the server says (default 0)\n"
+          "  --spread S              spread the first wakeups over S seconds, 0 = all at once (default 0)\n"
+          "  --concurrency N         max. devices awake at the same time, 0 = no limit (default 0)\n"
+          "  --timeout-ms MS         socket timeout (default 30000)\n"
+          "  --size WxH              display size (default 800x480)\n"
+          "  --color TYPE            BW, 4G, 3C, 4C or 7C (default BW)\n"
+          "  --firmware VERSION      firmware version reported in the telemetry (default 0.0.0-loadgen)\n"
+          "  --mac-prefix XX:XX:XX   first 3 bytes of the generated MACs (default 02:4C:47)\n"
+          "  --no-schedule           don't download the frame schedule even if the server offers it\n"
+          "  --seed N                seed of the wakeup spread (default 1)\n"
+          "  --max-error-rate PCT    exit with 1 if more wakeups failed (default 100)\n"
+          "\n"
+          "  --stand-in              start a built-in stand-in server and load it instead of --server\n"
+          "  --stand-in-port P       its port (default: any free one)\n"
+          "  --stand-in-sleep S      sleep it sends to the devices (default 60)\n"
+          "  --stand-in-change S     its frame changes every S seconds (default 300)\n"
+          "  --stand-in-render-ms MS delay added to each bitmap request (default 0)\n"
+          "  --stand-in-schedule N   frames it offers for the frame schedule (default 0)\n",
+          program);
+}
+
+static bool parseArguments(int argc, char** argv, FleetOptions& options, DeviceProfile& profile, StandInOptions& standIn) {
+  for (int i = 1; i < argc; i++) {
+    std::string name = argv[i];
+    if (name == "--no-schedule") {
+      profile.frameSchedule = false;
+      continue;
+    }
+    if (name == "--stand-in") {
+      options.standIn = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      return false;
+    }
+    const char* value = argv[++i];
+
+    if (name == "--server") {
+      options.serverUrl = value;
+    } else if (name == "--devices") {
+      options.devices = atoi(value);
+    } else if (name == "--duration") {
+      options.durationSeconds = atof(value);
+    } else if (name == "--interval") {
+      options.intervalSeconds = atoi(value);
+    } else if (name == "--spread") {
+      options.spreadSeconds = atof(value);
+    } else if (name == "--concurrency") {
+      options.concurrency = atoi(value);
+    } else if (name == "--timeout-ms") {
+      options.timeoutMs = atoi(value);
+    } else if (name == "--size") {
+      if (sscanf(value, "%dx%d", &profile.width, &profile.height) != 2) {
+        return false;
+      }
+    } else if (name == "--color") {
+      profile.colorType = value;
+    } else if (name == "--firmware") {
+      profile.firmware = value;
+    } else if (name == "--mac-prefix") {
+      options.macPrefix = value;
+    } else if (name == "--seed") {
+      options.seed = (unsigned int)atol(value);
+    } else if (name == "--max-error-rate") {
+      options.maxErrorRate = atof(value);
+    } else if (name == "--stand-in-port") {
+      options.standInPort = atoi(value);
+    } else if (name == "--stand-in-sleep") {
+      standIn.sleepSeconds = atoi(value);
+    } else if (name == "--stand-in-change") {
+      standIn.frameChangeSeconds = atoi(value);
+    } else if (name == "--stand-in-render-ms") {
+      standIn.renderDelayMs = atoi(value);
+    } else if (name == "--stand-in-schedule") {
+      standIn.scheduleFrames = atoi(value);
+    } else {
+      return false;
+    }
+  }
+
+  if (options.devices <= 0 || options.devices > 0xffffff || options.durationSeconds <= 0 || profile.width <= 0 || profile.height <= 0) {
+    return false;
+  }
+  if (bitmapBytesPerRow(profile.colorType.c_str(), profile.width) == 0) {
+    fprintf(stderr, "Unknown color type %s\n", profile.colorType.c_str());
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  FleetOptions options;
+  DeviceProfile profile;
+  StandInOptions standInOptions;
+  if (!parseArguments(argc, argv, options, profile, standInOptions)) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  StandInServer standIn(profile, standInOptions);
+  if (options.standIn) {
+    int port = standIn.start(options.standInPort);
+    if (port < 0) {
+      fprintf(stderr, "Can't start the stand-in server\n");
+      return 2;
+    }
+    options.serverUrl = "http://127.0.0.1:" + std::to_string(port);
+  }
+
+  sockaddr_in address;
+  std::string hostHeader, error;
+  if (!HttpRequest::parseServerUrl(options.serverUrl, address, hostHeader, error)) {
+    fprintf(stderr, "Invalid server URL %s: %s\n", options.serverUrl.c_str(), error.c_str());
+    return 2;
+  }
+  HttpRequest http(address, hostHeader, options.timeoutMs);
+  LoadStats stats;
+
+  std::vector<std::unique_ptr<SimulatedDevice>> devices;
+  std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup>> queue;
+  std::mt19937 random(options.seed);
+  std::uniform_real_distribution<double> spread(0, options.spreadSeconds);
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.durationSeconds));
+
+  for (int i = 0; i < options.devices; i++) {
+    char mac[32];
+    snprintf(mac, sizeof(mac), "%s:%02X:%02X:%02X", options.macPrefix.c_str(), (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff);
+    devices.emplace_back(new SimulatedDevice(mac, profile, http, stats));
+    Clock::duration offset = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.spreadSeconds > 0 ? spread(random) : 0));
+    queue.push({start + offset, (size_t)i});
+  }
+
+  int workers = options.concurrency > 0 ? std::min(options.concurrency, options.devices) : options.devices;
+  printf("%d devices (%s %dx%d) against %s, %d at once at most, %g s\n", options.devices, profile.colorType.c_str(), profile.width,
+         profile.height, options.serverUrl.c_str(), workers, options.durationSeconds);
+  fflush(stdout);
+
+  // Each worker is one radio: it takes the next due wakeup, runs it and puts the device back with its new wakeup time.
+  // A device is never awake twice at once because it's only queued again after its wakeup ends.
+  std::mutex mutex;
+  std::condition_variable changed;
+  auto worker = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      if (queue.empty()) {
+        if (changed.wait_until(lock, end) == std::cv_status::timeout) {
+          break;
+        }
+        continue;
+      }
+      Wakeup next = queue.top();
+      if (next.at >= end) {
+        break;
+      }
+      if (Clock::now() < next.at) {
+        changed.wait_until(lock, next.at);
+        continue;
+      }
+      queue.pop();
+      lock.unlock();
+
+      // How late the device woke up because all workers were busy, the server looks faster than it is when this grows
+      stats.record("wakeup start lag", std::chrono::duration<double, std::milli>(Clock::now() - next.at).count(), 0, "");
+      int sleepSeconds = devices[next.device]->wake();
+      if (options.intervalSeconds > 0) {
+        sleepSeconds = options.intervalSeconds;
+      } else if (sleepSeconds <= 0) {
+        sleepSeconds = FAILED_WAKEUP_SLEEP_SECONDS;
+      }
+
+      lock.lock();
+      queue.push({Clock::now() + std::chrono::seconds(sleepSeconds), next.device});
+      changed.notify_all();
+    }
+    changed.notify_all();
+  };
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < workers; i++) {
+    threads.emplace_back(worker);
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  standIn.stop();
+
+  // The rates are per the whole run even if the last wakeups ended early (the next ones were due after the end)
+  printf("\nFinished in %.1f s\n\n", elapsed);
+  stats.print(stdout, std::max(elapsed, options.durationSeconds));
+
+  double errorRate = stats.errorRate("wakeup");
+  if (errorRate > options.maxErrorRate) {
+    printf("\n%.2f%% of the wakeups failed, more than the allowed %.2f%%\n", errorRate, options.maxErrorRate);
+    return 1;
+  }
+  return 0;
+}
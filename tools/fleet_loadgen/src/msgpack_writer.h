@@ -0,0 +1,78 @@
+#ifndef MSGPACK_WRITER_H
+#define MSGPACK_WRITER_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+// Builds a flat MessagePack map the way ArduinoJson serializes the device telemetry (strings, integers, float32 values)
+class MsgPackMap {
+ private:
+  std::string entries;
+  size_t count = 0;
+
+  void putBigEndian(uint64_t value, int bytes) {
+    for (int i = bytes - 1; i >= 0; i--) {
+      entries += (char)((value >> (i * 8)) & 0xff);
+    }
+  }
+
+  void putString(const char* value) {
+    size_t length = strlen(value);
+    if (length < 32) {
+      entries += (char)(0xa0 | length);
+    } else {
+      entries += (char)0xd9;
+      putBigEndian(length, 1);
+    }
+    entries.append(value, length);
+  }
+
+ public:
+  void add(const char* key, const char* value) {
+    putString(key);
+    putString(value);
+    count++;
+  }
+
+  void add(const char* key, int64_t value) {
+    putString(key);
+    if (value >= 0 && value < 128) {
+      entries += (char)value;
+    } else if (value >= -32 && value < 0) {
+      entries += (char)(int8_t)value;
+    } else if (value >= 0 && value <= 0xffffffffLL) {
+      entries += (char)0xce;
+      putBigEndian(value, 4);
+    } else {
+      entries += (char)0xd3;
+      putBigEndian((uint64_t)value, 8);
+    }
+    count++;
+  }
+
+  void add(const char* key, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putString(key);
+    entries += (char)0xca;
+    putBigEndian(bits, 4);
+    count++;
+  }
+
+  // The whole map, fixmap or map16 header included
+  std::string serialize() const {
+    std::string header;
+    if (count < 16) {
+      header += (char)(0x80 | count);
+    } else {
+      header += (char)0xde;
+      header += (char)(count >> 8);
+      header += (char)(count & 0xff);
+    }
+    return header + entries;
+  }
+};
+
+#endif  // MSGPACK_WRITER_H
@@ -0,0 +1,314 @@
+#include "simulated_device.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+
+#include "device_protocol.h"
+#include "http_request.h"
+#include "load_stats.h"
+#include "msgpack_writer.h"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double millisSince(Clock::time_point start) { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); }
+
+// Parses a v3 bitmap as it arrives, without decoding the rows. Stops after the header when the checksum or the frame hash
+// is unchanged, the device doesn't read the rest either.
+class BitmapV3Parser {
+ private:
+  const DeviceProfile& profile;
+  const std::string& lastChecksum;
+  uint64_t lastFrameHash;
+
+  std::string headerData;
+  bool headerDone = false;
+  uint32_t extraHeaderLeft = 0;  // fields added by a newer server, skipped like the device does
+  uint32_t payloadRead = 0;
+
+ public:
+  BitmapV3Header header = {};
+  std::string error;
+  bool unchanged = false;
+
+  BitmapV3Parser(const DeviceProfile& profile, const std::string& lastChecksum, uint64_t lastFrameHash)
+      : profile(profile), lastChecksum(lastChecksum), lastFrameHash(lastFrameHash) {}
+
+  bool complete() const { return error.empty() && (unchanged || (headerDone && extraHeaderLeft == 0 && payloadRead == header.payloadLength)); }
+
+  bool feed(const char* data, size_t size) {
+    if (!headerDone) {
+      size_t n = std::min(size, (size_t)(BITMAP_V3_HEADER_SIZE - headerData.size()));
+      headerData.append(data, n);
+      data += n;
+      size -= n;
+      if (headerData.size() < BITMAP_V3_HEADER_SIZE) {
+        return true;
+      }
+      headerDone = true;
+
+      const char* invalid = nullptr;
+      if (!parseBitmapV3Header((const uint8_t*)headerData.data(), header)) {
+        invalid = "invalid bitmap header";
+      } else {
+        extraHeaderLeft = header.headerSize - BITMAP_V3_HEADER_SIZE;
+        int rowBytes = bitmapBytesPerRow(profile.colorType.c_str(), profile.width);
+        invalid = validateBitmapV3Header(header, profile.width, profile.height, rowBytes * 8 / profile.width, 0, DEVICE_CAPABILITIES);
+      }
+      if (invalid != nullptr) {
+        error = invalid;
+        return false;
+      }
+      if (header.checksum == lastChecksum || header.frameHash == lastFrameHash) {
+        unchanged = true;
+        return false;
+      }
+    }
+
+    size_t skip = std::min(size, (size_t)extraHeaderLeft);
+    extraHeaderLeft -= skip;
+    size -= skip;
+    payloadRead += size;
+    if (payloadRead > header.payloadLength) {
+      error = "more data than the header says";
+      return false;
+    }
+    return true;
+  }
+};
+
+// Parses a frame schedule bundle of v2 bitmaps ("MM\n" + checksum + "\n" + rows) as it arrives, without keeping the pixels
+class FrameStreamParser {
+ private:
+  enum State { SCHEDULE_MAGIC, SCHEDULE_HEADER, FRAME_TIME, MAGIC, CHECKSUM, ROWS, DONE };
+
+  State state;
+  size_t frameBytes;
+  int requested;
+
+  std::string line;
+  size_t rowBytesRead = 0;
+  unsigned int framesExpected = 1;
+  unsigned int framesRead = 0;
+
+  bool headerLine() {
+    switch (state) {
+      case SCHEDULE_MAGIC:
+        if (line != FRAME_SCHEDULE_MAGIC) {
+          error = "invalid frame schedule magic";
+          return false;
+        }
+        state = SCHEDULE_HEADER;
+        break;
+      case SCHEDULE_HEADER: {
+        uint32_t validUntil = 0;
+        if (!parseFrameScheduleHeader(line.c_str(), requested, framesExpected, validUntil)) {
+          error = "invalid frame schedule header";
+          return false;
+        }
+        state = framesExpected == 0 ? DONE : FRAME_TIME;
+        break;
+      }
+      case FRAME_TIME:
+        state = MAGIC;
+        break;
+      case MAGIC:
+        if (line != BITMAP_V2_MAGIC) {
+          error = "invalid bitmap magic";
+          return false;
+        }
+        state = CHECKSUM;
+        break;
+      case CHECKSUM:
+        rowBytesRead = 0;
+        state = ROWS;
+        break;
+      case ROWS:
+      case DONE:
+        break;
+    }
+    return true;
+  }
+
+ public:
+  std::string error;
+
+  FrameStreamParser(size_t frameBytes, int requested) : state(SCHEDULE_MAGIC), frameBytes(frameBytes), requested(requested) {}
+
+  bool complete() const { return state == DONE && error.empty(); }
+
+  bool feed(const char* data, size_t size) {
+    for (size_t i = 0; i < size;) {
+      if (state == ROWS) {
+        size_t n = std::min(size - i, frameBytes - rowBytesRead);
+        i += n;
+        rowBytesRead += n;
+        if (rowBytesRead == frameBytes) {
+          framesRead++;
+          state = framesRead == framesExpected ? DONE : FRAME_TIME;
+        }
+        continue;
+      }
+      if (state == DONE) {
+        error = "more data than the display size";
+        return false;
+      }
+
+      char c = data[i++];
+      if (c == '\n') {
+        if (!headerLine()) {
+          return false;
+        }
+        line.clear();
+      } else if (c != '\r') {
+        line += c;
+        if (line.size() > 128) {
+          error = "header line too long";
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+};
+
+// Top level number (or boolean) of the config response, a full JSON parser would be overkill for a handful of keys
+bool jsonValue(const std::string& json, const char* key, long long& value) {
+  std::string pattern = std::string("\"") + key + "\":";
+  size_t position = json.find(pattern);
+  if (position == std::string::npos) {
+    return false;
+  }
+  const char* start = json.c_str() + position + pattern.size();
+  while (*start == ' ') {
+    start++;
+  }
+  if (strncmp(start, "true", 4) == 0 || strncmp(start, "false", 5) == 0) {
+    value = *start == 't';
+    return true;
+  }
+  char* end = nullptr;
+  value = strtoll(start, &end, 10);
+  return end != start;
+}
+
+}  // namespace
+
+SimulatedDevice::SimulatedDevice(const std::string& mac, const DeviceProfile& profile, const HttpRequest& http, LoadStats& stats)
+    : mac(mac), profile(profile), http(http), stats(stats) {}
+
+int SimulatedDevice::wake() {
+  Clock::time_point start = Clock::now();
+  int sleepSeconds = 0;
+
+  bool ok = loadConfig(sleepSeconds) && loadBitmap();
+  if (ok && profile.frameSchedule && scheduleFrameCount > 0) {
+    ok = loadFrameSchedule();
+  }
+
+  wakeups++;
+  stats.record("wakeup", millisSince(start), 0, ok ? "" : "failed");
+  return sleepSeconds;
+}
+
+bool SimulatedDevice::loadConfig(int& sleepSeconds) {
+  // Same keys as HTTPClientManager::loadConfigFromWeb(), with plausible values
+  MsgPackMap telemetry;
+  telemetry.add("ver", (int64_t)TELEMETRY_VERSION);
+  telemetry.add("mac", mac.c_str());
+  telemetry.add("fw", profile.firmware.c_str());
+  telemetry.add("c", profile.colorType.c_str());
+  telemetry.add("adc", (int64_t)2400);
+  telemetry.add("v", 3.95f);
+  telemetry.add("reset", wakeups == 0 ? "POWERON" : "DEEPSLEEP");
+  telemetry.add("wakeup", wakeups == 0 ? "UNDEFINED" : "TIMER");
+  telemetry.add("rssi", (int64_t)-60);
+  telemetry.add("heap", (int64_t)200000);
+  telemetry.add("minheap", (int64_t)180000);
+  telemetry.add("wifi", (int64_t)900);
+  telemetry.add("up", (int64_t)1500);
+  if (!staticTelemetrySent) {
+    telemetry.add("w", (int64_t)profile.width);
+    telemetry.add("h", (int64_t)profile.height);
+    telemetry.add("rot", (int64_t)0);
+    telemetry.add("vmin", 3.3f);
+    telemetry.add("vmax", 4.2f);
+    telemetry.add("vlmin", 3.5f);
+    telemetry.add("vlmax", 4.1f);
+  }
+
+  std::string response;
+  Clock::time_point start = Clock::now();
+  HttpResult result = http.post(DEVICE_API_CONFIG_PATH, "application/msgpack", telemetry.serialize(), [&](const char* data, size_t size) {
+    response.append(data, size);
+    return true;
+  });
+
+  std::string error = result.error;
+  if (error.empty() && result.status != 200) {
+    error = "HTTP " + std::to_string(result.status);
+  }
+  long long sleep = 0, now = 0, nextChange = 0, resendStatic = 0, schedule = 0;
+  if (error.empty() && !jsonValue(response, "sleep", sleep)) {
+    error = "no sleep in the response";
+  }
+  stats.record("config", millisSince(start), result.bytesReceived, error);
+  if (!error.empty()) {
+    return false;
+  }
+
+  // Same precedence as the firmware: the absolute wakeup time wins over the relative sleep
+  sleepSeconds = (int)sleep;
+  if (jsonValue(response, "now", now) && jsonValue(response, "next_change", nextChange) && now != 0 && nextChange > now) {
+    sleepSeconds = (int)(nextChange - now);
+  }
+  staticTelemetrySent = !(jsonValue(response, "resend_static", resendStatic) && resendStatic);
+  scheduleFrameCount = jsonValue(response, "schedule", schedule) ? (int)schedule : 0;
+  return true;
+}
+
+bool SimulatedDevice::loadBitmap() {
+  char path[DEVICE_API_MAX_PATH];
+  buildBitmapPath(path, sizeof(path), mac.c_str(), 0, DEVICE_CAPABILITIES);
+
+  BitmapV3Parser parser(profile, lastChecksum, lastFrameHash);
+  Clock::time_point start = Clock::now();
+  HttpResult result = http.get(path, [&](const char* data, size_t size) { return parser.feed(data, size); });
+
+  std::string error = result.error;
+  if (error.empty() && result.status != 200) {
+    error = "HTTP " + std::to_string(result.status);
+  } else if (error.empty() && !parser.complete()) {
+    error = parser.error.empty() ? "incomplete bitmap" : parser.error;
+  }
+  stats.record(parser.unchanged ? "bitmap unchanged" : "bitmap", millisSince(start), result.bytesReceived, error);
+  if (!error.empty()) {
+    return false;
+  }
+
+  lastChecksum = parser.header.checksum;
+  lastFrameHash = parser.header.frameHash;
+  return true;
+}
+
+bool SimulatedDevice::loadFrameSchedule() {
+  char path[DEVICE_API_MAX_PATH];
+  buildFrameSchedulePath(path, sizeof(path), mac.c_str(), scheduleFrameCount);
+
+  FrameStreamParser parser((size_t)bitmapBytesPerRow(profile.colorType.c_str(), profile.width) * profile.height, scheduleFrameCount);
+  Clock::time_point start = Clock::now();
+  HttpResult result = http.get(path, [&](const char* data, size_t size) { return parser.feed(data, size); });
+
+  std::string error = result.error;
+  if (error.empty() && result.status != 200) {
+    error = "HTTP " + std::to_string(result.status);
+  } else if (error.empty() && !parser.complete()) {
+    error = parser.error.empty() ? "incomplete frame schedule" : parser.error;
+  }
+  stats.record("schedule", millisSince(start), result.bytesReceived, error);
+  return error.empty();
+}
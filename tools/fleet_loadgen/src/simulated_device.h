@@ -0,0 +1,47 @@
+#ifndef SIMULATED_DEVICE_H
+#define SIMULATED_DEVICE_H
+
+#include <stdint.h>
+
+#include <string>
+
+class HttpRequest;
+class LoadStats;
+
+// Hardware the simulated devices claim to have, sent in the static part of the telemetry
+struct DeviceProfile {
+  std::string colorType = "BW";
+  int width = 800;
+  int height = 480;
+  std::string firmware = "0.0.0-loadgen";
+  bool frameSchedule = true;  // fetch the scheduled frames when the server offers them
+};
+
+// One display replaying what the firmware does during a wakeup (see HTTPClientManager): POST the telemetry to the config
+// endpoint, download the fmt=3 bitmap unless its checksum or frame hash matches the displayed one, then the frame schedule
+// bundle if the server offers one. Each request goes over a new connection, like after a deep sleep.
+class SimulatedDevice {
+ private:
+  std::string mac;
+  const DeviceProfile& profile;
+  const HttpRequest& http;
+  LoadStats& stats;
+
+  std::string lastChecksum;
+  uint64_t lastFrameHash = 0;
+  bool staticTelemetrySent = false;
+  int scheduleFrameCount = 0;
+  uint32_t wakeups = 0;
+
+  bool loadConfig(int& sleepSeconds);
+  bool loadBitmap();
+  bool loadFrameSchedule();
+
+ public:
+  SimulatedDevice(const std::string& mac, const DeviceProfile& profile, const HttpRequest& http, LoadStats& stats);
+
+  // Runs one wakeup, returns the sleep the server asked for (0 if the config request failed)
+  int wake();
+};
+
+#endif  // SIMULATED_DEVICE_H
@@ -0,0 +1,243 @@
+#include "stand_in_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "device_protocol.h"
+#include "frame_hash.h"
+#include "packbits.h"
+
+namespace {
+
+std::string queryParam(const std::string& query, const char* name) {
+  std::string pattern = std::string(name) + "=";
+  size_t position = 0;
+  while ((position = query.find(pattern, position)) != std::string::npos) {
+    if (position == 0 || query[position - 1] == '&') {
+      size_t start = position + pattern.size();
+      return query.substr(start, query.find('&', start) - start);
+    }
+    position++;
+  }
+  return "";
+}
+
+std::string httpResponse(int status, const char* reason, const char* contentType, const std::string& body) {
+  return "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n" +  //
+         "Content-Type: " + contentType + "\r\n" +                        //
+         "Content-Length: " + std::to_string(body.size()) + "\r\n" +      //
+         "Connection: close\r\n\r\n" + body;
+}
+
+}  // namespace
+
+StandInServer::StandInServer(const DeviceProfile& profile, const StandInOptions& options) : profile(profile), options(options) {}
+
+StandInServer::~StandInServer() { stop(); }
+
+int StandInServer::start(int port) {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    return -1;
+  }
+  int one = 1;
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  socklen_t length = sizeof(address);
+  if (bind(listenFd, (sockaddr*)&address, sizeof(address)) != 0 || listen(listenFd, 1024) != 0 ||
+      getsockname(listenFd, (sockaddr*)&address, &length) != 0) {
+    close(listenFd);
+    listenFd = -1;
+    return -1;
+  }
+
+  acceptThread = std::thread(&StandInServer::acceptLoop, this);
+  return ntohs(address.sin_port);
+}
+
+void StandInServer::stop() {
+  if (listenFd < 0) {
+    return;
+  }
+  stopping = true;
+  shutdown(listenFd, SHUT_RDWR);
+  close(listenFd);
+  listenFd = -1;
+  if (acceptThread.joinable()) {
+    acceptThread.join();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this] { return activeConnections == 0; });
+}
+
+void StandInServer::acceptLoop() {
+  while (!stopping) {
+    int fd = accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    activeConnections++;
+    std::thread(&StandInServer::handleConnection, this, fd).detach();
+  }
+}
+
+void StandInServer::handleConnection(int fd) {
+  timeval timeout = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  // Request line and headers, then as much of the body as Content-Length says (the telemetry isn't looked at)
+  std::string request;
+  char buffer[4096];
+  size_t headEnd = std::string::npos;
+  size_t expected = 0;
+  while (headEnd == std::string::npos || request.size() < expected) {
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      break;
+    }
+    request.append(buffer, n);
+    if (headEnd == std::string::npos && (headEnd = request.find("\r\n\r\n")) != std::string::npos) {
+      const char* contentLength = strcasestr(request.c_str(), "\r\nContent-Length:");
+      expected = headEnd + 4 + (contentLength != nullptr && contentLength < request.c_str() + headEnd ? strtoul(contentLength + 17, nullptr, 10) : 0);
+    }
+  }
+
+  if (headEnd != std::string::npos) {
+    std::string requestLine = request.substr(0, request.find("\r\n"));
+    size_t space = requestLine.find(' ');
+    std::string method = requestLine.substr(0, space);
+    std::string path = requestLine.substr(space + 1, requestLine.find(' ', space + 1) - space - 1);
+
+    std::string response = respond(method, path);
+    for (size_t sent = 0; sent < response.size();) {
+      // The device drops the connection after an unchanged checksum, that's not an error
+      ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) {
+        break;
+      }
+      sent += n;
+    }
+    shutdown(fd, SHUT_WR);
+  }
+  close(fd);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  activeConnections--;
+  idle.notify_all();
+}
+
+std::string StandInServer::respond(const std::string& method, const std::string& path) {
+  size_t questionMark = path.find('?');
+  std::string endpoint = path.substr(0, questionMark);
+  std::string query = questionMark == std::string::npos ? "" : path.substr(questionMark + 1);
+  long now = (long)time(nullptr);
+
+  if (method == "POST" && endpoint == DEVICE_API_CONFIG_PATH) {
+    char json[256];
+    snprintf(json, sizeof(json), "{\"sleep\":%d,\"now\":%ld,\"next_change\":%ld,\"resend_static\":false,\"schedule\":%d,\"ota_mode\":false}",
+             options.sleepSeconds, now, now + options.sleepSeconds, options.scheduleFrames);
+    return httpResponse(200, "OK", "application/json; charset=utf-8", json);
+  }
+
+  if (method != "GET" || queryParam(query, "mac").empty()) {
+    return httpResponse(404, "Not Found", "application/json", "{\"error\":\"Display not found\"}");
+  }
+
+  if (endpoint == DEVICE_API_BITMAP_PATH) {
+    if (options.renderDelayMs > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(options.renderDelayMs));
+    }
+    long epoch = now / std::max(options.frameChangeSeconds, 1);
+    long firstRow = atol(queryParam(query, "row").c_str());
+    if (queryParam(query, "fmt") != "3" || firstRow < 0 || firstRow >= profile.height) {
+      return httpResponse(400, "Bad Request", "application/json", "{\"error\":\"Only fmt=3 is supported\"}");
+    }
+    return httpResponse(200, "OK", "application/octet-stream", frameV3(epoch, firstRow, strtoul(queryParam(query, "caps").c_str(), nullptr, 10)));
+  }
+
+  if (endpoint == DEVICE_API_SCHEDULE_PATH) {
+    int count = std::min(atoi(queryParam(query, "count").c_str()), options.scheduleFrames);
+    std::string body = std::string(FRAME_SCHEDULE_MAGIC) + "\n" + std::to_string(std::max(count, 0)) + " " +
+                       std::to_string(now + (long)(count + 1) * options.sleepSeconds) + "\n";
+    for (int i = 1; i <= count; i++) {
+      long displayAt = now + (long)i * options.sleepSeconds;
+      char checksum[32];
+      snprintf(checksum, sizeof(checksum), "s%015lx", (unsigned long)displayAt);
+      body += std::to_string(displayAt) + "\n" + frame(displayAt, checksum);
+    }
+    return httpResponse(200, "OK", "application/octet-stream", body);
+  }
+
+  return httpResponse(404, "Not Found", "application/json", "{\"error\":\"Unknown endpoint\"}");
+}
+
+// Rows with a stripe which moves with every new frame
+std::string StandInServer::frameRows(long epoch) {
+  int rowBytes = bitmapBytesPerRow(profile.colorType.c_str(), profile.width);
+  std::string rows;
+  for (long row = 0; row < profile.height; row++) {
+    rows.append(rowBytes, (row + epoch) % 64 < 8 ? '\xff' : '\0');
+  }
+  return rows;
+}
+
+// A v2 bitmap, as used in the frame schedule
+std::string StandInServer::frame(long epoch, const char* checksum) {
+  return std::string(BITMAP_V2_MAGIC) + "\n" + checksum + "\n" + frameRows(epoch);
+}
+
+// A v3 bitmap from `firstRow` on, PackBits-encoded if the device can decode it (like the server, which only does it when
+// it's smaller, but these rows always are)
+std::string StandInServer::frameV3(long epoch, long firstRow, unsigned int capabilities) {
+  int rowBytes = bitmapBytesPerRow(profile.colorType.c_str(), profile.width);
+  std::string rows = frameRows(epoch);
+
+  BitmapV3Header header = {};
+  header.width = profile.width;
+  header.height = profile.height;
+  header.bitsPerPixel = rowBytes * 8 / profile.width;
+  header.encoding = capabilities & DEVICE_CAPS_PACKBITS_ROWS ? BITMAP_ENCODING_PACKBITS_ROWS : BITMAP_ENCODING_RAW;
+  header.firstRow = firstRow;
+  header.rowCount = profile.height - firstRow;
+  header.frameHash = FRAME_HASH_INIT;
+  for (long row = 0; row < profile.height; row++) {
+    header.frameHash = frameHashAddRow(header.frameHash, (const uint8_t*)rows.data() + row * rowBytes, rowBytes);
+  }
+  snprintf(header.checksum, sizeof(header.checksum), "%040lx", (unsigned long)epoch * 0x9e3779b97f4a7c15UL);
+
+  std::string payload;
+  std::vector<uint8_t> packed(PACKBITS_MAX_ENCODED_SIZE(rowBytes));
+  for (long row = firstRow; row < profile.height; row++) {
+    const char* data = rows.data() + row * rowBytes;
+    if (header.encoding == BITMAP_ENCODING_RAW) {
+      payload.append(data, rowBytes);
+      continue;
+    }
+    size_t size = packbitsEncode((const uint8_t*)data, rowBytes, packed.data());
+    payload += (char)(size & 0xff);
+    payload += (char)(size >> 8);
+    payload.append((const char*)packed.data(), size);
+  }
+  header.payloadLength = payload.size();
+
+  uint8_t headerData[BITMAP_V3_HEADER_SIZE];
+  writeBitmapV3Header(headerData, header);
+  return std::string((const char*)headerData, sizeof(headerData)) + payload;
+}
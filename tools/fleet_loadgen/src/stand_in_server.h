@@ -0,0 +1,49 @@
+#ifndef STAND_IN_SERVER_H
+#define STAND_IN_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "simulated_device.h"
+
+// Tuning of the stand-in, the real server's rendering cost is replaced by a fixed delay
+struct StandInOptions {
+  int sleepSeconds = 60;      // sleep sent in the config response
+  int frameChangeSeconds = 300;  // the frame (and its checksum) changes this often
+  int renderDelayMs = 0;      // added to every bitmap request
+  int scheduleFrames = 0;     // frames offered for the frame schedule
+};
+
+// Tiny in-process HTTP server speaking the device API: config, fmt=3 bitmap and frame schedule. Meant for checking the
+// load generator itself and for measuring the client side limits without a real server.
+class StandInServer {
+ private:
+  const DeviceProfile& profile;
+  const StandInOptions& options;
+  int listenFd = -1;
+  std::thread acceptThread;
+  std::atomic<bool> stopping{false};
+  std::mutex mutex;
+  std::condition_variable idle;
+  int activeConnections = 0;
+
+  void acceptLoop();
+  void handleConnection(int fd);
+  std::string respond(const std::string& method, const std::string& path);
+  std::string frameRows(long epoch);
+  std::string frame(long epoch, const char* checksum);
+  std::string frameV3(long epoch, long firstRow, unsigned int capabilities);
+
+ public:
+  StandInServer(const DeviceProfile& profile, const StandInOptions& options);
+  ~StandInServer();
+
+  // Listens on 127.0.0.1 (port 0 = any free one), returns the port or -1
+  int start(int port);
+  void stop();
+};
+
+#endif  // STAND_IN_SERVER_H
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""Local TLS stand-in for trying out the HTTPS transport of the firmware (CALENDAR_URL_HTTPS in board.h).
+
+Terminates TLS in front of a plain HTTP server (normally the calendar server on the same machine) and logs every handshake
+with its duration and whether the client resumed a cached session, which is what the firmware should do on most wakeups.
+Session IDs and session tickets are both enabled, as on a typical reverse proxy.
+
+    python3 tools/tls_standin/tls_standin.py --listen 0.0.0.0:8443 --upstream 127.0.0.1:5000
+
+A self-signed certificate is created on the first run with the openssl command line tool (or pass --cert and --key). Its
+SHA-256 fingerprint is printed for CALENDAR_SERVER_CERT_SHA256 in board.h.
+"""
+
+import argparse
+import hashlib
+import os
+import socket
+import ssl
+import subprocess
+import threading
+import time
+
+
+def host_port(value):
+    host, _, port = value.rpartition(":")
+    return host, int(port)
+
+
+def ensure_certificate(cert, key, common_name):
+    if os.path.exists(cert) and os.path.exists(key):
+        return
+    subprocess.run(
+        ["openssl", "req", "-x509", "-newkey", "ec", "-pkeyopt", "ec_paramgen_curve:prime256v1", "-nodes", "-days", "3650",
+         "-subj", f"/CN={common_name}", "-keyout", key, "-out", cert],
+        check=True, capture_output=True)
+    print(f"Created a self-signed certificate for {common_name} in {cert}")
+
+
+def fingerprint(cert):
+    with open(cert, encoding="ascii") as f:
+        der = ssl.PEM_cert_to_DER_cert(f.read())
+    return ":".join(f"{b:02X}" for b in hashlib.sha256(der).digest())
+
+
+def pipe(source, destination):
+    try:
+        while True:
+            data = source.recv(16384)
+            if not data:
+                break
+            destination.sendall(data)
+    except OSError:
+        pass
+    finally:
+        for s in (source, destination):
+            try:
+                s.shutdown(socket.SHUT_RDWR)
+            except OSError:
+                pass
+
+
+def handle(raw, address, context, upstream, stats):
+    start = time.monotonic()
+    try:
+        tls = context.wrap_socket(raw, server_side=True)
+    except (ssl.SSLError, OSError) as e:
+        print(f"{address[0]}: handshake failed: {e}")
+        raw.close()
+        return
+    ms = (time.monotonic() - start) * 1000
+    with stats["lock"]:
+        stats["handshakes"] += 1
+        stats["resumed"] += tls.session_reused
+        summary = f"{stats['resumed']}/{stats['handshakes']} resumed"
+    print(f"{address[0]}: {'resumed' if tls.session_reused else 'full'} {tls.version()} handshake in {ms:.0f} ms, "
+          f"{tls.cipher()[0]} ({summary})")
+
+    try:
+        backend = socket.create_connection(upstream)
+    except OSError as e:
+        print(f"{address[0]}: can't connect to {upstream[0]}:{upstream[1]}: {e}")
+        tls.close()
+        return
+    threading.Thread(target=pipe, args=(backend, tls), daemon=True).start()
+    pipe(tls, backend)
+    tls.close()
+    backend.close()
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("--listen", type=host_port, default="0.0.0.0:8443", help="address:port to accept TLS on (default 0.0.0.0:8443)")
+    parser.add_argument("--upstream", type=host_port, default="127.0.0.1:5000", help="plain HTTP server (default 127.0.0.1:5000)")
+    parser.add_argument("--cert", default=os.path.join(here, "standin_cert.pem"), help="certificate (PEM), created if missing")
+    parser.add_argument("--key", default=os.path.join(here, "standin_key.pem"), help="private key (PEM), created if missing")
+    parser.add_argument("--name", default=socket.gethostname(), help="common name of a created certificate")
+    parser.add_argument("--no-tickets", action="store_true", help="resume by session ID only")
+    args = parser.parse_args()
+
+    ensure_certificate(args.cert, args.key, args.name)
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(args.cert, args.key)
+    if args.no_tickets:
+        context.options |= ssl.OP_NO_TICKET
+    print(f"Certificate SHA-256: {fingerprint(args.cert)}")
+
+    stats = {"handshakes": 0, "resumed": 0, "lock": threading.Lock()}
+    listener = socket.create_server(args.listen, reuse_port=False)
+    print(f"Listening on {args.listen[0]}:{args.listen[1]}, forwarding to {args.upstream[0]}:{args.upstream[1]}")
+    while True:
+        raw, address = listener.accept()
+        threading.Thread(target=handle, args=(raw, address, context, args.upstream, stats), daemon=True).start()
+
+
+if __name__ == "__main__":
+    main()